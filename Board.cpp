@@ -10,7 +10,12 @@
 
 #include <iostream>
 #include <math.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include "Board.h"
+#include "instrumentation.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -154,6 +159,8 @@ void Hexagram::generateVertices()
 
 void Board::computeNeighbours()
 {
+	INSTRUMENT_SCOPE(PROBE_NEIGHBOURS);
+	
 	#ifdef DEBUG
 	cout << "--- First neighbours computation ---" << endl;
 	#endif
@@ -185,6 +192,8 @@ void Board::computeNeighbours()
 
 void Board::computeNeighbours2()
 {
+	INSTRUMENT_SCOPE(PROBE_NEIGHBOURS2);
+	
 	#ifdef DEBUG
 	cout << "--- Second neighbours computation ---" << endl;
 	#endif
@@ -228,6 +237,220 @@ void Board::computeNeighbours2()
 
 
 
+// Table of distances between all pairs of vertices. The geometry does not
+// change during the game, so the table is computed once and shared by all
+// the copies of the board (algorithms work on copies).
+
+void Board::computeDistances()
+{
+	#ifdef DEBUG
+	cout << "--- Distances computation ---" << endl;
+	#endif
+	
+	int nVertices = vertices_.size();
+	vector<int> *distances = new vector<int>(nVertices*nVertices,0);
+	
+	for (int i=0; i<nVertices; i++)
+		for (int j=0; j<nVertices; j++)
+			if (i!=j) (*distances)[i*nVertices+j] = 
+			          distance(vertices_[i],vertices_[j]);
+	
+	distances_ = shared_ptr<const vector<int>>(distances);
+}
+
+// Table of relaxed distances: one breadth-first search from each vertex,
+// where a move goes to a neighbour or to any vertex of the component of
+// the jump graph (vertices linked by a jump over a neighbour)
+
+void Board::computeRelaxedDistances()
+{
+	int nVertices = vertices_.size();
+	
+	// components of the jump graph
+	vector<int> component(nVertices,-1);
+	vector<vector<int>> components;
+	for (int i=0; i<nVertices; i++)
+	{
+		if (component[i]>=0) continue;
+		
+		component[i] = components.size();
+		components.push_back(vector<int>(1,i));
+		vector<int> &members = components.back();
+		
+		for (int k=0; k<members.size(); k++)
+			for (int j : vertices_[members[k]].neighbours2_)
+				if (j>=0 && component[j]<0)
+				{
+					component[j] = component[i];
+					members.push_back(j);
+				}
+	}
+	
+	vector<int> *distances = new vector<int>(nVertices*nVertices,-1);
+	vector<int> queue;
+	vector<bool> componentDone;
+	
+	for (int isource=0; isource<nVertices; isource++)
+	{
+		int *row = &(*distances)[isource*nVertices];
+		row[isource] = 0;
+		queue.assign(1,isource);
+		componentDone.assign(components.size(),false);
+		
+		for (int k=0; k<queue.size(); k++)
+		{
+			int i = queue[k];
+			
+			for (int j : vertices_[i].neighbours_)
+				if (row[j]<0)
+				{
+					row[j] = row[i]+1;
+					queue.push_back(j);
+				}
+			
+			if (componentDone[component[i]]) continue;
+			componentDone[component[i]] = true;
+			for (int j : components[component[i]])
+				if (row[j]<0)
+				{
+					row[j] = row[i]+1;
+					queue.push_back(j);
+				}
+		}
+	}
+	
+	relaxedDistances_ = shared_ptr<const vector<int>>(distances);
+}
+
+
+
+// Random keys for each (vertex,team) and each playing team (-1 included).
+// They are drawn from a fixed seed (splitmix64 generator), so that the
+// hashes are the same from one run to the other, e.g. for stored tables.
+
+void Board::computeHashKeys()
+{
+	int nKeys = vertices_.size()*nTeams_+nTeams_+1;
+	vector<uint64_t> *hashKeys = new vector<uint64_t>(nKeys);
+	
+	uint64_t state = 0x43484b52ULL;
+	for (int i=0; i<nKeys; i++)
+	{
+		state += 0x9e3779b97f4a7c15ULL;
+		uint64_t z = state;
+		z = (z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+		z = (z^(z>>27))*0x94d049bb133111ebULL;
+		(*hashKeys)[i] = z^(z>>31);
+	}
+	
+	hashKeys_ = shared_ptr<const vector<uint64_t>>(hashKeys);
+}
+
+void Board::computeHash()
+{
+	hash_ = 0;
+	for (int i=0; i<pawns_.size(); i++)
+		hash_ ^= (*hashKeys_)[hashKeyOfPawn(pawnToVertex_[i], 
+		                                    pawns_[i].getTeam())];
+}
+
+
+
+// Hashes of the images of the position by the symmetries, computed on
+// demand (tables of books and caches, not the hot loops)
+
+uint64_t Board::getCanonicalHash(int &isymmetry)
+{
+	const vector<uint64_t> &keys = *hashKeys_;
+	
+	isymmetry = 0;
+	uint64_t hashMin = getHash();
+	
+	for (int i=1; i<symmetries_->size(); i++)
+	{
+		const Symmetry &symmetry = (*symmetries_)[i];
+		
+		uint64_t hash = 0;
+		for (int ipawn=0; ipawn<pawns_.size(); ipawn++)
+			hash ^= keys[hashKeyOfPawn(symmetry.vertices_[pawnToVertex_[ipawn]],
+			                           symmetry.teams_[pawns_[ipawn].getTeam()])];
+		int team = playingTeam_<0 ? -1 : symmetry.teams_[playingTeam_];
+		hash ^= keys[hashKeyOfPlayingTeam(team)];
+		
+		if (hash < hashMin)
+		{
+			hashMin = hash;
+			isymmetry = i;
+		}
+	}
+	
+	return hashMin;
+}
+
+uint64_t Board::getCanonicalHash()
+{
+	int isymmetry;
+	return getCanonicalHash(isymmetry);
+}
+
+// Identity only, for the boards without known symmetries
+
+void Board::computeSymmetries()
+{
+	vector<Symmetry> *symmetries = new vector<Symmetry>();
+	
+	vector<int> vertices;
+	for (int i=0; i<vertices_.size(); i++) vertices.push_back(i);
+	addSymmetry(*symmetries, vertices);
+	
+	symmetries_ = shared_ptr<const vector<Symmetry>>(symmetries);
+}
+
+// Adds the permutation of the vertices if it maps the home of each team
+// onto the home of a team, with the playing order kept (the images of the
+// teams 0,1,2,... are c,c+1,c+2,... modulo the number of teams). The
+// targets follow since they are opposite to the homes.
+
+bool Board::addSymmetry(vector<Symmetry> &symmetries, vector<int> &vertices)
+{
+	Symmetry symmetry;
+	symmetry.vertices_ = vertices;
+	symmetry.inverse_ = vector<int>(vertices.size(),-1);
+	for (int i=0; i<vertices.size(); i++)
+	{
+		if (vertices[i]<0) return false;
+		symmetry.inverse_[vertices[i]] = i;
+	}
+	
+	for (int team=0; team<nTeams_; team++)
+	{
+		vector<int> image;
+		for (int ivertex : homes_[team]) image.push_back(vertices[ivertex]);
+		sort(image.begin(), image.end());
+		
+		int teamImage = -1;
+		for (int team2=0; team2<nTeams_; team2++)
+		{
+			vector<int> home = homes_[team2];
+			sort(home.begin(), home.end());
+			if (home == image) teamImage = team2;
+		}
+		
+		if (teamImage<0) return false;
+		if (team>0 && teamImage != (symmetry.teams_[0]+team)%nTeams_)
+			return false;
+		symmetry.teams_.push_back(teamImage);
+	}
+	
+	symmetries.push_back(symmetry);
+	return true;
+}
+
+
+
+
+
+
 // we identify the branch with a line that seperates the branch from
 // the rest of the hexagram
 
@@ -446,6 +669,124 @@ void Hexagram::getBranchAngleAndTipPosition(int team, double &xTip,
 
 
 
+// The symmetries of the hexagram are the 6 rotations by multiples of 60
+// degrees and the 6 reflections, applied to the coordinates of the
+// vertices. Those that don't fit the teams (see addSymmetry) are dropped:
+// 6 rotations remain with 6 teams, 3 with 3 teams, 2 with 4 teams, 2
+// rotations and 2 reflections with 2 teams, and the identity and one
+// reflection with 1 team.
+
+void Hexagram::computeSymmetries()
+{
+	vector<Symmetry> *symmetries = new vector<Symmetry>();
+	
+	for (int reflection=0; reflection<2; reflection++)
+		for (int rotation=0; rotation<6; rotation++)
+		{
+			double angle = PI/3*rotation;
+			vector<int> vertices(vertices_.size(),-1);
+			
+			for (int i=0; i<vertices_.size(); i++)
+			{
+				double x = vertices_[i].getX();
+				double y = reflection ? -vertices_[i].getY() : vertices_[i].getY();
+				double xImage = cos(angle)*x - sin(angle)*y;
+				double yImage = sin(angle)*x + cos(angle)*y;
+				
+				for (int j=0; j<vertices_.size(); j++)
+					if (fabs(vertices_[j].getX()-xImage)<1e-6 &&
+					    fabs(vertices_[j].getY()-yImage)<1e-6) vertices[i] = j;
+			}
+			
+			addSymmetry(*symmetries, vertices);
+		}
+	
+	symmetries_ = shared_ptr<const vector<Symmetry>>(symmetries);
+}
+
+
+
+// Tables of the moves on an empty board. They only depend on the size of
+// the hexagram, so they are computed for the first board of each size
+// and shared by all the boards built afterwards.
+
+class HexagramHopTables
+{
+	public:
+		shared_ptr<const vector<int>> relaxedDistances_;
+		shared_ptr<const vector<int>> directionNeighbours_;
+		shared_ptr<const vector<vector<int>>> ladders_;
+};
+
+void Hexagram::computeHopTables()
+{
+	static mutex tablesMutex;
+	static map<int,HexagramHopTables> tablesBySize;
+	
+	lock_guard<mutex> lock(tablesMutex);
+	map<int,HexagramHopTables>::iterator it = tablesBySize.find(size_);
+	if (it != tablesBySize.end())
+	{
+		relaxedDistances_ = it->second.relaxedDistances_;
+		directionNeighbours_ = it->second.directionNeighbours_;
+		ladders_ = it->second.ladders_;
+		return;
+	}
+	
+	computeRelaxedDistances();
+	computeLadders();
+	
+	HexagramHopTables tables;
+	tables.relaxedDistances_ = relaxedDistances_;
+	tables.directionNeighbours_ = directionNeighbours_;
+	tables.ladders_ = ladders_;
+	tablesBySize[size_] = tables;
+}
+
+// The direction of a neighbour is given by the angle of the edge, the
+// jumps of a vertex are behind its neighbours (neighbours2_)
+
+void Hexagram::computeLadders()
+{
+	int nVertices = vertices_.size();
+	vector<int> *directionNeighbours = new vector<int>(nVertices*6,-1);
+	vector<int> directionJumps(nVertices*6,-1);
+	
+	for (int i=0; i<nVertices; i++)
+	{
+		vector<int> neighbours = vertices_[i].getNeighbours();
+		vector<int> neighbours2 = vertices_[i].getNeighbours2();
+		for (int k=0; k<neighbours.size(); k++)
+		{
+			int j = neighbours[k];
+			double angle = atan2(vertices_[j].getY()-vertices_[i].getY(),
+			                     vertices_[j].getX()-vertices_[i].getX());
+			int direction = (int(round(angle/(PI/3)))+6)%6;
+			
+			(*directionNeighbours)[i*6+direction] = j;
+			directionJumps[i*6+direction] = neighbours2[k];
+		}
+	}
+	
+	vector<vector<int>> *ladders = new vector<vector<int>>(nVertices*6);
+	for (int i=0; i<nVertices; i++)
+		for (int direction=0; direction<6; direction++)
+		{
+			vector<int> &ladder = (*ladders)[i*6+direction];
+			int j = directionJumps[i*6+direction];
+			while (j>=0)
+			{
+				ladder.push_back(j);
+				j = directionJumps[j*6+direction];
+			}
+		}
+	
+	directionNeighbours_ = shared_ptr<const vector<int>>(directionNeighbours);
+	ladders_ = shared_ptr<const vector<vector<int>>>(ladders);
+}
+
+
+
 // For the hexagram, the target vertices are those the further from (0,0)
 void Hexagram::computeTargetVertices()
 {
@@ -517,6 +858,36 @@ void Board::placePawnsOnVertices()
 
 
 
+// Place the pawns on the given vertices (indexed by pawn) and set the
+// playing team, e.g. to restore a stored position. Teams already on their
+// target are ranked in the order of their index, the real order being 
+// unknown.
+
+void Board::setPosition(vector<int> pawnVertices, int playingTeam)
+{
+	assert(pawnVertices.size() == pawns_.size());
+	
+	for (int i=0; i<vertices_.size(); i++) vertexToPawn_[i] = -1;
+	
+	for (int i=0; i<pawns_.size(); i++)
+	{
+		pawnToVertex_[i] = pawnVertices[i];
+		vertexToPawn_[pawnVertices[i]] = i;
+	}
+	
+	playingTeam_ = playingTeam;
+	computeHash();
+	
+	winningOrder_ = vector<int>(nTeams_,-1);
+	vector<int> teamsDone = teamsOnTarget();
+	for (int i=0; i<teamsDone.size(); i++) winningOrder_[teamsDone[i]] = i+1;
+}
+
+
+
+
+
+
 void Board::checkPawnPlacement()
 {
 	#ifdef DEBUG
@@ -710,25 +1081,13 @@ double Board::progressFromDistance(int team)
 // Returns 2 if the pawn or vertex doesn't exist
 // Returns 3 if the pawn's team has already finished the game
 
-int Board::move(int ipawn, int ivertex, ofstream &recordFile)
+int Board::move(int ipawn, int ivertex, RecordSink &recordSink)
 {
-	#ifdef DEBUG
-	cout << "--- Move (Board class) ---" << endl;
-	cout << "ipawn = " << ipawn << " ivertex = " << ivertex << endl;
-	#endif
-	
-	// save info before we do the move
-	int nTeamsFinish0 = teamsOnTarget().size();
+	INSTRUMENT_SCOPE(PROBE_BOARD_MOVE);
 	
-	// Check if pawn and vertex exist
-	if (ipawn >= pawns_.size()) return 2;
-	if (ivertex >= vertices_.size()) return 2;
-	
-	// Check if team has not already finished the game
-	int team = pawns_[ipawn].getTeam();
-	vector<int> teamsDone = teamsOnTarget();
-	for (int team2 : teamsDone)
-		if (team == team2) return 3;
+	// Check if pawn, vertex and team can move
+	int status = checkPawnCanMove(ipawn, ivertex);
+	if (status != 0) return status;
 	
 	// Check if move is a valid direct move
 	int ivertexCurrent = pawnToVertex_[ipawn];
@@ -752,22 +1111,88 @@ int Board::move(int ipawn, int ivertex, ofstream &recordFile)
 			break;
 		}
 	}
-	if (!inList1 && !inList2) return 1;
+	if (!inList1 && !inList2) 
+	{
+		TRACE_EVENT(TRACE_MOVE_INVALID, ipawn, ivertex, 1);
+		return 1;
+	}
+	
+	// Record move, with the hops if the record keeps them
+	if (recordSink.storesPaths())
+	{
+		vector<int> path = findPath(ivertexCurrent, ivertex);
+		recordSink.recordMovePath(ivertexCurrent, path);
+	}
+	else recordSink.recordMove(ivertexCurrent, ivertex);
 	
 	// If we arrive to this point, then the move is valid
 	// We thus perform the move
+	performMove(ipawn, ivertex);
+	
+	return 0;
+}
+
+// Same as above for a move given by the list of vertices where the pawn
+// lands (one for a direct move, one per hop otherwise). The move is checked
+// hop by hop, in a time linear in the number of hops.
+
+int Board::movePath(int ipawn, vector<int> &path, RecordSink &recordSink)
+{
+	INSTRUMENT_SCOPE(PROBE_BOARD_MOVE);
+	
+	if (path.size()==0) return 1;
+	
+	int status = checkPawnCanMove(ipawn, path.back());
+	if (status != 0) return status;
+	
+	int ivertexCurrent = pawnToVertex_[ipawn];
+	if (!validPath(ivertexCurrent, path))
+	{
+		TRACE_EVENT(TRACE_MOVE_INVALID, ipawn, path.back(), 1);
+		return 1;
+	}
+	
+	recordSink.recordMovePath(ivertexCurrent, path);
+	performMove(ipawn, path.back());
+	
+	return 0;
+}
+
+// Checks common to all moves, same return values as move()
+
+int Board::checkPawnCanMove(int ipawn, int ivertex)
+{
+	// Check if pawn and vertex exist
+	if (ipawn >= pawns_.size()) return 2;
+	if (ivertex >= vertices_.size()) return 2;
+	
+	// Check if team has not already finished the game
+	int team = pawns_[ipawn].getTeam();
+	vector<int> teamsDone = teamsOnTarget();
+	for (int team2 : teamsDone)
+		if (team == team2) return 3;
+	
+	return 0;
+}
+
+// Move a pawn after the checks, and pass the turn
+
+void Board::performMove(int ipawn, int ivertex)
+{
+	// save info before we do the move
+	int nTeamsFinish0 = teamsOnTarget().size();
+	int team = pawns_[ipawn].getTeam();
+	
+	int ivertexCurrent = pawnToVertex_[ipawn];
 	vertexToPawn_[ivertexCurrent] = -1;
 	vertexToPawn_[ivertex] = ipawn;
 	pawnToVertex_[ipawn] = ivertex;
+	hash_ ^= (*hashKeys_)[hashKeyOfPawn(ivertexCurrent, team)]
+	       ^ (*hashKeys_)[hashKeyOfPawn(ivertex, team)];
+	TRACE_EVENT(TRACE_MOVE, ipawn, ivertexCurrent, ivertex);
 	
-	// Recompute neighbours, etc.
-	// TODO: do not recompute all neighbours
-	computeNeighbours();
-	computeNeighbours2();
-	
-	// Record move in file
-	recordFile << "Move from vertex " << ivertexCurrent << " to " 
-	           << ivertex << endl;
+	// Neighbours only depend on the geometry of the board, they don't need
+	// to be recomputed after a move
 	
 	// compute next playing team
 	nextPlayingTeam();
@@ -775,8 +1200,32 @@ int Board::move(int ipawn, int ivertex, ofstream &recordFile)
 	// Check if pawn's team just finished
 	if (teamsOnTarget().size() > nTeamsFinish0)
 		winningOrder_[team] = teamsOnTarget().size();
-	
-	return 0;
+}
+
+// Same without recording the move
+
+int Board::move(int ipawn, int ivertex)
+{
+	NullRecordSink recordSink;
+	return move(ipawn, ivertex, recordSink);
+}
+
+
+
+
+// Move the pawn on a vertex to another one without any check, recording or
+// change of playing team. Meant for searches that explore many positions
+// and undo their moves with the reverse call.
+
+void Board::moveUnchecked(int ivertexFrom, int ivertexTo)
+{
+	int ipawn = vertexToPawn_[ivertexFrom];
+	int team = pawns_[ipawn].getTeam();
+	vertexToPawn_[ivertexFrom] = -1;
+	vertexToPawn_[ivertexTo] = ipawn;
+	pawnToVertex_[ipawn] = ivertexTo;
+	hash_ ^= (*hashKeys_)[hashKeyOfPawn(ivertexFrom, team)]
+	       ^ (*hashKeys_)[hashKeyOfPawn(ivertexTo, team)];
 }
 
 
@@ -786,9 +1235,7 @@ int Board::move(int ipawn, int ivertex, ofstream &recordFile)
 
 vector<int> Board::availableMovesDirect(int ivertex)
 {
-	#ifdef DEBUG
-	cout << "--- Computaing available direct moves ---" << endl;
-	#endif
+	INSTRUMENT_SCOPE(PROBE_MOVES_DIRECT);
 	
 	vector<int> destinations;
 	
@@ -796,6 +1243,8 @@ vector<int> Board::availableMovesDirect(int ivertex)
 	for (int ivertex2 : vertices_[ivertex].getNeighbours())
 		if (vertexToPawn_[ivertex2]<0) destinations.push_back(ivertex2);
 	
+	TRACE_EVENT(TRACE_MOVES_DIRECT, ivertex, destinations.size(), 0);
+	
 	return destinations;
 }
 
@@ -810,13 +1259,10 @@ vector<int> Board::availableMovesDirect(int ivertex)
 vector<int> Board::availableMovesHopping(int ivertex, 
             vector<int> &ivertexForbidden)
 {
-	#ifdef DEBUG
-	if (ivertexForbidden.size()==0)
-		cout << "--- Computing available hopping moves ---" << endl;
-	else
-		cout << "recursion from " 
-		     << ivertexForbidden[ivertexForbidden.size()-1] << endl;
-	#endif
+	INSTRUMENT_COUNT(PROBE_MOVES_HOPPING_RECURSION,1);
+	
+	TRACE_EVENT(TRACE_HOPPING_RECURSION, ivertex, ivertexForbidden.size()>0 ?
+	            ivertexForbidden[ivertexForbidden.size()-1] : -1, 0);
 	
 	// list no available moves if the vertex is forbidden
 	// otherwise, add the vertex to the forbidden ones
@@ -868,9 +1314,157 @@ vector<int> Board::availableMovesHopping(int ivertex,
 
 vector<int> Board::availableMovesHopping(int ivertex)
 {
+	INSTRUMENT_SCOPE(PROBE_MOVES_HOPPING);
+	
 	vector<int> empty;
+	vector<int> destinations = availableMovesHopping(ivertex, empty);
+	
+	TRACE_EVENT(TRACE_MOVES_HOPPING, ivertex, destinations.size(), 0);
+	
+	return destinations;
+}
+
+
+
+
+// Same destinations as the recursive search above, but found with a 
+// breadth-first search. Each destination is listed once and comes with the
+// number of hops of the shortest chain reaching it.
+
+vector<int> Board::availableMovesHoppingBFS(int ivertex, vector<int> &numHops)
+{
+	vector<int> parents;
+	return availableMovesHoppingBFS(ivertex, numHops, parents);
+}
+
+// Same, also giving for each destination the vertex of the previous hop
+// (parents), from which the chain of hops can be rebuilt.
+
+vector<int> Board::availableMovesHoppingBFS(int ivertex, vector<int> &numHops,
+                                            vector<int> &parents)
+{
+	INSTRUMENT_SCOPE(PROBE_MOVES_HOPPING_BFS);
+	
+	vector<int> destinations;
+	numHops.clear();
+	parents.clear();
+	
+	// vertices already reached, the starting one included
+	vector<bool> visited(vertices_.size(),false);
+	visited[ivertex] = true;
+	
+	// queue of vertices to hop from, destinations are appended in order
+	// of discovery so that the list itself serves as queue
+	int nHopsCurrent = 0;
+	int ivertexCurrent = ivertex;
+	int iqueue = 0;
+	
+	while (true)
+	{
+		vector<int> &neighbours = vertices_[ivertexCurrent].neighbours_;
+		vector<int> &neighbours2 = vertices_[ivertexCurrent].neighbours2_;
+		
+		for (int i=0; i<neighbours.size(); i++)
+		{
+			int ivertex1 = neighbours[i];
+			int ivertex2 = neighbours2[i];
+			
+			if (ivertex2<0 || visited[ivertex2]) continue;
+			
+			if (vertexToPawn_[ivertex1]>=0 && vertexToPawn_[ivertex2]<0)
+			{
+				visited[ivertex2] = true;
+				destinations.push_back(ivertex2);
+				numHops.push_back(nHopsCurrent+1);
+				parents.push_back(ivertexCurrent);
+			}
+		}
+		
+		if (iqueue >= destinations.size()) break;
+		ivertexCurrent = destinations[iqueue];
+		nHopsCurrent = numHops[iqueue];
+		iqueue++;
+	}
 	
-	return availableMovesHopping(ivertex, empty);
+	return destinations;
+}
+
+
+
+
+// Vertices where the pawn lands when moving from a vertex to another: the
+// destination alone for a direct move, the end of each hop of the shortest
+// chain otherwise. Empty if there is no such move.
+
+vector<int> Board::findPath(int ivertexFrom, int ivertexTo)
+{
+	vector<int> path;
+	
+	for (int ivertex : vertices_[ivertexFrom].neighbours_)
+	{
+		if (ivertex==ivertexTo && vertexToPawn_[ivertexTo]<0)
+		{
+			path.push_back(ivertexTo);
+			return path;
+		}
+	}
+	
+	vector<int> numHops, parents;
+	vector<int> destinations = availableMovesHoppingBFS(ivertexFrom, numHops,
+	                                                    parents);
+	
+	// go back from the destination to the start
+	int ivertex = ivertexTo;
+	while (ivertex != ivertexFrom)
+	{
+		int i = 0;
+		while (i<destinations.size() && destinations[i]!=ivertex) i++;
+		if (i==destinations.size()) return vector<int>();
+		
+		path.insert(path.begin(), ivertex);
+		ivertex = parents[i];
+	}
+	
+	return path;
+}
+
+
+
+
+// Check that the pawn on a vertex can land successively on the vertices of
+// the path: either a single direct move, or a chain of hops over pawns to
+// empty vertices.
+
+bool Board::validPath(int ivertexFrom, vector<int> &path)
+{
+	if (path.size()==0) return false;
+	
+	for (int ivertex : path)
+		if (ivertex<0 || ivertex>=vertices_.size() || vertexToPawn_[ivertex]>=0)
+			return false;
+	
+	// direct move
+	if (path.size()==1)
+		for (int ivertex : vertices_[ivertexFrom].neighbours_)
+			if (ivertex==path[0]) return true;
+	
+	// chain of hops
+	int ivertexCurrent = ivertexFrom;
+	for (int ivertexNext : path)
+	{
+		vector<int> &neighbours = vertices_[ivertexCurrent].neighbours_;
+		vector<int> &neighbours2 = vertices_[ivertexCurrent].neighbours2_;
+		
+		bool found = false;
+		for (int i=0; i<neighbours.size(); i++)
+			if (neighbours2[i]==ivertexNext && vertexToPawn_[neighbours[i]]>=0)
+				found = true;
+		if (!found) return false;
+		
+		ivertexCurrent = ivertexNext;
+	}
+	
+	return true;
 }
 
 
@@ -929,9 +1523,7 @@ void Board::prevPlayingTeam()
 
 vector<int> Board::teamsOnTarget()
 {
-	#ifdef DEBUG
-	cout << "--- Computing teams on target ---" << endl;
-	#endif
+	INSTRUMENT_SCOPE(PROBE_TEAMS_ON_TARGET);
 	
 	vector<int> teamsOnTarget_;
 	
@@ -953,6 +1545,8 @@ vector<int> Board::teamsOnTarget()
 		if (allTargetVerticesFilled) teamsOnTarget_.push_back(team);
 	}
 	
+	TRACE_EVENT(TRACE_TEAMS_ON_TARGET, teamsOnTarget_.size(), 0, 0);
+	
 	return teamsOnTarget_;
 }
 
@@ -13,8 +13,11 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <memory>
+#include <stdint.h>
 #include <math.h>
 #include <assert.h>
+#include "Record.h"
 
 using namespace std;
 
@@ -24,6 +27,8 @@ using namespace std;
 
 class Vertex
 {
+	friend class Board; // direct access to neighbours in hot loops
+	
 	public: 
 		Vertex(double x, double y) : x_(x), y_(y) {;}
 		
@@ -61,6 +66,20 @@ class Pawn
 
 
 
+// permutation of the vertices and of the teams that leaves the board and
+// the game unchanged
+class Symmetry
+{
+	public:
+		vector<int> vertices_;         // image of each vertex
+		vector<int> inverse_;          // vertex of which it is the image
+		vector<int> teams_;            // image of each team
+};
+
+
+
+
+
 // generic graph class meant to be inherited
 class Board
 {
@@ -75,6 +94,7 @@ class Board
 			
 			// other
 			playingTeam_ = 0;
+			hash_ = 0;
 			winningOrder_ = vector<int>(nTeams,-1);
 		}
 		
@@ -85,10 +105,13 @@ class Board
 		// vertices and pawns
 		vector<Vertex> getVertices() {return vertices_;}
 		vector<Pawn> getPawns() {return pawns_;}
+		int getTeamOfPawn(int ipawn) {return pawns_[ipawn].getTeam();}
 		
 		// vertex to pawn relation
 		int getVertexFromPawn(int ipawn) {return pawnToVertex_[ipawn];}
 		int getPawnFromVertex(int ivertex) {return vertexToPawn_[ivertex];}
+		vector<int> getPawnVertices() {return pawnToVertex_;}
+		void setPosition(vector<int> pawnVertices, int playingTeam);
 		
 		// homes and targets
 		vector<int> getHomeOfTeam(int team) {return homes_[team];}
@@ -101,14 +124,56 @@ class Board
 		virtual int distance(Vertex vertex1, Vertex vertex2) {return -1;}
 		virtual bool aligned(Vertex vertex1, Vertex vertex2, 
 		                     Vertex vertex3) {return false;}
+		int vertexDistance(int ivertex1, int ivertex2)
+		{return (*distances_)[ivertex1*vertices_.size()+ivertex2];}
+		const int *distanceRow(int ivertex)
+		{return &(*distances_)[ivertex*vertices_.size()];}
+		
+		// number of moves between two vertices if pawns were wherever the
+		// jumps need them and nowhere else (a step, or any chain of jumps),
+		// a lower bound of the moves of a pawn in any position; the table
+		// is computed at the first call if the board did not build it
+		int relaxedDistance(int ivertex1, int ivertex2)
+		{
+			if (!relaxedDistances_) computeRelaxedDistances();
+			return (*relaxedDistances_)[ivertex1*vertices_.size()+ivertex2];
+		}
 		double progressFromDistance(int team);
 		
+		// hash of the position and of the playing team, pawns of a team are
+		// interchangeable (Zobrist hashing, updated at each move)
+		uint64_t getHash()
+		{return hash_ ^ (*hashKeys_)[hashKeyOfPlayingTeam(playingTeam_)];}
+		
+		// symmetries that map the homes of the teams onto homes and keep the
+		// playing order, the identity first
+		int getNumSymmetries() {return symmetries_->size();}
+		const Symmetry &getSymmetry(int isymmetry)
+		{return (*symmetries_)[isymmetry];}
+		
+		// smallest hash of the symmetric positions, the same for a whole
+		// class of positions; isymmetry maps the board onto the position
+		// that has it (vertices and teams in tables keyed by this hash are
+		// to be mapped with it)
+		uint64_t getCanonicalHash();
+		uint64_t getCanonicalHash(int &isymmetry);
+		
 		// moves
-		int move(int ipawn, int ivertex, ofstream &recordFile);
+		int move(int ipawn, int ivertex, RecordSink &recordSink);
+		int move(int ipawn, int ivertex);
+		int movePath(int ipawn, vector<int> &path, RecordSink &recordSink);
+		bool validPath(int ivertexFrom, vector<int> &path);
+		vector<int> findPath(int ivertexFrom, int ivertexTo);
 		vector<int> availableMovesDirect(int ivertex);
 		vector<int> availableMovesHopping(int ivertex);
 		vector<int> availableMovesHopping(int ivertex, 
 		                                  vector<int> &ivertexForbidden);
+		vector<int> availableMovesHoppingBFS(int ivertex, 
+		                                     vector<int> &numHops);
+		vector<int> availableMovesHoppingBFS(int ivertex, 
+		                                     vector<int> &numHops,
+		                                     vector<int> &parents);
+		void moveUnchecked(int ivertexFrom, int ivertexTo);
 		
 		void print();
 	
@@ -125,6 +190,24 @@ class Board
 		// computation of neighbours
 		void computeNeighbours();
 		void computeNeighbours2();
+		void computeDistances();
+		void computeRelaxedDistances();
+		
+		// hashing of the positions
+		void computeHashKeys();
+		void computeHash();
+		
+		// symmetries (to override, the identity by default)
+		virtual void computeSymmetries();
+		bool addSymmetry(vector<Symmetry> &symmetries, vector<int> &vertices);
+		int hashKeyOfPawn(int ivertex, int team)
+		{return ivertex*nTeams_+team;}
+		int hashKeyOfPlayingTeam(int team)
+		{return vertices_.size()*nTeams_+team+1;}
+		
+		// moves subroutines
+		int checkPawnCanMove(int ipawn, int ivertex);
+		void performMove(int ipawn, int ivertex);
 		
 		// playing order subroutines
 		void nextPlayingTeam();
@@ -142,6 +225,17 @@ class Board
 		vector<vector<int>> targets_;
 		vector<int> winningOrder_;
 		vector<int> targetVertex_;    // if the notion exists for the board
+		
+		// table of distances between vertices, shared between copies
+		shared_ptr<const vector<int>> distances_;
+		shared_ptr<const vector<int>> relaxedDistances_;
+		
+		// random keys of the hashing, shared between copies
+		shared_ptr<const vector<uint64_t>> hashKeys_;
+		uint64_t hash_;               // without the playing team
+		
+		// symmetries, shared between copies
+		shared_ptr<const vector<Symmetry>> symmetries_;
 };
 
 
@@ -162,11 +256,16 @@ class Hexagram : public Board
 			generateVertices();
 			computeNeighbours();
 			computeNeighbours2();
+			computeDistances();
+			computeHopTables();
+			computeHashKeys();
 			
 			// place pawns on graph
 			attributeHomeToTeams();
 			attributeTargetToTeams();
+			computeSymmetries();
 			placePawnsOnVertices();
+			computeHash();
 			computeTargetVertices();
 			
 			#ifdef DEBUG
@@ -184,6 +283,15 @@ class Hexagram : public Board
 		int distance(Vertex vertex1, Vertex vertex2);
 		bool aligned(Vertex vertex1, Vertex vertex2, Vertex vertex3);
 		
+		// neighbour and ladder in one of the six directions (0 along x, then
+		// counter-clockwise by 60 degrees), -1 or empty at the border; the
+		// ladder is the vertices reached by successive jumps in the
+		// direction, as far as a single move can go with the right stones
+		int getNeighbourInDirection(int ivertex, int direction)
+		{return (*directionNeighbours_)[ivertex*6+direction];}
+		const vector<int> &getLadder(int ivertex, int direction)
+		{return (*ladders_)[ivertex*6+direction];}
+		
 		// other geomery functions
 		void computeTargetVertices();
 		void getBranchAngleAndTipPosition(int team, double &xTip,
@@ -195,9 +303,16 @@ class Hexagram : public Board
 		vector<int> verticesOnBranch(int branch);
 		void attributeHomeToTeams();
 		void attributeTargetToTeams();
+		void computeSymmetries();
+		
+		// tables of the moves on an empty board, computed once per size
+		void computeHopTables();
+		void computeLadders();
 		
 		// member variables
 		int size_;
+		shared_ptr<const vector<int>> directionNeighbours_;
+		shared_ptr<const vector<vector<int>>> ladders_;
 };
 
 
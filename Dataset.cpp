@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Source file for the datasets of positions of the chinese checkers   //
+//    game.                                                               //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Dataset.h"
+
+using namespace std;
+
+
+
+
+string datasetShardFilename(string prefix, int shard)
+{
+	return prefix + "." + to_string(shard) + ".pos";
+}
+
+
+
+
+PositionDatasetWriter::PositionDatasetWriter(string filename, int boardType,
+                                             int boardSize, int nTeams,
+                                             int seed, int shard,
+                                             double samplingRate)
+: file_(filename, ios::binary), samplingRate_(samplingRate),
+  gen_(seed+shard), dist01_(0,1), teamMoves_(nTeams,0), failed_(!file_),
+  closed_(false)
+{
+	memset(&header_, 0, sizeof(header_));
+	memcpy(header_.magic_, "CCPOSDS1", 8);
+	header_.version_ = DATASET_VERSION;
+	header_.boardType_ = boardType;
+	header_.boardSize_ = boardSize;
+	header_.nTeams_ = nTeams;
+	header_.nPawns_ = nTeams*boardSize*(boardSize+1)/2;
+	header_.recordSize_ = sizeof(PositionRecord);
+	header_.seed_ = seed;
+	header_.shard_ = shard;
+	
+	if (nTeams>DATASET_MAX_TEAMS || header_.nPawns_>DATASET_MAX_PAWNS)
+		failed_ = true;
+	
+	// written again with the number of records when closing
+	file_.write((char*)&header_, sizeof(header_));
+}
+
+PositionDatasetWriter::~PositionDatasetWriter()
+{
+	close();
+}
+
+// Called before each move of the game, the position is kept with
+// probability samplingRate
+
+void PositionDatasetWriter::addPosition(Board &board, int igame,
+                                        int moveNumber)
+{
+	int team = board.getPlayingTeam();
+	if (team<0 || failed_) return;
+	
+	if (dist01_(gen_) < samplingRate_)
+	{
+		PositionRecord record;
+		memset(&record, 0, sizeof(record));
+		record.game_ = igame;
+		record.moveNumber_ = moveNumber;
+		record.playingTeam_ = team;
+		
+		vector<int> pawnVertices = board.getPawnVertices();
+		for (int i=0; i<pawnVertices.size(); i++)
+			record.pawnVertices_[i] = pawnVertices[i];
+		
+		gameRecords_.push_back(record);
+		teamMovesSampled_.push_back(teamMoves_[team]);
+	}
+	
+	teamMoves_[team]++;
+}
+
+// Labels the positions of the game with its outcome and writes them.
+// Positions of unfinished games are dropped.
+
+void PositionDatasetWriter::endGame(Board &board, int numMoves, bool finished)
+{
+	if (finished && !closed_)
+	{
+		vector<int> winningOrder = board.getWinningOrder();
+		
+		for (int i=0; i<gameRecords_.size(); i++)
+		{
+			PositionRecord &record = gameRecords_[i];
+			int team = record.playingTeam_;
+			
+			record.movesRemaining_ = numMoves - record.moveNumber_;
+			record.teamMovesRemaining_ = teamMoves_[team]-teamMovesSampled_[i];
+			for (int t=0; t<DATASET_MAX_TEAMS; t++)
+				record.winningOrder_[t] = t<winningOrder.size() ?
+				                          winningOrder[t] : -1;
+		}
+		
+		file_.write((char*)gameRecords_.data(),
+		            gameRecords_.size()*sizeof(PositionRecord));
+		header_.numRecords_ += gameRecords_.size();
+	}
+	
+	gameRecords_.clear();
+	teamMovesSampled_.clear();
+	for (int &n : teamMoves_) n = 0;
+}
+
+int PositionDatasetWriter::close()
+{
+	if (closed_) return failed_;
+	closed_ = true;
+	
+	file_.seekp(0);
+	file_.write((char*)&header_, sizeof(header_));
+	file_.close();
+	
+	if (!file_) failed_ = true;
+	return failed_;
+}
+
+
+
+
+PositionDatasetReader::~PositionDatasetReader()
+{
+	unmap();
+}
+
+void PositionDatasetReader::unmap()
+{
+	if (data_ != NULL) munmap((void*)data_, size_);
+	data_ = NULL;
+	records_ = NULL;
+	size_ = 0;
+}
+
+int PositionDatasetReader::open(string filename)
+{
+	unmap();
+	
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd<0) return 1;
+	
+	struct stat status;
+	if (fstat(fd, &status)<0 || status.st_size<sizeof(PositionDatasetHeader))
+	{
+		::close(fd);
+		return 2;
+	}
+	
+	size_ = status.st_size;
+	void *data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		size_ = 0;
+		return 1;
+	}
+	data_ = (const unsigned char*)data;
+	
+	// check the header and that the records are inside the file
+	memcpy(&header_, data_, sizeof(header_));
+	if (memcmp(header_.magic_, "CCPOSDS1", 8) != 0 ||
+	    header_.version_ != DATASET_VERSION ||
+	    header_.recordSize_ != sizeof(PositionRecord) ||
+	    sizeof(header_)+header_.numRecords_*sizeof(PositionRecord) > size_)
+	{
+		unmap();
+		return 2;
+	}
+	records_ = (const PositionRecord*)(data_+sizeof(header_));
+	
+	return 0;
+}
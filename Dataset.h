@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Header file for the datasets of positions of the chinese checkers   //
+//    game, used for fitting the evaluation of the algorithms.            //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Positions sampled from simulated games are written with the outcome of
+//	their game. A dataset is split in shards, one per thread of the
+//	simulation, so that threads write without any synchronisation. Shards
+//	are named <prefix>.<shard>.pos.
+//
+//	Shard format (little endian)
+//	o	header (64 bytes): "CCPOSDS1", version, board type, board size,
+//		number of teams, number of pawns, size of a record, seed, shard,
+//		number of records
+//	o	records of fixed size (PositionRecord), that can be used directly
+//		from a memory mapping
+
+#ifndef DATASET
+#define DATASET
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <stdint.h>
+#include "Board.h"
+
+using namespace std;
+
+
+const int DATASET_VERSION = 1;
+const int DATASET_MAX_TEAMS = 6;
+const int DATASET_MAX_PAWNS = 96;  // 6 teams of 15 pawns (size 5)
+
+struct PositionDatasetHeader
+{
+	char magic_[8];
+	uint32_t version_;
+	uint32_t boardType_;       // same values as in Record.h
+	uint32_t boardSize_;
+	uint32_t nTeams_;
+	uint32_t nPawns_;
+	uint32_t recordSize_;
+	uint32_t seed_;
+	uint32_t shard_;
+	uint64_t numRecords_;
+	char reserved_[16];
+};
+
+// position and outcome of its game (116 bytes)
+struct PositionRecord
+{
+	uint32_t game_;                // game index in the simulation
+	uint16_t moveNumber_;          // moves played before the position
+	uint16_t movesRemaining_;      // moves played after it until the end
+	uint16_t teamMovesRemaining_;  // moves of the playing team until it
+	                               // reaches its target
+	int8_t playingTeam_;
+	int8_t winningOrder_[DATASET_MAX_TEAMS]; // final rank of each team
+	uint8_t reserved_[3];
+	uint8_t pawnVertices_[DATASET_MAX_PAWNS];
+};
+
+// sizes of the file format
+static_assert(sizeof(PositionDatasetHeader) == 64, "dataset header size");
+static_assert(sizeof(PositionRecord) == 116, "dataset record size");
+
+string datasetShardFilename(string prefix, int shard);
+
+
+
+// Writer of one shard, used by a single thread. Positions of a game are
+// kept until the end of the game, when their labels are known.
+class PositionDatasetWriter
+{
+	public:
+		PositionDatasetWriter(string filename, int boardType, int boardSize,
+		                      int nTeams, int seed, int shard,
+		                      double samplingRate);
+		~PositionDatasetWriter();
+		
+		void addPosition(Board &board, int igame, int moveNumber);
+		void endGame(Board &board, int numMoves, bool finished);
+		int close();  // 0 if all records could be written, 1 otherwise
+		
+		long getNumRecords() {return header_.numRecords_;}
+	
+	protected:
+		ofstream file_;
+		PositionDatasetHeader header_;
+		double samplingRate_;
+		default_random_engine gen_;  // own generator, games are not affected
+		uniform_real_distribution<double> dist01_;
+		
+		vector<PositionRecord> gameRecords_;
+		vector<int> teamMoves_;      // moves of each team in the game so far
+		vector<int> teamMovesSampled_;  // team moves at each sampled record
+		bool failed_;
+		bool closed_;
+};
+
+// Read-only access to a shard through a memory mapping
+class PositionDatasetReader
+{
+	public:
+		PositionDatasetReader() : data_(NULL), size_(0), records_(NULL) {;}
+		PositionDatasetReader(const PositionDatasetReader&) = delete;
+		~PositionDatasetReader();
+		
+		// Returns 0 on success, 1 if the file can't be opened and 2 if it
+		// is not a valid shard
+		int open(string filename);
+		
+		PositionDatasetHeader getHeader() {return header_;}
+		long getNumRecords() {return header_.numRecords_;}
+		const PositionRecord& getRecord(long i) {return records_[i];}
+	
+	protected:
+		void unmap();
+		
+		const unsigned char *data_;
+		size_t size_;
+		PositionDatasetHeader header_;
+		const PositionRecord *records_;
+};
+
+
+#endif
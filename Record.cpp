@@ -0,0 +1,486 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Source file for the recording of the moves of the chinese checkers  //
+//    game.                                                               //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+#include <sstream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Record.h"
+
+using namespace std;
+
+
+
+
+void writeRecordEntry(ostream &out, const RecordEntry &entry)
+{
+	if (entry.type_ == RECORD_MOVE)
+	{
+		out << "Move from vertex " << entry.ivertexFrom_ << " to "
+		    << entry.ivertexTo_;
+		
+		// intermediate landing vertices
+		if (entry.path_.size()>1)
+		{
+			out << " via";
+			for (int i=0; i+1<entry.path_.size(); i++) out << " " << entry.path_[i];
+		}
+		
+		out << '\n';
+	}
+	else if (entry.type_ == RECORD_UNDO)
+		out << "Undo" << '\n';
+}
+
+// Parse a line of the text format, returns false if it is not recognised
+
+bool readRecordEntry(string line, RecordEntry &entry)
+{
+	if (line == "Undo")
+	{
+		entry = RecordEntry(RECORD_UNDO, -1, -1);
+		return true;
+	}
+	
+	// "Move from vertex <num> to <num>" optionally followed by "via <num> ..."
+	stringstream stream(line);
+	string word1, word2, word3, word4;
+	int ivertexFrom, ivertexTo;
+	stream >> word1 >> word2 >> word3 >> ivertexFrom >> word4 >> ivertexTo;
+	if (!stream || word1 != "Move" || word2 != "from" || word3 != "vertex" ||
+	    word4 != "to") return false;
+	
+	entry = RecordEntry(RECORD_MOVE, ivertexFrom, ivertexTo);
+	
+	string word;
+	if (!(stream >> word)) return true;
+	if (word != "via") return false;
+	
+	int ivertex;
+	while (stream >> ivertex) entry.path_.push_back(ivertex);
+	if (!stream.eof() || entry.path_.size()==0) return false;
+	entry.path_.push_back(ivertexTo);
+	
+	return true;
+}
+
+
+
+
+void BufferedRecordSink::recordMove(int ivertexFrom, int ivertexTo)
+{
+	entries_.push_back(RecordEntry(RECORD_MOVE, ivertexFrom, ivertexTo));
+}
+
+void BufferedRecordSink::recordMovePath(int ivertexFrom, vector<int> &path)
+{
+	entries_.push_back(RecordEntry(RECORD_MOVE, ivertexFrom, path.back()));
+	if (path.size()>1) entries_.back().path_ = path;
+}
+
+void BufferedRecordSink::recordUndo()
+{
+	entries_.push_back(RecordEntry(RECORD_UNDO, -1, -1));
+}
+
+void BufferedRecordSink::writeText(ostream &out)
+{
+	for (RecordEntry &entry : entries_) writeRecordEntry(out, entry);
+	out.flush();
+}
+
+
+
+
+AsyncFileRecordSink::AsyncFileRecordSink(string filename, bool storePaths,
+                                         int batchSize)
+: file_(filename), isOpen_(file_.is_open()), storePaths_(storePaths), 
+  batchSize_(batchSize), numPushed_(0), numWritten_(0),
+  flushRequested_(false), stop_(false)
+{
+	if (!isOpen_) 
+		cerr << "Could not open the record file " << filename 
+		     << ", the moves are not recorded" << endl;
+	
+	writer_ = thread(&AsyncFileRecordSink::writerLoop, this);
+}
+
+AsyncFileRecordSink::~AsyncFileRecordSink()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wakeWriter_.notify_one();
+	writer_.join();
+}
+
+void AsyncFileRecordSink::recordMove(int ivertexFrom, int ivertexTo)
+{
+	push(RecordEntry(RECORD_MOVE, ivertexFrom, ivertexTo));
+}
+
+void AsyncFileRecordSink::recordMovePath(int ivertexFrom, vector<int> &path)
+{
+	RecordEntry entry(RECORD_MOVE, ivertexFrom, path.back());
+	if (path.size()>1) entry.path_ = path;
+	push(entry);
+}
+
+void AsyncFileRecordSink::recordUndo()
+{
+	push(RecordEntry(RECORD_UNDO, -1, -1));
+}
+
+void AsyncFileRecordSink::push(RecordEntry entry)
+{
+	bool wake = false;
+	{
+		lock_guard<mutex> lock(mutex_);
+		pending_.push_back(entry);
+		numPushed_++;
+		wake = pending_.size() >= batchSize_;
+	}
+	if (wake) wakeWriter_.notify_one();
+}
+
+void AsyncFileRecordSink::flush()
+{
+	unique_lock<mutex> lock(mutex_);
+	long target = numPushed_;
+	flushRequested_ = true;
+	wakeWriter_.notify_one();
+	written_.wait(lock, [&]{return numWritten_ >= target;});
+}
+
+
+
+// Background thread writing the pending entries, either when a batch is
+// full, when a flush is requested, when the sink is destroyed or after
+// RECORD_WRITE_PERIOD_MS without any of these.
+
+void AsyncFileRecordSink::writerLoop()
+{
+	vector<RecordEntry> batch;
+	
+	while (true)
+	{
+		bool stop;
+		{
+			unique_lock<mutex> lock(mutex_);
+			wakeWriter_.wait_for(lock, 
+			                     chrono::milliseconds(RECORD_WRITE_PERIOD_MS),
+			                     [&]{return stop_ || flushRequested_ ||
+			                                pending_.size() >= batchSize_;});
+			batch.swap(pending_);
+			flushRequested_ = false;
+			stop = stop_;
+		}
+		
+		// the disk is accessed without holding the lock
+		if (isOpen_ && !batch.empty())
+		{
+			for (RecordEntry &entry : batch) writeRecordEntry(file_, entry);
+			file_.flush();
+		}
+		
+		{
+			lock_guard<mutex> lock(mutex_);
+			numWritten_ += batch.size();
+		}
+		written_.notify_all();
+		batch.clear();
+		
+		if (stop) break;
+	}
+}
+
+
+
+
+BinaryRecordSink::BinaryRecordSink(string filename, int boardType,
+                                   int boardSize, int nTeams, int seed,
+                                   bool storePaths)
+: file_(filename, ios::binary), offset_(sizeof(BinaryRecordHeader)),
+  failed_(!file_), closed_(false)
+{
+	memset(&header_, 0, sizeof(header_));
+	memcpy(header_.magic_, "CCRECBIN", 8);
+	header_.version_ = RECORD_BINARY_VERSION;
+	header_.boardType_ = boardType;
+	header_.boardSize_ = boardSize;
+	header_.nTeams_ = nTeams;
+	header_.seed_ = seed;
+	header_.flags_ = storePaths ? RECORD_FLAG_PATHS : 0;
+	
+	// written again with the number of games when closing
+	file_.write((char*)&header_, sizeof(header_));
+}
+
+BinaryRecordSink::~BinaryRecordSink()
+{
+	close();
+}
+
+void BinaryRecordSink::beginGame()
+{
+	gameOffsets_.push_back(offset_);
+	if (storesPaths()) gameFirstEntries_.push_back(entryOffsets_.size());
+}
+
+void BinaryRecordSink::recordMove(int ivertexFrom, int ivertexTo)
+{
+	vector<int> path(1,ivertexTo);
+	recordMovePath(ivertexFrom, path);
+}
+
+void BinaryRecordSink::recordMovePath(int ivertexFrom, vector<int> &path)
+{
+	vector<unsigned char> bytes;
+	bytes.push_back(ivertexFrom);
+	bytes.push_back(path.back());
+	
+	// intermediate landing vertices
+	if (storesPaths())
+	{
+		bytes.push_back(path.size()-1);
+		for (int i=0; i+1<path.size(); i++) bytes.push_back(path[i]);
+	}
+	
+	bool valid = ivertexFrom>=0 && ivertexFrom<RECORD_MAX_VERTICES &&
+	             path.size()<=RECORD_MAX_VERTICES;
+	for (int ivertex : path)
+		if (ivertex<0 || ivertex>=RECORD_MAX_VERTICES) valid = false;
+	
+	if (valid) writeBytes(bytes);
+	else failed_ = true;
+}
+
+void BinaryRecordSink::recordUndo()
+{
+	writeBytes(vector<unsigned char>(2,0xff));
+}
+
+void BinaryRecordSink::writeBytes(vector<unsigned char> bytes)
+{
+	if (closed_) return;
+	
+	// entries recorded before beginGame() belong to a first game
+	if (gameOffsets_.size()==0) beginGame();
+	
+	// each call writes one entry
+	if (storesPaths()) entryOffsets_.push_back(offset_-gameOffsets_.back());
+	
+	file_.write((char*)bytes.data(), bytes.size());
+	offset_ += bytes.size();
+}
+
+void BinaryRecordSink::flush()
+{
+	file_.flush();
+}
+
+// Write the index and the final header
+
+int BinaryRecordSink::close()
+{
+	if (closed_) return failed_;
+	closed_ = true;
+	
+	vector<uint64_t> index = gameOffsets_;
+	index.push_back(offset_);
+	
+	// the index is aligned on 8 bytes
+	while (offset_%8 != 0)
+	{
+		file_.put(0);
+		offset_++;
+	}
+	
+	header_.numGames_ = gameOffsets_.size();
+	header_.indexOffset_ = offset_;
+	file_.write((char*)index.data(), index.size()*sizeof(uint64_t));
+	
+	// index of the entries
+	if (storesPaths())
+	{
+		vector<uint64_t> firstEntries = gameFirstEntries_;
+		firstEntries.push_back(entryOffsets_.size());
+		file_.write((char*)firstEntries.data(), 
+		            firstEntries.size()*sizeof(uint64_t));
+		file_.write((char*)entryOffsets_.data(),
+		            entryOffsets_.size()*sizeof(uint32_t));
+	}
+	
+	file_.seekp(0);
+	file_.write((char*)&header_, sizeof(header_));
+	file_.close();
+	
+	if (!file_) failed_ = true;
+	return failed_;
+}
+
+
+
+
+BinaryRecordReader::~BinaryRecordReader()
+{
+	unmap();
+}
+
+void BinaryRecordReader::unmap()
+{
+	if (data_ != NULL) munmap((void*)data_, size_);
+	data_ = NULL;
+	index_ = NULL;
+	firstEntries_ = NULL;
+	entryOffsets_ = NULL;
+	size_ = 0;
+}
+
+int BinaryRecordReader::open(string filename)
+{
+	unmap();
+	
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd<0) return 1;
+	
+	struct stat status;
+	if (fstat(fd, &status)<0 || status.st_size<sizeof(BinaryRecordHeader))
+	{
+		::close(fd);
+		return 2;
+	}
+	
+	size_ = status.st_size;
+	void *data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		size_ = 0;
+		return 1;
+	}
+	data_ = (const unsigned char*)data;
+	
+	// check the header and that the index is inside the file
+	memcpy(&header_, data_, sizeof(header_));
+	uint64_t indexEnd = header_.indexOffset_
+	                  + (header_.numGames_+1)*sizeof(uint64_t);
+	bool versionKnown = header_.version_ == RECORD_BINARY_VERSION ||
+	                    (header_.version_ == 1 && !hasPaths());
+	if (memcmp(header_.magic_, "CCRECBIN", 8) != 0 || !versionKnown ||
+	    header_.indexOffset_%8 != 0 || indexEnd > size_)
+	{
+		unmap();
+		return 2;
+	}
+	index_ = (const uint64_t*)(data_+header_.indexOffset_);
+	
+	// check that the games are inside the entries
+	for (uint64_t i=0; i<header_.numGames_; i++)
+	{
+		if (index_[i] < sizeof(BinaryRecordHeader) || index_[i] > index_[i+1] ||
+		    index_[i+1] > header_.indexOffset_ ||
+		    (!hasPaths() && (index_[i+1]-index_[i])%2 != 0))
+		{
+			unmap();
+			return 2;
+		}
+	}
+	
+	if (hasPaths() && checkEntryIndex() != 0)
+	{
+		unmap();
+		return 2;
+	}
+	
+	return 0;
+}
+
+// Finds the index of the entries after the index of the games, and checks
+// that the entries it gives fill each game exactly (0 if they do)
+
+int BinaryRecordReader::checkEntryIndex()
+{
+	uint64_t numGames = header_.numGames_;
+	uint64_t firstEntriesOffset = header_.indexOffset_
+	                            + (numGames+1)*sizeof(uint64_t);
+	if (firstEntriesOffset + (numGames+1)*sizeof(uint64_t) > size_) return 1;
+	firstEntries_ = (const uint64_t*)(data_+firstEntriesOffset);
+	
+	uint64_t numEntries = firstEntries_[numGames];
+	uint64_t entryOffsetsOffset = firstEntriesOffset
+	                            + (numGames+1)*sizeof(uint64_t);
+	if (numEntries > size_ ||
+	    entryOffsetsOffset + numEntries*sizeof(uint32_t) > size_) return 1;
+	entryOffsets_ = (const uint32_t*)(data_+entryOffsetsOffset);
+	
+	for (uint64_t i=0; i<numGames; i++)
+	{
+		if (firstEntries_[i] > firstEntries_[i+1]) return 1;
+		
+		const unsigned char *game = data_+index_[i];
+		uint64_t gameSize = index_[i+1]-index_[i];
+		uint64_t offset = 0;
+		for (uint64_t k=firstEntries_[i]; k<firstEntries_[i+1]; k++)
+		{
+			if (entryOffsets_[k] != offset || offset+2 > gameSize) return 1;
+			
+			const unsigned char *bytes = game+offset;
+			if (bytes[0]==0xff && bytes[1]==0xff) offset += 2;
+			else if (offset+3 > gameSize) return 1;
+			else offset += 3+bytes[2];
+		}
+		if (offset != gameSize) return 1;
+	}
+	
+	return 0;
+}
+
+int BinaryRecordReader::getNumEntries(int igame)
+{
+	if (!hasPaths()) return (index_[igame+1]-index_[igame])/2;
+	return firstEntries_[igame+1]-firstEntries_[igame];
+}
+
+// In O(1), through the index of the entries with the paths
+
+RecordEntry BinaryRecordReader::getEntry(int igame, int ientry)
+{
+	const unsigned char *bytes = data_+index_[igame];
+	if (hasPaths()) bytes += entryOffsets_[firstEntries_[igame]+ientry];
+	else bytes += 2*ientry;
+	
+	if (bytes[0]==0xff && bytes[1]==0xff)
+		return RecordEntry(RECORD_UNDO, -1, -1);
+	
+	RecordEntry entry(RECORD_MOVE, bytes[0], bytes[1]);
+	
+	// intermediate landing vertices
+	if (hasPaths())
+	{
+		int n = bytes[2];
+		for (int i=0; i<n; i++) entry.path_.push_back(bytes[3+i]);
+		if (n>0) entry.path_.push_back(entry.ivertexTo_);
+	}
+	
+	return entry;
+}
+
+vector<RecordEntry> BinaryRecordReader::getEntries(int igame)
+{
+	vector<RecordEntry> entries;
+	int numEntries = getNumEntries(igame);
+	for (int i=0; i<numEntries; i++) entries.push_back(getEntry(igame, i));
+	
+	return entries;
+}
@@ -0,0 +1,234 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Header file for the recording of the moves of the chinese checkers  //
+//    game.                                                               //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Board::move hands the moves it performs to a record sink. The sink
+//	decides what to do with them
+//	o	NullRecordSink drops them (simulations)
+//	o	BufferedRecordSink keeps them in memory
+//	o	AsyncFileRecordSink writes them in a file from a background thread,
+//		by batches or at least every RECORD_WRITE_PERIOD_MS, so that the
+//		game never waits for the disk and loses little on a crash
+//	o	BinaryRecordSink writes them in the compact binary format below
+//	The text format of the files is unchanged: one line per entry,
+//	"Move from vertex <num> to <num>" or "Undo". Sinks that store the
+//	hops of the moves (storesPaths) append " via <num> <num> ..." with the
+//	intermediate landing vertices of the moves of several hops.
+//
+//	Binary format (little endian), for archives of many games
+//	o	header (48 bytes): "CCRECBIN", version, board type, board size,
+//		number of teams, seed, flags, number of games, offset of the index
+//	o	entries of all games, 2 bytes each: vertex from, vertex to
+//		(0xff 0xff for an undo)
+//	o	index: offset of each game in the file, plus the end of the last
+//	The index gives any game, and any move of a game, in O(1).
+//	With the flag RECORD_FLAG_PATHS, each move is followed by the number
+//	of intermediate landing vertices and these vertices (1 byte each).
+//	The entries then have different sizes, and the index is followed by
+//	an index of the entries so that they are still found in O(1)
+//	o	number of entries before each game, plus the total (8 bytes each)
+//	o	offset of each entry from the start of its game (4 bytes each)
+//	Version 1 files, without paths, have the layout of version 2.
+
+#ifndef RECORD
+#define RECORD
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdint.h>
+
+using namespace std;
+
+
+const int RECORD_MOVE = 0;
+const int RECORD_UNDO = 1;
+
+const int RECORD_WRITE_PERIOD_MS = 1000;   // of AsyncFileRecordSink
+
+class RecordEntry
+{
+	public:
+		RecordEntry(int type, int ivertexFrom, int ivertexTo)
+		: type_(type), ivertexFrom_(ivertexFrom), ivertexTo_(ivertexTo) {;}
+		
+		int type_;
+		int ivertexFrom_;  // -1 for an undo
+		int ivertexTo_;
+		vector<int> path_; // landing vertices of a move of several hops,
+		                   // destination included; empty otherwise
+};
+
+void writeRecordEntry(ostream &out, const RecordEntry &entry);
+bool readRecordEntry(string line, RecordEntry &entry);
+
+
+
+class RecordSink
+{
+	public:
+		virtual ~RecordSink() {;}
+		
+		virtual void recordMove(int ivertexFrom, int ivertexTo) = 0;
+		virtual void recordUndo() = 0;
+		virtual void flush() {;}
+		
+		// moves given with the vertices where the pawn lands (Board::findPath)
+		virtual bool storesPaths() {return false;}
+		virtual void recordMovePath(int ivertexFrom, vector<int> &path)
+		{
+			recordMove(ivertexFrom, path.back());
+		}
+};
+
+class NullRecordSink : public RecordSink
+{
+	public:
+		void recordMove(int ivertexFrom, int ivertexTo) {;}
+		void recordUndo() {;}
+};
+
+class BufferedRecordSink : public RecordSink
+{
+	public:
+		void recordMove(int ivertexFrom, int ivertexTo);
+		void recordUndo();
+		bool storesPaths() {return true;}
+		void recordMovePath(int ivertexFrom, vector<int> &path);
+		
+		vector<RecordEntry> getEntries() {return entries_;}
+		void writeText(ostream &out);
+		void clear() {entries_.clear();}
+	
+	protected:
+		vector<RecordEntry> entries_;
+};
+
+class AsyncFileRecordSink : public RecordSink
+{
+	public:
+		AsyncFileRecordSink(string filename, bool storePaths = false,
+		                    int batchSize = 256);
+		~AsyncFileRecordSink();
+		
+		void recordMove(int ivertexFrom, int ivertexTo);
+		void recordUndo();
+		bool storesPaths() {return storePaths_;}
+		void recordMovePath(int ivertexFrom, vector<int> &path);
+		void flush();  // returns once everything recorded is in the file
+		bool isOpen() {return isOpen_;}
+	
+	protected:
+		void push(RecordEntry entry);
+		void writerLoop();
+		
+		ofstream file_;
+		bool isOpen_;
+		bool storePaths_;
+		int batchSize_;
+		
+		mutex mutex_;
+		condition_variable wakeWriter_;
+		condition_variable written_;
+		vector<RecordEntry> pending_;
+		long numPushed_;
+		long numWritten_;
+		bool flushRequested_;
+		bool stop_;
+		
+		thread writer_;  // last member, started once the others are ready
+};
+
+
+
+const int RECORD_BOARD_HEXAGRAM = 0;
+const int RECORD_BINARY_VERSION = 2;
+const int RECORD_FLAG_PATHS = 1;
+const int RECORD_MAX_VERTICES = 255;  // vertex 255 is kept for the undos
+
+struct BinaryRecordHeader
+{
+	char magic_[8];
+	uint32_t version_;
+	uint32_t boardType_;
+	uint32_t boardSize_;
+	uint32_t nTeams_;
+	uint32_t seed_;
+	uint32_t flags_;
+	uint64_t numGames_;
+	uint64_t indexOffset_;
+};
+
+class BinaryRecordSink : public RecordSink
+{
+	public:
+		BinaryRecordSink(string filename, int boardType, int boardSize,
+		                 int nTeams, int seed, bool storePaths = false);
+		~BinaryRecordSink();
+		
+		void beginGame();
+		void recordMove(int ivertexFrom, int ivertexTo);
+		void recordUndo();
+		bool storesPaths() {return header_.flags_ & RECORD_FLAG_PATHS;}
+		void recordMovePath(int ivertexFrom, vector<int> &path);
+		void flush();
+		int close();  // 0 if all entries could be written, 1 otherwise
+	
+	protected:
+		void writeBytes(vector<unsigned char> bytes);
+		
+		ofstream file_;
+		BinaryRecordHeader header_;
+		vector<uint64_t> gameOffsets_;
+		vector<uint64_t> gameFirstEntries_;   // with paths only
+		vector<uint32_t> entryOffsets_;       // from the start of the game
+		uint64_t offset_;
+		bool failed_;
+		bool closed_;
+};
+
+// Read-only access to a binary record through a memory mapping
+class BinaryRecordReader
+{
+	public:
+		BinaryRecordReader() : data_(NULL), size_(0), index_(NULL),
+		                       firstEntries_(NULL), entryOffsets_(NULL) {;}
+		BinaryRecordReader(const BinaryRecordReader&) = delete;
+		~BinaryRecordReader();
+		
+		// Returns 0 on success, 1 if the file can't be opened and 2 if it
+		// is not a valid binary record
+		int open(string filename);
+		
+		BinaryRecordHeader getHeader() {return header_;}
+		bool hasPaths() {return header_.flags_ & RECORD_FLAG_PATHS;}
+		int getNumGames() {return header_.numGames_;}
+		int getNumEntries(int igame);
+		RecordEntry getEntry(int igame, int ientry);
+		vector<RecordEntry> getEntries(int igame);
+	
+	protected:
+		void unmap();
+		int checkEntryIndex();
+		
+		const unsigned char *data_;
+		size_t size_;
+		BinaryRecordHeader header_;
+		const uint64_t *index_;
+		const uint64_t *firstEntries_;     // with paths only
+		const uint32_t *entryOffsets_;
+};
+
+
+#endif
@@ -19,7 +19,20 @@
 #include <vector>
 #include <math.h>
 #include <random>
+#include <chrono>
 #include "Board.h"
+#include "instrumentation.h"
+#include "trace.h"
+#include "search.cpp"
+#include "evaluation.cpp"
+#include "endgame.cpp"
+#include "tablebase.cpp"
+#include "book.cpp"
+#include "evalCache.cpp"
+#include "assignment.cpp"
+#include "hopDistance.cpp"
+#include "boltzmann.cpp"
+#include "batchEval.cpp"
 
 using namespace std;
 
@@ -28,10 +41,12 @@ using namespace std;
 
 
 // Random number generator
+// one per thread so that games can be simulated in parallel, threads other
+// than the main one are expected to reseed theirs
 random_device true_gen;
 int seed = true_gen();
-default_random_engine gen(seed);
-uniform_real_distribution<double> dist01(0,1);
+thread_local default_random_engine gen(seed);
+thread_local uniform_real_distribution<double> dist01(0,1);
 
 // class for typical move
 class Move
@@ -42,7 +57,6 @@ class Move
 		
 		int ivertexFrom_;
 		int ivertexTo_;
-		double weight_;
 };
 
 // Algorithms (basic)
@@ -52,20 +66,109 @@ void bestMove0MinFree(Board&, int&, int&);
 
 // Algorithms (hamiltonian family)
 void algorithmHamiltonian(Board &board, int &ipawnToMove, int &ivertexDestination);
-double temperature = 0.1;
+thread_local double temperature = 0.1;
+thread_local BoltzmannSampler boltzmannSampler;
 double hamiltonianTarget(Board&, Move);
+double hamiltonianHopDistance(Board&, Move);
+
+// Hop distance fields (see hopDistance.cpp) of the position played by the
+// thread, and weight of their term in the hamiltonian. The term is off by
+// default (plain target hamiltonian), callers opt in by setting a weight
+// (0.5 won 130 of 197 games against the plain hamiltonian, 6 teams)
+thread_local HopDistanceFields hopFields;
+thread_local double hopDistanceWeight = 0;
+
 double hamiltonian(Board &board, Move move)
 {
-	return hamiltonianTarget(board, move);
+	double energy = hamiltonianTarget(board, move);
+	if (hopDistanceWeight != 0)
+		energy += hopDistanceWeight*hamiltonianHopDistance(board, move);
+	return energy;
 }
 
+// Hamiltonian using the linear evaluation (see evaluation.cpp), the weights
+// are per thread like the temperature, so that threads can play with
+// different weights
+void algorithmHamiltonianEval(Board &board, int &ipawnToMove,
+                              int &ivertexDestination);
+thread_local EvalWeights evalWeights;
+
+// Hamiltonian using the cost of the optimal assignment of the pawns to the
+// target vertices (see assignment.cpp), the assignments of the teams are
+// kept from turn to turn by the thread
+void algorithmHamiltonianAssignment(Board &board, int &ipawnToMove,
+                                    int &ivertexDestination);
+thread_local vector<TargetAssignment> teamAssignments;
+
+// Endgame solver (see endgame.cpp), the hamiltonian family uses it to
+// finish the last pawns of a team in the fewest moves
+thread_local EndgameSolver endgameSolver;
+thread_local bool useEndgameSolver = true;
+
+// Tablebases of the endings with two teams (see tablebase.cpp), used by
+// the hamiltonian family when enabled. Their values are the ones of a
+// restricted game where the pawns in their target don't move anymore, so
+// they are not perfect play in the real game and are off by default. Each
+// thread opens the file, the probes are not shared
+thread_local EndgameTablebase tablebase;
+thread_local bool useTablebase = false;
+
+// Opening book (see book.cpp), answers the known positions in algorithm()
+// before any algorithm; read only, shared by the threads
+OpeningBook openingBook;
+thread_local bool useOpeningBook = true;
+
+// Cache of the evaluations of the moves of bestMove0MinFree (see 
+// evalCache.cpp), per thread; the hamiltonian family evaluates its moves 
+// in a batch, which costs about as much as looking them up
+thread_local EvalCache minFreeCache;
+thread_local bool useEvalCache = true;
+
+// Evaluation of all the moves of a team at once (see batchEval.cpp), used
+// by bestMove0MinSum and algorithmHamiltonian when the hamiltonian is the
+// target and hop distance terms
+thread_local BatchEvaluator batchEvaluator;
+thread_local bool useBatchEvaluation = true;
+
+// latencies of the decisions taken through algorithm(), per thread
+thread_local LatencyLog moveLatencies;
+
 // generic algorithm function used to redirect to other ones
+// with bounded limits (time or nodes), the decision is taken by the search
+// within them; without limits, by the algorithm chosen below
+void algorithm(Board &board, int &ipawnToMove, int &ivertexDestination,
+               SearchLimits limits)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	// no random number is drawn without a book, the games stay the same
+	if (useOpeningBook && openingBook.isOpen() &&
+	    openingBook.lookup(board, dist01(gen), ipawnToMove, ivertexDestination))
+	{
+		chrono::duration<double> time = chrono::steady_clock::now() - start;
+		moveLatencies.add(time.count());
+		return;
+	}
+	
+	if (limits.bounded())
+		algorithmSearch(board, ipawnToMove, ivertexDestination, limits);
+	else
+	{
+		//randomMove(board, ipawnToMove, ivertexDestination);
+		//bestMove0MinSum(board, ipawnToMove, ivertexDestination);
+		//bestMove0MinFree(board, ipawnToMove, ivertexDestination);
+		algorithmHamiltonian(board, ipawnToMove, ivertexDestination);
+		//algorithmHamiltonianEval(board, ipawnToMove, ivertexDestination);
+		//algorithmHamiltonianAssignment(board, ipawnToMove, ivertexDestination);
+	}
+	
+	chrono::duration<double> time = chrono::steady_clock::now() - start;
+	moveLatencies.add(time.count());
+}
+
 void algorithm(Board &board, int &ipawnToMove, int &ivertexDestination)
 {
-	//randomMove(board, ipawnToMove, ivertexDestination);
-	//bestMove0MinSum(board, ipawnToMove, ivertexDestination);
-	//bestMove0MinFree(board, ipawnToMove, ivertexDestination);
-	algorithmHamiltonian(board, ipawnToMove, ivertexDestination);
+	algorithm(board, ipawnToMove, ivertexDestination, SearchLimits());
 }
 
 
@@ -77,9 +180,10 @@ void algorithm(Board &board, int &ipawnToMove, int &ivertexDestination)
 
 void randomMove(Board &board, int &ipawnToMove, int &ivertexDestination)
 {
-	#ifdef DEBUG
-	cout << "--- randomMove algorithm ---" << endl;
-	#endif
+	INSTRUMENT_SCOPE(PROBE_RANDOM_MOVE);
+	
+	TRACE_EVENT(TRACE_ALGORITHM_BEGIN, TRACE_RANDOM_MOVE, 
+	            board.getPlayingTeam(), 0);
 	
 	vector<Pawn> pawns = board.getPawns();
 	vector<Move> moves;
@@ -101,6 +205,9 @@ void randomMove(Board &board, int &ipawnToMove, int &ivertexDestination)
 	Move moveChosen = moves[int(moves.size()*dist01(gen))];
 	ipawnToMove = board.getPawnFromVertex(moveChosen.ivertexFrom_);
 	ivertexDestination = moveChosen.ivertexTo_;
+	
+	TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_RANDOM_MOVE, ipawnToMove, 
+	            ivertexDestination);
 }
 
 
@@ -123,12 +230,10 @@ double fitDistanceToTargets(Board &board, int ivertexFrom, int ivertexTo,
 	return distance1-distance2;
 }
 
-// Fit function using the distance to a free target vertex
-// Tweaked to limit moves from a target vertex 
-double fitDistanceToFreeTarget(Board &board, int ivertexFrom, int ivertexTo,
-                               int team)
+// Free target vertex chosen randomly by fitDistanceToFreeTarget
+// chose a occupied one if none are free (e.g. start of the game)
+int chooseFreeTarget(Board &board, int team)
 {
-	vector<Vertex> vertices = board.getVertices();
 	vector<int> targets = board.getTargetOfTeam(team);
 	
 	// find the free targets
@@ -137,13 +242,19 @@ double fitDistanceToFreeTarget(Board &board, int ivertexFrom, int ivertexTo,
 		if (board.getPawnFromVertex(itarget)<0)
 			freeTargets.push_back(itarget);
 	
-	// choose a free target randomly
-	// chose a occupied one if none are free (e.g. start of the game)
-	int itargetChosen;
 	if (freeTargets.size()>0)
-		itargetChosen = freeTargets[int(dist01(gen)*freeTargets.size())];
+		return freeTargets[int(dist01(gen)*freeTargets.size())];
 	else
-		itargetChosen = targets[int(dist01(gen)*targets.size())];
+		return targets[int(dist01(gen)*targets.size())];
+}
+
+// Fit function using the distance to the chosen target vertex
+// Tweaked to limit moves from a target vertex 
+double fitDistanceToChosenTarget(Board &board, int ivertexFrom, int ivertexTo,
+                                 int team, int itargetChosen)
+{
+	vector<Vertex> vertices = board.getVertices();
+	vector<int> targets = board.getTargetOfTeam(team);
 	
 	// distances to free target
 	int distance1 = 0;
@@ -160,15 +271,48 @@ double fitDistanceToFreeTarget(Board &board, int ivertexFrom, int ivertexTo,
 	return distance1-distance2;
 }
 
+// Fit function using the distance to a free target vertex
+double fitDistanceToFreeTarget(Board &board, int ivertexFrom, int ivertexTo,
+                               int team)
+{
+	int itargetChosen = chooseFreeTarget(board, team);
+	return fitDistanceToChosenTarget(board, ivertexFrom, ivertexTo, team,
+	                                 itargetChosen);
+}
+
+// Same with the fits stored in the cache of the thread, by move and chosen
+// target (the choice stays random); the fit doesn't depend on the other
+// pawns, and the chosen target gives the team (targets are disjoint)
+double fitDistanceToFreeTargetCached(Board &board, int ivertexFrom, 
+                                     int ivertexTo, int team)
+{
+	int itargetChosen = chooseFreeTarget(board, team);
+	if (!useEvalCache)
+		return fitDistanceToChosenTarget(board, ivertexFrom, ivertexTo, team,
+		                                 itargetChosen);
+	
+	double fit;
+	uint64_t key = EvalCache::key(board, ivertexFrom, ivertexTo, itargetChosen);
+	if (!minFreeCache.find(key, fit))
+	{
+		fit = fitDistanceToChosenTarget(board, ivertexFrom, ivertexTo, team,
+		                                itargetChosen);
+		minFreeCache.store(key, fit);
+	}
+	
+	return fit;
+}
+
 
 
 // Choose best move looking 0 steps ahead (immediate best move)
 // this one tries to minimise the summed distances to the target vertices
 void bestMove0MinSum(Board &board, int &ipawnToMove, int &ivertexDestination)
 {
-	#ifdef DEBUG
-	cout << "--- bestMove0MinSum algorithm ---" << endl;
-	#endif
+	INSTRUMENT_SCOPE(PROBE_BEST_MOVE0_MIN_SUM);
+	
+	TRACE_EVENT(TRACE_ALGORITHM_BEGIN, TRACE_BEST_MOVE0_MIN_SUM, 
+	            board.getPlayingTeam(), 0);
 	
 	vector<Pawn> pawns = board.getPawns();
 	vector<Move> moves;
@@ -187,21 +331,30 @@ void bestMove0MinSum(Board &board, int &ipawnToMove, int &ivertexDestination)
 			moves.push_back(Move(ivertexFrom, ivertexTo));
 	}
 	
+	// fit of each move
+	vector<double> fits(moves.size());
+	if (useBatchEvaluation)
+	{
+		MoveBatch batch;
+		for (Move move : moves) batch.add(move.ivertexFrom_, move.ivertexTo_);
+		batchEvaluator.fitDistanceToTargets(board, batch, pteam, fits);
+	}
+	else
+		for (int i=0; i<moves.size(); i++)
+			fits[i] = fitDistanceToTargets(board, moves[i].ivertexFrom_,
+			                               moves[i].ivertexTo_, pteam);
+	
 	// initialise best move
 	Move moveBest = moves[0];
-	double bestFit = fitDistanceToTargets(board, moveBest.ivertexFrom_, 
-	                                      moveBest.ivertexTo_, pteam);
+	double bestFit = fits[0];
 	
-	for (Move move : moves)
+	for (int i=0; i<moves.size(); i++)
 	{
-		double fit = fitDistanceToTargets(board, move.ivertexFrom_,
-		                                  move.ivertexTo_, pteam);
+		Move move = moves[i];
+		double fit = fits[i];
 		
-		#ifdef DEBUG
-		cout << "move from " << move.ivertexFrom_
-		     << " to " << move.ivertexTo_ << " : "
-		     << "fit = " << fit << endl;
-		#endif
+		TRACE_EVENT(TRACE_CANDIDATE, move.ivertexFrom_, move.ivertexTo_,
+		            int(1000*fit));
 		
 		if (fit > bestFit) 
 		{
@@ -223,6 +376,9 @@ void bestMove0MinSum(Board &board, int &ipawnToMove, int &ivertexDestination)
 	// return best move
 	ipawnToMove = board.getPawnFromVertex(moveBest.ivertexFrom_);
 	ivertexDestination = moveBest.ivertexTo_;
+	
+	TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_BEST_MOVE0_MIN_SUM, ipawnToMove, 
+	            ivertexDestination);
 }
 
 
@@ -230,9 +386,10 @@ void bestMove0MinSum(Board &board, int &ipawnToMove, int &ivertexDestination)
 // this one tries to minimise the distance to a free target vertex
 void bestMove0MinFree(Board &board, int &ipawnToMove, int &ivertexDestination)
 {
-	#ifdef DEBUG
-	cout << "--- bestMove0MinFree algorithm ---" << endl;
-	#endif
+	INSTRUMENT_SCOPE(PROBE_BEST_MOVE0_MIN_FREE);
+	
+	TRACE_EVENT(TRACE_ALGORITHM_BEGIN, TRACE_BEST_MOVE0_MIN_FREE, 
+	            board.getPlayingTeam(), 0);
 	
 	vector<Pawn> pawns = board.getPawns();
 	vector<Move> moves;
@@ -253,19 +410,16 @@ void bestMove0MinFree(Board &board, int &ipawnToMove, int &ivertexDestination)
 	
 	// initialise best move
 	Move moveBest = moves[0];
-	double bestFit = fitDistanceToFreeTarget(board, moveBest.ivertexFrom_,
-	                                         moveBest.ivertexTo_, pteam);
+	double bestFit = fitDistanceToFreeTargetCached(board, moveBest.ivertexFrom_,
+	                                               moveBest.ivertexTo_, pteam);
 	
 	for (Move move : moves)
 	{
-		double fit = fitDistanceToFreeTarget(board, move.ivertexFrom_, 
-		                                     move.ivertexTo_, pteam);
+		double fit = fitDistanceToFreeTargetCached(board, move.ivertexFrom_, 
+		                                           move.ivertexTo_, pteam);
 		
-		#ifdef DEBUG
-		cout << "move from " << move.ivertexFrom_
-		     << " to " << move.ivertexTo_ << " : "
-		     << "fit = " << fit << endl;
-		#endif
+		TRACE_EVENT(TRACE_CANDIDATE, move.ivertexFrom_, move.ivertexTo_,
+		            int(1000*fit));
 		
 		if (fit > bestFit) 
 		{
@@ -287,6 +441,9 @@ void bestMove0MinFree(Board &board, int &ipawnToMove, int &ivertexDestination)
 	// return best move
 	ipawnToMove = board.getPawnFromVertex(moveBest.ivertexFrom_);
 	ivertexDestination = moveBest.ivertexTo_;
+	
+	TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_BEST_MOVE0_MIN_FREE, ipawnToMove, 
+	            ivertexDestination);
 }
 
 
@@ -319,15 +476,129 @@ double hamiltonianTarget(Board& board, Move move)
 
 
 
+// Change of the number of moves to the target of the moved pawn, from the
+// hop distance field of the playing team (hopFields has to be updated to
+// the board); a vertex from which the target can't be reached counts as
+// far as the number of vertices
+
+double hamiltonianHopDistance(Board& board, Move move)
+{
+	vector<int> &field = hopFields.field(board.getPlayingTeam());
+	int nVertices = field.size();
+	
+	int distance1 = field[move.ivertexFrom_]>=0 ? field[move.ivertexFrom_] 
+	                                            : nVertices;
+	int distance2 = field[move.ivertexTo_]>=0 ? field[move.ivertexTo_] 
+	                                          : nVertices;
+	
+	return distance2-distance1;
+}
+
+
+
 
 void algorithmHamiltonian(Board &board, int &ipawnToMove, int &ivertexDestination)
 {
-	#ifdef DEBUG
-	cout << "--- generic hamiltonian algorithm ---" << endl;
-	#endif
+	INSTRUMENT_SCOPE(PROBE_HAMILTONIAN);
+	
+	TRACE_EVENT(TRACE_ALGORITHM_BEGIN, TRACE_HAMILTONIAN, 
+	            board.getPlayingTeam(), 0);
+	
+	// endings known by the tablebases, last pawns of the team
+	if ((useTablebase && 
+	     tablebase.probe(board, ipawnToMove, ivertexDestination)) ||
+	    (useEndgameSolver && 
+	     endgameSolver.solve(board, ipawnToMove, ivertexDestination)))
+	{
+		TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_HAMILTONIAN, ipawnToMove, 
+		            ivertexDestination);
+		return;
+	}
+	
+	vector<Pawn> pawns = board.getPawns();
+	vector<Move> moves;
+	int pteam = board.getPlayingTeam();
+	
+	// compute available moves
+	for (int ipawn=0; ipawn<pawns.size(); ipawn++)
+	{
+		if (pawns[ipawn].getTeam() != pteam) continue;
+		
+		int ivertexFrom = board.getVertexFromPawn(ipawn);
+		
+		for (int ivertexTo: board.availableMovesDirect(ivertexFrom))
+			moves.push_back(Move(ivertexFrom, ivertexTo));
+		for (int ivertexTo: board.availableMovesHopping(ivertexFrom))
+			moves.push_back(Move(ivertexFrom, ivertexTo));
+	}
+	
+	// fields of the position, once for all the moves
+	if (hopDistanceWeight != 0) hopFields.update(board);
+	
+	// compute energy of each move, all at once (same terms as hamiltonian())
+	// or one by one
+	vector<double> energies(moves.size());
+	if (useBatchEvaluation)
+	{
+		MoveBatch batch;
+		for (Move move : moves) batch.add(move.ivertexFrom_, move.ivertexTo_);
+		vector<int> noField;
+		vector<int> &field = hopDistanceWeight != 0 ? hopFields.field(pteam)
+		                                            : noField;
+		batchEvaluator.hamiltonianEnergies(board, batch, field, 
+		                                   hopDistanceWeight, energies);
+	}
+	else
+		for (int i=0; i<moves.size(); i++)
+			energies[i] = hamiltonian(board, moves[i]);
+	
+	for (int i=0; i<moves.size(); i++)
+		TRACE_EVENT(TRACE_CANDIDATE, moves[i].ivertexFrom_, moves[i].ivertexTo_,
+		            int(1000*energies[i]));
+	
+	// select move to perform
+	int ichosen = boltzmannSampler.sample(energies, temperature, dist01(gen));
+	if (ichosen >= 0)
+	{
+		Move move = moves[ichosen];
+		ipawnToMove = board.getPawnFromVertex(move.ivertexFrom_);
+		ivertexDestination = move.ivertexTo_;
+		
+		TRACE_EVENT(TRACE_SELECTED, move.ivertexFrom_, move.ivertexTo_, 0);
+	}
+	
+	TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_HAMILTONIAN, ipawnToMove, 
+	            ivertexDestination);
+}
+
+
+
+
+// Energy of a move is the change of the evaluation of the playing team,
+// i.e. of its estimated number of moves to reach the target
+
+void algorithmHamiltonianEval(Board &board, int &ipawnToMove,
+                              int &ivertexDestination)
+{
+	INSTRUMENT_SCOPE(PROBE_HAMILTONIAN_EVAL);
+	
+	TRACE_EVENT(TRACE_ALGORITHM_BEGIN, TRACE_HAMILTONIAN_EVAL, 
+	            board.getPlayingTeam(), 0);
+	
+	// endings known by the tablebases, last pawns of the team
+	if ((useTablebase && 
+	     tablebase.probe(board, ipawnToMove, ivertexDestination)) ||
+	    (useEndgameSolver && 
+	     endgameSolver.solve(board, ipawnToMove, ivertexDestination)))
+	{
+		TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_HAMILTONIAN_EVAL, ipawnToMove, 
+		            ivertexDestination);
+		return;
+	}
 	
 	vector<Pawn> pawns = board.getPawns();
 	vector<Move> moves;
+	vector<int> movePawns;
 	int pteam = board.getPlayingTeam();
 	
 	// compute available moves
@@ -338,46 +609,140 @@ void algorithmHamiltonian(Board &board, int &ipawnToMove, int &ivertexDestinatio
 		int ivertexFrom = board.getVertexFromPawn(ipawn);
 		
 		for (int ivertexTo: board.availableMovesDirect(ivertexFrom))
+		{
 			moves.push_back(Move(ivertexFrom, ivertexTo));
+			movePawns.push_back(ipawn);
+		}
 		for (int ivertexTo: board.availableMovesHopping(ivertexFrom))
+		{
 			moves.push_back(Move(ivertexFrom, ivertexTo));
+			movePawns.push_back(ipawn);
+		}
 	}
 	
-	// compute weight of each move
-	double sumWeights = 0;
+	// evaluation of the current position
+	EvalFeatures evalFeatures(board);
+	vector<int> pawnVertices = board.getPawnVertices();
+	double features[EVAL_NUM_FEATURES];
+	evalFeatures.compute(pawnVertices, pteam, features);
+	double value = evalWeights.evaluate(features);
+	
+	// compute energy of each move
+	vector<double> energies(moves.size());
 	for (int i=0; i<moves.size(); i++)
 	{
-		double energy = hamiltonian(board, moves[i]);
-		moves[i].weight_ = exp(-energy/temperature);
-		sumWeights += moves[i].weight_;
+		pawnVertices[movePawns[i]] = moves[i].ivertexTo_;
+		evalFeatures.compute(pawnVertices, pteam, features);
+		pawnVertices[movePawns[i]] = moves[i].ivertexFrom_;
+		
+		double energy = evalWeights.evaluate(features) - value;
+		energies[i] = energy;
 		
-		#ifdef DEBUG
-		cout << "move from " << moves[i].ivertexFrom_
-		     << " to " << moves[i].ivertexTo_ << " : "
-		     << "energy = " << energy 
-		     << " weight = " << moves[i].weight_ << endl;
-		#endif
+		TRACE_EVENT(TRACE_CANDIDATE, moves[i].ivertexFrom_, moves[i].ivertexTo_,
+		            int(1000*energy));
 	}
 	
 	// select move to perform
-	double ran = dist01(gen);
-	double cumulatedProba = 0;
-	for (Move move : moves)
+	int ichosen = boltzmannSampler.sample(energies, temperature, dist01(gen));
+	if (ichosen >= 0)
+	{
+		Move move = moves[ichosen];
+		ipawnToMove = board.getPawnFromVertex(move.ivertexFrom_);
+		ivertexDestination = move.ivertexTo_;
+		
+		TRACE_EVENT(TRACE_SELECTED, move.ivertexFrom_, move.ivertexTo_, 0);
+	}
+	
+	TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_HAMILTONIAN_EVAL, ipawnToMove, 
+	            ivertexDestination);
+}
+
+
+
+
+// Energy of a move is the change of the cost of the optimal assignment of
+// the pawns of the playing team to its target vertices, each candidate
+// scored by an update of the assignment instead of a full solve, and the
+// assignment itself updated by the move of the team since its last turn
+
+void algorithmHamiltonianAssignment(Board &board, int &ipawnToMove,
+                                    int &ivertexDestination)
+{
+	INSTRUMENT_SCOPE(PROBE_HAMILTONIAN_ASSIGNMENT);
+	
+	TRACE_EVENT(TRACE_ALGORITHM_BEGIN, TRACE_HAMILTONIAN_ASSIGNMENT, 
+	            board.getPlayingTeam(), 0);
+	
+	// assignment of the current position, updated from the last turn of
+	// the team (also when the endings below decide, so that it follows
+	// every move of the team)
+	int pteam = board.getPlayingTeam();
+	if (teamAssignments.size() != board.getNTeams())
+		teamAssignments.assign(board.getNTeams(), TargetAssignment());
+	TargetAssignment &assignment = teamAssignments[pteam];
+	assignment.update(board, pteam);
+	
+	// endings known by the tablebases, last pawns of the team
+	if ((useTablebase && 
+	     tablebase.probe(board, ipawnToMove, ivertexDestination)) ||
+	    (useEndgameSolver && 
+	     endgameSolver.solve(board, ipawnToMove, ivertexDestination)))
+	{
+		TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_HAMILTONIAN_ASSIGNMENT, 
+		            ipawnToMove, ivertexDestination);
+		return;
+	}
+	
+	vector<Pawn> pawns = board.getPawns();
+	vector<Move> moves;
+	vector<int> movePawns;
+	
+	// compute available moves
+	for (int ipawn=0; ipawn<pawns.size(); ipawn++)
 	{
-		cumulatedProba += move.weight_/sumWeights;
-		if (ran < cumulatedProba) 
+		if (pawns[ipawn].getTeam() != pteam) continue;
+		
+		int ivertexFrom = board.getVertexFromPawn(ipawn);
+		
+		for (int ivertexTo: board.availableMovesDirect(ivertexFrom))
+		{
+			moves.push_back(Move(ivertexFrom, ivertexTo));
+			movePawns.push_back(ipawn);
+		}
+		for (int ivertexTo: board.availableMovesHopping(ivertexFrom))
 		{
-			ipawnToMove = board.getPawnFromVertex(move.ivertexFrom_);
-			ivertexDestination = move.ivertexTo_;
-			
-			#ifdef DEBUG
-			cout << "selected move from " << move.ivertexFrom_
-				 << " to " << move.ivertexTo_ << endl;
-			#endif
-			
-			break;
+			moves.push_back(Move(ivertexFrom, ivertexTo));
+			movePawns.push_back(ipawn);
 		}
 	}
+	
+	int cost = assignment.getCost();
+	
+	// compute energy of each move
+	vector<double> energies(moves.size());
+	for (int i=0; i<moves.size(); i++)
+	{
+		double energy = assignment.costAfterMove(movePawns[i], 
+		                                         moves[i].ivertexTo_) - cost;
+		energies[i] = energy;
+		
+		TRACE_EVENT(TRACE_CANDIDATE, moves[i].ivertexFrom_, moves[i].ivertexTo_,
+		            int(1000*energy));
+	}
+	
+	// select move to perform
+	int ichosen = boltzmannSampler.sample(energies, temperature, dist01(gen));
+	if (ichosen >= 0)
+	{
+		Move move = moves[ichosen];
+		ipawnToMove = board.getPawnFromVertex(move.ivertexFrom_);
+		ivertexDestination = move.ivertexTo_;
+		
+		TRACE_EVENT(TRACE_SELECTED, move.ivertexFrom_, move.ivertexTo_, 0);
+	}
+	
+	TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_HAMILTONIAN_ASSIGNMENT, ipawnToMove, 
+	            ivertexDestination);
 }
 
 
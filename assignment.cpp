@@ -0,0 +1,312 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the assignment of the pawns to the target   //
+//    vertices of the chinese checkers game.                              //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Each pawn of a team has to end on its own target vertex. The cost of an
+//	assignment of the pawns to the target vertices is the summed distances
+//	of the pawns to their vertex, and the smallest cost over the
+//	assignments estimates the moves the team still needs (a better one
+//	than the distances to a single vertex, which ignore that the pawns
+//	fill different vertices).
+//
+//	The optimal assignment is found by the Hungarian method in O(n^3) for
+//	n pawns, which keeps potentials u (pawns) and v (targets) such that
+//	u_i+v_j <= cost_ij, equality on the assigned pairs. When a single pawn
+//	moves, its row of costs changes: its pair is removed, its potential is
+//	lowered until the row is feasible again, and one augmenting path from
+//	it (Dijkstra on the reduced costs) gives the new optimal assignment in
+//	O(n^2). Candidate moves are scored this way on copies of the
+//	potentials, without changing the assignment.
+//
+//	The assignment of a team is kept from a turn of the team to the next:
+//	its pawns only change by its own move, a single pawn, which is applied
+//	by the update of one augmenting path instead of a full solve.
+
+
+#ifndef ASSIGNMENT
+#define ASSIGNMENT
+
+#include <vector>
+#include <limits.h>
+#include "Board.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+// Assignment of the pawns of a team, for the position of the board at
+// construction (or at the last reset) followed by the moves given to
+// move(); the board only has to keep its geometry
+class TargetAssignment
+{
+	public:
+		TargetAssignment() : board_(NULL), team_(-1), n_(0), numFullSolves_(0),
+		                     numIncrementalUpdates_(0) {;}
+		TargetAssignment(Board &board, int team);
+		
+		// full solve for the current position of the board
+		void reset();
+		
+		// Follows the position of a board of the same geometry (e.g. a copy
+		// of the previous one): a single pawn of the team that moved is an
+		// incremental update, anything else a full solve
+		void update(Board &board, int team);
+		
+		// summed distances of the optimal assignment
+		int getCost() {return cost_;}
+		int getTargetOfPawn(int ipawn);
+		
+		// Cost of the optimal assignment if the pawn (of the team) was on
+		// ivertexTo, the assignment is unchanged
+		int costAfterMove(int ipawn, int ivertexTo);
+		
+		// Updates the assignment after a move of a pawn of the team
+		void move(int ipawn, int ivertexTo);
+		
+		long getNumFullSolves() {return numFullSolves_;}
+		long getNumIncrementalUpdates() {return numIncrementalUpdates_;}
+	
+	protected:
+		void init(Board &board, int team);
+		void setRow(int row, int ivertex);
+		void augment(int row, vector<int> &u, vector<int> &v,
+		             vector<int> &match);
+		void removeRow(int row, vector<int> &u, vector<int> &v,
+		              vector<int> &match);
+		int summedCosts(vector<int> &match);
+		
+		Board *board_;
+		int team_;
+		int n_;                          // pawns per team
+		vector<int> targets_;
+		vector<int> pawnVertices_;       // vertex of the pawn of each row
+		vector<int> costs_;              // n x n, row of a pawn
+		
+		// potentials and pairs, 1-indexed (column 0 is the start of the
+		// augmenting paths), match[j] the row of target j, 0 if none
+		vector<int> u_;
+		vector<int> v_;
+		vector<int> match_;
+		int cost_;
+		
+		// work arrays of the augmenting paths
+		vector<int> minReduced_;
+		vector<int> way_;
+		vector<char> used_;
+		
+		// copies of the potentials for the candidate moves
+		vector<int> uCopy_;
+		vector<int> vCopy_;
+		vector<int> matchCopy_;
+		
+		long numFullSolves_;
+		long numIncrementalUpdates_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+TargetAssignment::TargetAssignment(Board &board, int team)
+: numFullSolves_(0), numIncrementalUpdates_(0)
+{
+	init(board, team);
+}
+
+void TargetAssignment::init(Board &board, int team)
+{
+	board_ = &board;
+	team_ = team;
+	n_ = board.getNPawnsPerTeam();
+	targets_ = board.getTargetOfTeam(team);
+	pawnVertices_.assign(n_,0);
+	costs_.assign(n_*n_,0);
+	u_.assign(n_+1,0);
+	v_.assign(n_+1,0);
+	match_.assign(n_+1,0);
+	minReduced_.assign(n_+1,0);
+	way_.assign(n_+1,0);
+	used_.assign(n_+1,0);
+	
+	reset();
+}
+
+void TargetAssignment::setRow(int row, int ivertex)
+{
+	for (int j=0; j<n_; j++)
+		costs_[row*n_+j] = board_->vertexDistance(ivertex, targets_[j]);
+}
+
+void TargetAssignment::reset()
+{
+	for (int row=0; row<n_; row++)
+	{
+		pawnVertices_[row] = board_->getVertexFromPawn(team_*n_+row);
+		setRow(row, pawnVertices_[row]);
+	}
+	
+	for (int j=0; j<=n_; j++) {u_[j] = 0; v_[j] = 0; match_[j] = 0;}
+	for (int row=0; row<n_; row++) augment(row, u_, v_, match_);
+	
+	cost_ = summedCosts(match_);
+	numFullSolves_++;
+}
+
+void TargetAssignment::update(Board &board, int team)
+{
+	if (board_ == NULL || team != team_ ||
+	    board.getNPawnsPerTeam() != n_ ||
+	    board.getTargetOfTeam(team) != targets_)
+	{
+		init(board, team);
+		return;
+	}
+	board_ = &board;
+	
+	// pawns of the team that moved since the last update
+	int rowMoved = -1;
+	int numMoved = 0;
+	for (int row=0; row<n_; row++)
+		if (board.getVertexFromPawn(team_*n_+row) != pawnVertices_[row])
+		{
+			rowMoved = row;
+			numMoved++;
+		}
+	
+	if (numMoved == 1)
+	{
+		move(team_*n_+rowMoved, board.getVertexFromPawn(team_*n_+rowMoved));
+		numIncrementalUpdates_++;
+	}
+	else if (numMoved > 1) reset();
+}
+
+int TargetAssignment::getTargetOfPawn(int ipawn)
+{
+	int row = ipawn-team_*n_;
+	for (int j=1; j<=n_; j++)
+		if (match_[j] == row+1) return targets_[j-1];
+	return -1;
+}
+
+
+
+// Shortest augmenting path from the unassigned row, the potentials are
+// updated so that the reduced costs stay non-negative and the path tight
+
+void TargetAssignment::augment(int row, vector<int> &u, vector<int> &v,
+                               vector<int> &match)
+{
+	match[0] = row+1;
+	int j0 = 0;
+	for (int j=0; j<=n_; j++) {minReduced_[j] = INT_MAX; used_[j] = 0;}
+	
+	do
+	{
+		used_[j0] = 1;
+		int i0 = match[j0];
+		int delta = INT_MAX;
+		int j1 = 0;
+		
+		for (int j=1; j<=n_; j++)
+		{
+			if (used_[j]) continue;
+			
+			int reduced = costs_[(i0-1)*n_+j-1]-u[i0]-v[j];
+			if (reduced < minReduced_[j])
+			{
+				minReduced_[j] = reduced;
+				way_[j] = j0;
+			}
+			if (minReduced_[j] < delta) {delta = minReduced_[j]; j1 = j;}
+		}
+		
+		for (int j=0; j<=n_; j++)
+		{
+			if (used_[j]) {u[match[j]] += delta; v[j] -= delta;}
+			else minReduced_[j] -= delta;
+		}
+		
+		j0 = j1;
+	}
+	while (match[j0] != 0);
+	
+	// invert the pairs along the path
+	do
+	{
+		int j1 = way_[j0];
+		match[j0] = match[j1];
+		j0 = j1;
+	}
+	while (j0 != 0);
+}
+
+// Frees the target of the row and lowers its potential to the largest
+// feasible one (the costs of the row are the new ones)
+
+void TargetAssignment::removeRow(int row, vector<int> &u, vector<int> &v,
+                                 vector<int> &match)
+{
+	for (int j=1; j<=n_; j++)
+		if (match[j] == row+1) match[j] = 0;
+	
+	int potential = INT_MAX;
+	for (int j=1; j<=n_; j++)
+		potential = min(potential, costs_[row*n_+j-1]-v[j]);
+	u[row+1] = potential;
+}
+
+int TargetAssignment::summedCosts(vector<int> &match)
+{
+	int cost = 0;
+	for (int j=1; j<=n_; j++) cost += costs_[(match[j]-1)*n_+j-1];
+	return cost;
+}
+
+
+
+
+int TargetAssignment::costAfterMove(int ipawn, int ivertexTo)
+{
+	int row = ipawn-team_*n_;
+	
+	uCopy_ = u_;
+	vCopy_ = v_;
+	matchCopy_ = match_;
+	
+	setRow(row, ivertexTo);
+	removeRow(row, uCopy_, vCopy_, matchCopy_);
+	augment(row, uCopy_, vCopy_, matchCopy_);
+	int cost = summedCosts(matchCopy_);
+	setRow(row, pawnVertices_[row]);
+	
+	return cost;
+}
+
+void TargetAssignment::move(int ipawn, int ivertexTo)
+{
+	int row = ipawn-team_*n_;
+	
+	pawnVertices_[row] = ivertexTo;
+	setRow(row, ivertexTo);
+	removeRow(row, u_, v_, match_);
+	augment(row, u_, v_, match_);
+	cost_ = summedCosts(match_);
+}
+
+
+
+
+
+#endif
@@ -0,0 +1,285 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the batch evaluation of the candidate       //
+//    moves of the chinese checkers game.                                 //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The fitness terms of algorithm.cpp are differences, between the
+//	destination and the origin of a move, of a value per vertex: distance
+//	to the best target vertex, summed distances to the target vertices,
+//	hop distance. The candidate moves of a team are gathered in arrays of
+//	origins and destinations (structure of arrays), and each term is
+//	computed for all of them at once from a row of values per vertex,
+//	instead of a virtual distance call on copies of the vertices per move.
+//
+//	The kernel row[to[i]]-row[from[i]] has an AVX2 version (8 moves per
+//	instruction, gathers) and an SSE4.1 version (4 moves, loads inserted
+//	one by one), compiled for their target with function attributes and
+//	chosen at run time from the features of the processor; the scalar
+//	version is used elsewhere.
+
+
+#ifndef BATCH_EVAL
+#define BATCH_EVAL
+
+#include <vector>
+#include <string>
+#include "Board.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_EVAL_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const int BATCH_KERNEL_SCALAR = 0;
+const int BATCH_KERNEL_SSE4 = 1;
+const int BATCH_KERNEL_AVX2 = 2;
+
+// Kernels supported by the processor; the best one is used by default,
+// another supported one can be set (comparisons, benchmarks)
+bool batchKernelSupported(int kernel);
+void setBatchKernel(int kernel);
+int getBatchKernel();
+string batchKernelName(int kernel);
+
+// out[i] = row[to[i]]-row[from[i]] for the n moves
+void batchRowDifference(const int *row, const int *from, const int *to,
+                        int n, int *out);
+
+// Candidate moves of a team, origins and destinations in separate arrays
+class MoveBatch
+{
+	public:
+		void clear() {from_.clear(); to_.clear();}
+		void add(int ivertexFrom, int ivertexTo)
+		{from_.push_back(ivertexFrom); to_.push_back(ivertexTo);}
+		int size() {return from_.size();}
+		
+		vector<int> from_;
+		vector<int> to_;
+};
+
+// Fitness terms of all the moves of a batch. The rows that only depend on
+// the geometry of the board are kept until a board of another geometry
+// is evaluated.
+class BatchEvaluator
+{
+	public:
+		BatchEvaluator() : nVertices_(-1), nTeams_(-1) {;}
+		
+		// fitDistanceToTargets of the moves
+		void fitDistanceToTargets(Board &board, MoveBatch &moves, int team,
+		                          vector<double> &fits);
+		
+		// hamiltonian energies, the target term plus the hop distance term
+		// weighted by hopWeight (hopField of the playing team, ignored if
+		// the weight is 0)
+		void hamiltonianEnergies(Board &board, MoveBatch &moves,
+		                         vector<int> &hopField, double hopWeight,
+		                         vector<double> &energies);
+	
+	protected:
+		void prepare(Board &board);
+		
+		int nVertices_;
+		int nTeams_;
+		vector<vector<int>> summedDistances_;   // to the targets of a team
+		vector<int> hopRow_;
+		vector<int> differences_;
+		vector<int> differences2_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+void batchRowDifferenceScalar(const int *row, const int *from, const int *to,
+                              int n, int *out)
+{
+	for (int i=0; i<n; i++) out[i] = row[to[i]]-row[from[i]];
+}
+
+#ifdef BATCH_EVAL_X86
+
+__attribute__((target("sse4.1")))
+void batchRowDifferenceSSE4(const int *row, const int *from, const int *to,
+                            int n, int *out)
+{
+	int i = 0;
+	for (; i+4<=n; i+=4)
+	{
+		__m128i valuesTo = _mm_cvtsi32_si128(row[to[i]]);
+		valuesTo = _mm_insert_epi32(valuesTo, row[to[i+1]], 1);
+		valuesTo = _mm_insert_epi32(valuesTo, row[to[i+2]], 2);
+		valuesTo = _mm_insert_epi32(valuesTo, row[to[i+3]], 3);
+		
+		__m128i valuesFrom = _mm_cvtsi32_si128(row[from[i]]);
+		valuesFrom = _mm_insert_epi32(valuesFrom, row[from[i+1]], 1);
+		valuesFrom = _mm_insert_epi32(valuesFrom, row[from[i+2]], 2);
+		valuesFrom = _mm_insert_epi32(valuesFrom, row[from[i+3]], 3);
+		
+		_mm_storeu_si128((__m128i*)(out+i), _mm_sub_epi32(valuesTo, valuesFrom));
+	}
+	for (; i<n; i++) out[i] = row[to[i]]-row[from[i]];
+}
+
+__attribute__((target("avx2")))
+void batchRowDifferenceAVX2(const int *row, const int *from, const int *to,
+                            int n, int *out)
+{
+	int i = 0;
+	for (; i+8<=n; i+=8)
+	{
+		__m256i indicesTo = _mm256_loadu_si256((const __m256i*)(to+i));
+		__m256i indicesFrom = _mm256_loadu_si256((const __m256i*)(from+i));
+		__m256i valuesTo = _mm256_i32gather_epi32(row, indicesTo, 4);
+		__m256i valuesFrom = _mm256_i32gather_epi32(row, indicesFrom, 4);
+		
+		_mm256_storeu_si256((__m256i*)(out+i),
+		                    _mm256_sub_epi32(valuesTo, valuesFrom));
+	}
+	for (; i<n; i++) out[i] = row[to[i]]-row[from[i]];
+}
+
+#endif
+
+
+
+int detectBatchKernel()
+{
+	#ifdef BATCH_EVAL_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return BATCH_KERNEL_AVX2;
+	if (__builtin_cpu_supports("sse4.1")) return BATCH_KERNEL_SSE4;
+	#endif
+	
+	return BATCH_KERNEL_SCALAR;
+}
+
+// the processor is the same for all the threads, the kernel is global
+int batchKernelBest = detectBatchKernel();
+int batchKernel = batchKernelBest;
+
+bool batchKernelSupported(int kernel)
+{
+	return kernel >= BATCH_KERNEL_SCALAR && kernel <= batchKernelBest;
+}
+
+void setBatchKernel(int kernel)
+{
+	if (batchKernelSupported(kernel)) batchKernel = kernel;
+}
+
+int getBatchKernel()
+{
+	return batchKernel;
+}
+
+string batchKernelName(int kernel)
+{
+	if (kernel == BATCH_KERNEL_AVX2) return "AVX2";
+	if (kernel == BATCH_KERNEL_SSE4) return "SSE4.1";
+	return "scalar";
+}
+
+void batchRowDifference(const int *row, const int *from, const int *to,
+                        int n, int *out)
+{
+	#ifdef BATCH_EVAL_X86
+	if (batchKernel == BATCH_KERNEL_AVX2)
+		return batchRowDifferenceAVX2(row, from, to, n, out);
+	if (batchKernel == BATCH_KERNEL_SSE4)
+		return batchRowDifferenceSSE4(row, from, to, n, out);
+	#endif
+	
+	batchRowDifferenceScalar(row, from, to, n, out);
+}
+
+
+
+
+void BatchEvaluator::prepare(Board &board)
+{
+	int nVertices = board.getVertices().size();
+	int nTeams = board.getNTeams();
+	if (nVertices == nVertices_ && nTeams == nTeams_) return;
+	
+	summedDistances_.assign(nTeams, vector<int>(nVertices,0));
+	for (int team=0; team<nTeams; team++)
+		for (int itarget : board.getTargetOfTeam(team))
+		{
+			const int *row = board.distanceRow(itarget);
+			for (int i=0; i<nVertices; i++) summedDistances_[team][i] += row[i];
+		}
+	
+	nVertices_ = nVertices;
+	nTeams_ = nTeams;
+}
+
+void BatchEvaluator::fitDistanceToTargets(Board &board, MoveBatch &moves,
+                                          int team, vector<double> &fits)
+{
+	prepare(board);
+	
+	int n = moves.size();
+	differences_.resize(n);
+	batchRowDifference(summedDistances_[team].data(), moves.from_.data(),
+	                   moves.to_.data(), n, differences_.data());
+	
+	fits.resize(n);
+	for (int i=0; i<n; i++) fits[i] = -differences_[i];
+}
+
+void BatchEvaluator::hamiltonianEnergies(Board &board, MoveBatch &moves,
+                                         vector<int> &hopField,
+                                         double hopWeight,
+                                         vector<double> &energies)
+{
+	prepare(board);
+	
+	int n = moves.size();
+	int itarget = board.getBestTargets()[board.getPlayingTeam()];
+	assert(itarget>=0);
+	
+	differences_.resize(n);
+	batchRowDifference(board.distanceRow(itarget), moves.from_.data(),
+	                   moves.to_.data(), n, differences_.data());
+	
+	energies.resize(n);
+	if (hopWeight == 0)
+	{
+		for (int i=0; i<n; i++) energies[i] = differences_[i];
+		return;
+	}
+	
+	// unreachable vertices count as far as the number of vertices
+	hopRow_.resize(nVertices_);
+	for (int i=0; i<nVertices_; i++)
+		hopRow_[i] = hopField[i]>=0 ? hopField[i] : nVertices_;
+	
+	differences2_.resize(n);
+	batchRowDifference(hopRow_.data(), moves.from_.data(), moves.to_.data(),
+	                   n, differences2_.data());
+	
+	for (int i=0; i<n; i++)
+		energies[i] = differences_[i] + hopWeight*differences2_[i];
+}
+
+
+
+
+
+#endif
@@ -0,0 +1,397 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o benchmark benchmark.cpp Board.h \        //
+//                   Board.cpp Record.cpp -pthread                        //
+//    Run with     $ ./benchmark [output.json]                            //
+//                                                                        //
+//    This file is used for timing the hot paths of the board and of the  //
+//    algorithms. Each benchmark is warmed up, then repeated several      //
+//    times; the median and minimum times per call are reported and       //
+//    written in JSON format (default "analysis/benchmark.json") so that  //
+//    results of different versions can be archived and compared.         //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <chrono>
+#include <algorithm>
+#include "Board.h"
+#include "algorithm.cpp"
+
+using namespace std;
+
+
+const int BENCH_WARMUP = 2;       // repetitions not taken into account
+const int BENCH_REPETITIONS = 15;
+const double BENCH_MIN_TIME = 0.01; // target seconds per repetition
+
+// prevents the compiler from removing the benchmarked calls
+volatile long benchSink = 0;
+
+class BenchmarkResult
+{
+	public:
+		string name_;
+		long iterations_;    // calls per repetition
+		int repetitions_;
+		double medianNs_;    // time per call
+		double minNs_;
+};
+
+
+
+// Time the function. The number of calls per repetition is calibrated so
+// that a repetition lasts about BENCH_MIN_TIME.
+
+template <class Function>
+BenchmarkResult benchmark(string name, Function function)
+{
+	// calibration
+	long iterations = 1;
+	while (true)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (long i=0; i<iterations; i++) function();
+		chrono::duration<double> time = chrono::steady_clock::now()-start;
+		
+		if (time.count()>=BENCH_MIN_TIME || iterations>=(1L<<30)) break;
+		iterations *= 2;
+	}
+	
+	// repetitions
+	vector<double> times;
+	for (int r=0; r<BENCH_WARMUP+BENCH_REPETITIONS; r++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (long i=0; i<iterations; i++) function();
+		chrono::duration<double> time = chrono::steady_clock::now()-start;
+		
+		if (r>=BENCH_WARMUP) times.push_back(time.count()*1e9/iterations);
+	}
+	sort(times.begin(), times.end());
+	
+	BenchmarkResult result;
+	result.name_ = name;
+	result.iterations_ = iterations;
+	result.repetitions_ = BENCH_REPETITIONS;
+	result.medianNs_ = times[times.size()/2];
+	result.minNs_ = times[0];
+	
+	cout << name << "  median = " << result.medianNs_ << " ns"
+	     << "  min = " << result.minNs_ << " ns"
+	     << "  (" << iterations << " calls x " << BENCH_REPETITIONS << ")"
+	     << endl;
+	
+	return result;
+}
+
+
+
+void writeJSON(string filename, vector<BenchmarkResult> &results)
+{
+	ofstream file(filename);
+	
+	file << "{" << endl;
+	file << "  \"seed\": " << seed << "," << endl;
+	file << "  \"repetitions\": " << BENCH_REPETITIONS << "," << endl;
+	file << "  \"warmup\": " << BENCH_WARMUP << "," << endl;
+	file << "  \"benchmarks\": [" << endl;
+	
+	for (int i=0; i<results.size(); i++)
+	{
+		file << "    {\"name\": \"" << results[i].name_ << "\", "
+		     << "\"iterations\": " << results[i].iterations_ << ", "
+		     << "\"median_ns\": " << results[i].medianNs_ << ", "
+		     << "\"min_ns\": " << results[i].minNs_ << "}"
+		     << (i+1<results.size() ? "," : "") << endl;
+	}
+	
+	file << "  ]" << endl;
+	file << "}" << endl;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	/////////////////////////////// Files //////////////////////////////////
+	
+	if (system("mkdir -p analysis") != 0)
+	{
+		cerr << "Could not create the directory analysis" << endl;
+		return 1;
+	}
+	string outputFilename = "analysis/benchmark.json";
+	if (argc>1) outputFilename = argv[1];
+	NullRecordSink recordSink;
+	
+	// fixed seed so that the algorithms see the same positions every run
+	seed = 2020;
+	gen.seed(seed);
+	temperature = 0.3;
+	
+	///////////////////////////// Positions ////////////////////////////////
+	
+	// start position and a mid-game position of the standard board
+	Hexagram boardStart(6,3);
+	Hexagram boardMid(6,3);
+	for (int i=0; i<60; i++)
+	{
+		int ipawn, ivertex;
+		Hexagram boardCopy = boardMid;
+		algorithmHamiltonian(boardCopy, ipawn, ivertex);
+		boardMid.move(ipawn, ivertex, recordSink);
+	}
+	
+	vector<Vertex> vertices = boardMid.getVertices();
+	int nVertices = vertices.size();
+	int pteam = boardMid.getPlayingTeam();
+	int ipawnMid = -1;
+	for (int ipawn=0; ipawn<boardMid.getPawns().size(); ipawn++)
+		if (boardMid.getTeamOfPawn(ipawn)==pteam) ipawnMid = ipawn;
+	int ivertexMid = boardMid.getVertexFromPawn(ipawnMid);
+	
+	// a direct move and its reverse, played alternately
+	int ipawnStep = -1;
+	int ivertexStep1 = -1;
+	int ivertexStep2 = -1;
+	for (int ipawn=0; ipawn<boardStart.getPawns().size() && ivertexStep2<0; ipawn++)
+	{
+		vector<int> direct = boardStart.availableMovesDirect(
+		                     boardStart.getVertexFromPawn(ipawn));
+		if (direct.size()==0) continue;
+		ipawnStep = ipawn;
+		ivertexStep1 = boardStart.getVertexFromPawn(ipawn);
+		ivertexStep2 = direct[0];
+	}
+	
+	cout << endl;
+	cout << "=========== Benchmarks ============" << endl;
+	cout << endl;
+	
+	vector<BenchmarkResult> results;
+	
+	/////////////////////////////// Board //////////////////////////////////
+	
+	results.push_back(benchmark("Hexagram construction (6,3)", [&]()
+	{
+		Hexagram board(6,3);
+		benchSink += board.getPlayingTeam();
+	}));
+	
+	int i1 = 0;
+	results.push_back(benchmark("Hexagram::distance", [&]()
+	{
+		i1 = (i1+7)%nVertices;
+		benchSink += boardMid.distance(vertices[i1], vertices[(i1*5)%nVertices]);
+	}));
+	
+	results.push_back(benchmark("Board::vertexDistance", [&]()
+	{
+		i1 = (i1+7)%nVertices;
+		benchSink += boardMid.vertexDistance(i1, (i1*5)%nVertices);
+	}));
+	
+	results.push_back(benchmark("Board::relaxedDistance", [&]()
+	{
+		i1 = (i1+7)%nVertices;
+		benchSink += boardMid.relaxedDistance(i1, (i1*5)%nVertices);
+	}));
+	
+	results.push_back(benchmark("Hexagram::aligned", [&]()
+	{
+		i1 = (i1+7)%nVertices;
+		benchSink += boardMid.aligned(vertices[i1], vertices[(i1*5)%nVertices],
+		                              vertices[(i1*3)%nVertices]);
+	}));
+	
+	results.push_back(benchmark("Board::availableMovesDirect", [&]()
+	{
+		benchSink += boardMid.availableMovesDirect(ivertexMid).size();
+	}));
+	
+	results.push_back(benchmark("Board::availableMovesHopping", [&]()
+	{
+		benchSink += boardMid.availableMovesHopping(ivertexMid).size();
+	}));
+	
+	vector<int> numHops;
+	results.push_back(benchmark("Board::availableMovesHoppingBFS", [&]()
+	{
+		benchSink += boardMid.availableMovesHoppingBFS(ivertexMid, numHops).size();
+	}));
+	
+	Hexagram boardMove = boardStart;
+	bool forward = true;
+	results.push_back(benchmark("Board::move", [&]()
+	{
+		int ivertex = forward ? ivertexStep2 : ivertexStep1;
+		benchSink += boardMove.move(ipawnStep, ivertex, recordSink);
+		forward = !forward;
+	}));
+	
+	results.push_back(benchmark("Board::moveUnchecked", [&]()
+	{
+		if (forward) boardMove.moveUnchecked(ivertexStep1, ivertexStep2);
+		else boardMove.moveUnchecked(ivertexStep2, ivertexStep1);
+		forward = !forward;
+	}));
+	
+	results.push_back(benchmark("board copy (Hexagram)", [&]()
+	{
+		Hexagram boardCopy = boardMid;
+		benchSink += boardCopy.getPlayingTeam();
+	}));
+	
+	results.push_back(benchmark("Board::teamsOnTarget", [&]()
+	{
+		benchSink += boardMid.teamsOnTarget().size();
+	}));
+	
+	////////////////////////////// Algorithms //////////////////////////////
+	
+	int ipawn, ivertex;
+	int ivertexTo = boardMid.availableMovesDirect(ivertexMid).size()>0 ?
+	                boardMid.availableMovesDirect(ivertexMid)[0] : ivertexMid;
+	
+	results.push_back(benchmark("fitDistanceToTargets", [&]()
+	{
+		benchSink += fitDistanceToTargets(boardMid, ivertexMid, ivertexTo, pteam);
+	}));
+	
+	results.push_back(benchmark("fitDistanceToFreeTarget", [&]()
+	{
+		benchSink += fitDistanceToFreeTarget(boardMid, ivertexMid, ivertexTo,
+		                                     pteam);
+	}));
+	
+	results.push_back(benchmark("hamiltonianTarget", [&]()
+	{
+		benchSink += hamiltonianTarget(boardMid, Move(ivertexMid, ivertexTo));
+	}));
+	
+	results.push_back(benchmark("TargetAssignment (full solve)", [&]()
+	{
+		TargetAssignment assignment(boardMid, pteam);
+		benchSink += assignment.getCost();
+	}));
+	
+	TargetAssignment assignmentMid(boardMid, pteam);
+	results.push_back(benchmark("TargetAssignment::costAfterMove", [&]()
+	{
+		benchSink += assignmentMid.costAfterMove(ipawnMid, ivertexTo);
+	}));
+	
+	// candidate moves of the playing team, evaluated one by one and as a
+	// batch with each kernel the processor supports
+	vector<Move> movesMid;
+	MoveBatch batchMid;
+	for (int ipawn=0; ipawn<boardMid.getPawns().size(); ipawn++)
+	{
+		if (boardMid.getTeamOfPawn(ipawn) != pteam) continue;
+		int ivertexFrom = boardMid.getVertexFromPawn(ipawn);
+		vector<int> destinations = boardMid.availableMovesDirect(ivertexFrom);
+		for (int ivertex2 : boardMid.availableMovesHopping(ivertexFrom))
+			destinations.push_back(ivertex2);
+		for (int ivertex2 : destinations)
+		{
+			movesMid.push_back(Move(ivertexFrom, ivertex2));
+			batchMid.add(ivertexFrom, ivertex2);
+		}
+	}
+	hopFields.update(boardMid);
+	vector<int> &hopFieldMid = hopFields.field(pteam);
+	vector<double> energiesMid(movesMid.size());
+	
+	results.push_back(benchmark("hamiltonian energies (per move)", [&]()
+	{
+		for (int i=0; i<movesMid.size(); i++)
+			energiesMid[i] = hamiltonian(boardMid, movesMid[i]);
+		benchSink += energiesMid[0];
+	}));
+	
+	int batchKernelDefault = getBatchKernel();
+	for (int kernel=BATCH_KERNEL_SCALAR; kernel<=BATCH_KERNEL_AVX2; kernel++)
+	{
+		if (!batchKernelSupported(kernel)) continue;
+		setBatchKernel(kernel);
+		
+		results.push_back(benchmark("hamiltonian energies (batch, " 
+		                            + batchKernelName(kernel) + ")", [&]()
+		{
+			batchEvaluator.hamiltonianEnergies(boardMid, batchMid, hopFieldMid,
+			                                   hopDistanceWeight, energiesMid);
+			benchSink += energiesMid[0];
+		}));
+	}
+	setBatchKernel(batchKernelDefault);
+	
+	results.push_back(benchmark("fitDistanceToTargets (all moves)", [&]()
+	{
+		for (int i=0; i<movesMid.size(); i++)
+			energiesMid[i] = fitDistanceToTargets(boardMid, movesMid[i].ivertexFrom_,
+			                                      movesMid[i].ivertexTo_, pteam);
+		benchSink += energiesMid[0];
+	}));
+	
+	results.push_back(benchmark("fitDistanceToTargets (batch)", [&]()
+	{
+		batchEvaluator.fitDistanceToTargets(boardMid, batchMid, pteam, 
+		                                    energiesMid);
+		benchSink += energiesMid[0];
+	}));
+	
+	results.push_back(benchmark("randomMove", [&]()
+	{
+		randomMove(boardMid, ipawn, ivertex);
+		benchSink += ivertex;
+	}));
+	
+	results.push_back(benchmark("bestMove0MinSum", [&]()
+	{
+		bestMove0MinSum(boardMid, ipawn, ivertex);
+		benchSink += ivertex;
+	}));
+	
+	results.push_back(benchmark("bestMove0MinFree", [&]()
+	{
+		bestMove0MinFree(boardMid, ipawn, ivertex);
+		benchSink += ivertex;
+	}));
+	
+	results.push_back(benchmark("algorithmHamiltonian", [&]()
+	{
+		algorithmHamiltonian(boardMid, ipawn, ivertex);
+		benchSink += ivertex;
+	}));
+	
+	results.push_back(benchmark("algorithmHamiltonianAssignment", [&]()
+	{
+		algorithmHamiltonianAssignment(boardMid, ipawn, ivertex);
+		benchSink += ivertex;
+	}));
+	
+	results.push_back(benchmark("algorithmSearch (1000 nodes)", [&]()
+	{
+		algorithmSearch(boardMid, ipawn, ivertex, SearchLimits(-1,1000));
+		benchSink += ivertex;
+	}));
+	
+	////////////////////////////// Output //////////////////////////////////
+	
+	writeJSON(outputFilename, results);
+	
+	cout << endl;
+	cout << "Results written to " << outputFilename << endl;
+	
+	return 0;
+}
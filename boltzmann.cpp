@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the Boltzmann selection of the moves of     //
+//    the chinese checkers game.                                          //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The algorithms of the hamiltonian family choose a move with a
+//	probability proportional to exp(-energy/temperature). The energies are
+//	shifted by the smallest one, which leaves the probabilities unchanged
+//	and keeps the weights within [0,1] (no overflow at low temperatures).
+//
+//	The energies are mostly on a grid of BOLTZMANN_STEP (integer distances,
+//	half a distance with the hop distance term), so the weights of the
+//	shifted energies are read in a table made for the temperature, and
+//	exp is only called for the energies out of the grid or of the table.
+//	The move is then found by a binary search in the prefix sums of the
+//	weights, the first move whose prefix sum exceeds ran times the total,
+//	as the cumulative scan did.
+
+
+#ifndef BOLTZMANN
+#define BOLTZMANN
+
+#include <vector>
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const double BOLTZMANN_STEP = 0.125;
+const int BOLTZMANN_TABLE_SIZE = 1024;   // shifted energies below 128
+
+class BoltzmannSampler
+{
+	public:
+		BoltzmannSampler() : temperature_(-1) {;}
+		
+		// Index chosen with a probability proportional to
+		// exp(-energy/temperature), ran uniform in [0,1), -1 if no energy
+		int sample(vector<double> &energies, double temperature, double ran);
+	
+	protected:
+		void prepare(double temperature);
+		double weight(double shiftedEnergy);
+		
+		double temperature_;             // of the table
+		vector<double> table_;           // exp(-k*BOLTZMANN_STEP/temperature)
+		vector<double> prefixSums_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+void BoltzmannSampler::prepare(double temperature)
+{
+	if (temperature == temperature_) return;
+	
+	table_.resize(BOLTZMANN_TABLE_SIZE);
+	for (int k=0; k<BOLTZMANN_TABLE_SIZE; k++)
+		table_[k] = exp(-k*BOLTZMANN_STEP/temperature);
+	
+	temperature_ = temperature;
+}
+
+inline double BoltzmannSampler::weight(double shiftedEnergy)
+{
+	double k = shiftedEnergy/BOLTZMANN_STEP;
+	int ik = int(k+0.5);
+	if (ik < BOLTZMANN_TABLE_SIZE && fabs(k-ik) < 1e-9) return table_[ik];
+	
+	return exp(-shiftedEnergy/temperature_);
+}
+
+int BoltzmannSampler::sample(vector<double> &energies, double temperature,
+                             double ran)
+{
+	prepare(temperature);
+	
+	int n = energies.size();
+	if (n == 0) return -1;
+	
+	double energyMin = energies[0];
+	for (int i=1; i<n; i++) energyMin = min(energyMin, energies[i]);
+	
+	prefixSums_.resize(n);
+	double sum = 0;
+	for (int i=0; i<n; i++)
+	{
+		sum += weight(energies[i]-energyMin);
+		prefixSums_[i] = sum;
+	}
+	
+	// first prefix sum above ran*sum, the last move if rounding gives none
+	int i = upper_bound(prefixSums_.begin(), prefixSums_.end(), ran*sum)
+	      - prefixSums_.begin();
+	return min(i, n-1);
+}
+
+
+
+
+
+#endif
@@ -0,0 +1,382 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the opening books of the chinese checkers   //
+//    game.                                                               //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The first moves of the simulated games (test_algorithms.cpp) are
+//	aggregated by class of symmetric positions (Board::getCanonicalHash),
+//	the moves being mapped onto the canonical position: for each move, the
+//	number of games and the summed score of the team that played it,
+//	(nTeams-rank)/(nTeams-1), from 1 for the winner to 0 for the last. The
+//	weight of a move is its summed score, so that the moves often played
+//	and often successful are preferred. All the moves are written, and the
+//	ones played in less than minGames games are ignored by the lookups;
+//	books of several runs are merged by adding their statistics.
+//
+//	File (data/book_<nTeams>_<size>.bk)
+//	o	header (48 bytes): "CCBOOK01", version, number of teams, board
+//		size, number of vertices, number of positions, number of moves,
+//		minGames, reserved
+//	o	positions sorted by hash (16 bytes): canonical hash of the position
+//		with the playing team, index of the first move, number of moves
+//	o	moves sorted by decreasing weight (12 bytes): vertex from, vertex
+//		to (of the canonical position), number of games, summed score
+//	A lookup is a binary search in the memory map.
+
+
+#ifndef BOOK
+#define BOOK
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Board.h"
+#include "instrumentation.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const int BOOK_VERSION = 2;
+
+struct BookHeader
+{
+	char magic_[8];
+	uint32_t version_;
+	uint32_t nTeams_;
+	uint32_t boardSize_;
+	uint32_t nVertices_;
+	uint64_t numPositions_;
+	uint64_t numMoves_;
+	uint32_t minGames_;
+	uint32_t reserved_;
+};
+
+struct BookPosition
+{
+	uint64_t hash_;
+	uint32_t firstMove_;
+	uint32_t numMoves_;
+};
+
+struct BookMove
+{
+	uint16_t ivertexFrom_;
+	uint16_t ivertexTo_;
+	uint32_t games_;
+	float score_;                    // weight of the move
+};
+
+// move of a game, kept until the ranks are known (canonical hash, the
+// vertices mapped by its symmetry)
+class BookGameMove
+{
+	public:
+		uint64_t hash_;
+		int team_;
+		int ivertexFrom_;
+		int ivertexTo_;
+};
+
+string openingBookFilename(int nTeams, int boardSize);
+
+// Statistics of the moves of many games, written as a book
+class OpeningBookBuilder
+{
+	public:
+		OpeningBookBuilder(int nTeams, int boardSize, int nVertices)
+		: nTeams_(nTeams), boardSize_(boardSize), nVertices_(nVertices) {;}
+		
+		// moves of a finished game and its winning order
+		void addGame(vector<BookGameMove> &moves, vector<int> winningOrder);
+		void merge(OpeningBookBuilder &builder);
+		
+		// Adds the statistics of a book file. Returns 0 on success, 1 if the
+		// file can't be opened and 2 if it is not a book of the same board
+		int load(string filename);
+		
+		// Writes the book, the lookups use the moves played in at least
+		// minGames games. Returns 0 on success, 1 if the file can't be
+		// written
+		int write(string filename, int minGames);
+		
+		long getNumPositions() {return positions_.size();}
+	
+	protected:
+		void add(uint64_t hash, BookMove &move);
+		
+		int nTeams_;
+		int boardSize_;
+		int nVertices_;
+		unordered_map<uint64_t,vector<BookMove>> positions_;
+};
+
+// Book read from a file, shared by the threads (read only)
+class OpeningBook
+{
+	public:
+		OpeningBook() : data_(NULL), size_(0) {;}
+		OpeningBook(const OpeningBook&) = delete;
+		~OpeningBook() {close();}
+		
+		// Returns 0 on success, 1 if the file can't be opened and 2 if it
+		// is not a valid book file
+		int open(string filename);
+		void close();
+		bool isOpen() {return data_ != NULL;}
+		long getNumPositions() {return isOpen() ? header_.numPositions_ : 0;}
+		
+		// Chooses a move of the position with a probability proportional to
+		// its weight (ran uniform in [0,1)), returns false if the position
+		// is not in the book
+		bool lookup(Board &board, double ran, int &ipawnToMove,
+		            int &ivertexDestination);
+	
+	protected:
+		const unsigned char *data_;
+		size_t size_;
+		BookHeader header_;
+		const BookPosition *positions_;
+		const BookMove *moves_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+string openingBookFilename(int nTeams, int boardSize)
+{
+	return "data/book_" + to_string(nTeams) + "_" + to_string(boardSize)
+	     + ".bk";
+}
+
+
+
+
+void OpeningBookBuilder::add(uint64_t hash, BookMove &move)
+{
+	vector<BookMove> &moves = positions_[hash];
+	for (BookMove &move2 : moves)
+		if (move2.ivertexFrom_ == move.ivertexFrom_ &&
+		    move2.ivertexTo_ == move.ivertexTo_)
+		{
+			move2.games_ += move.games_;
+			move2.score_ += move.score_;
+			return;
+		}
+	moves.push_back(move);
+}
+
+void OpeningBookBuilder::addGame(vector<BookGameMove> &moves,
+                                 vector<int> winningOrder)
+{
+	for (BookGameMove &gameMove : moves)
+	{
+		int rank = winningOrder[gameMove.team_];
+		if (rank<0) continue;
+		
+		BookMove move;
+		move.ivertexFrom_ = gameMove.ivertexFrom_;
+		move.ivertexTo_ = gameMove.ivertexTo_;
+		move.games_ = 1;
+		move.score_ = nTeams_>1 ? double(nTeams_-rank)/(nTeams_-1) : 1;
+		add(gameMove.hash_, move);
+	}
+}
+
+void OpeningBookBuilder::merge(OpeningBookBuilder &builder)
+{
+	for (auto &position : builder.positions_)
+		for (BookMove &move : position.second)
+			add(position.first, move);
+}
+
+int OpeningBookBuilder::load(string filename)
+{
+	OpeningBook book;
+	int status = book.open(filename);
+	if (status != 0) return status;
+	
+	ifstream file(filename, ios::binary);
+	BookHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (header.nTeams_ != nTeams_ || header.boardSize_ != boardSize_ ||
+	    header.nVertices_ != nVertices_) return 2;
+	
+	vector<BookPosition> positions(header.numPositions_);
+	vector<BookMove> moves(header.numMoves_);
+	file.read((char*)positions.data(), positions.size()*sizeof(BookPosition));
+	file.read((char*)moves.data(), moves.size()*sizeof(BookMove));
+	if (!file) return 2;
+	
+	for (BookPosition &position : positions)
+		for (int i=0; i<position.numMoves_; i++)
+			add(position.hash_, moves[position.firstMove_+i]);
+	
+	return 0;
+}
+
+int OpeningBookBuilder::write(string filename, int minGames)
+{
+	vector<BookPosition> positions;
+	vector<BookMove> moves;
+	
+	for (auto &position : positions_)
+	{
+		vector<BookMove> selected = position.second;
+		sort(selected.begin(), selected.end(),
+		     [](const BookMove &a, const BookMove &b)
+		     {return a.score_>b.score_;});
+		
+		BookPosition entry = {position.first, (uint32_t)moves.size(),
+		                      (uint32_t)selected.size()};
+		positions.push_back(entry);
+		moves.insert(moves.end(), selected.begin(), selected.end());
+	}
+	
+	// positions sorted by hash, their moves stay in place
+	sort(positions.begin(), positions.end(),
+	     [](const BookPosition &a, const BookPosition &b)
+	     {return a.hash_<b.hash_;});
+	
+	BookHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic_, "CCBOOK01", 8);
+	header.version_ = BOOK_VERSION;
+	header.nTeams_ = nTeams_;
+	header.boardSize_ = boardSize_;
+	header.nVertices_ = nVertices_;
+	header.numPositions_ = positions.size();
+	header.numMoves_ = moves.size();
+	header.minGames_ = minGames;
+	
+	ofstream file(filename, ios::binary);
+	file.write((char*)&header, sizeof(header));
+	file.write((char*)positions.data(), positions.size()*sizeof(BookPosition));
+	file.write((char*)moves.data(), moves.size()*sizeof(BookMove));
+	file.close();
+	
+	return file ? 0 : 1;
+}
+
+
+
+
+int OpeningBook::open(string filename)
+{
+	close();
+	
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd<0) return 1;
+	
+	struct stat status;
+	if (fstat(fd, &status)<0 || status.st_size<sizeof(BookHeader))
+	{
+		::close(fd);
+		return 2;
+	}
+	
+	size_ = status.st_size;
+	void *data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		size_ = 0;
+		return 1;
+	}
+	data_ = (const unsigned char*)data;
+	
+	memcpy(&header_, data_, sizeof(header_));
+	if (memcmp(header_.magic_, "CCBOOK01", 8) != 0 ||
+	    header_.version_ != BOOK_VERSION ||
+	    sizeof(BookHeader) + header_.numPositions_*sizeof(BookPosition)
+	    + header_.numMoves_*sizeof(BookMove) != size_)
+	{
+		close();
+		return 2;
+	}
+	
+	positions_ = (const BookPosition*)(data_+sizeof(BookHeader));
+	moves_ = (const BookMove*)(positions_+header_.numPositions_);
+	
+	return 0;
+}
+
+void OpeningBook::close()
+{
+	if (data_ != NULL) munmap((void*)data_, size_);
+	data_ = NULL;
+	size_ = 0;
+}
+
+bool OpeningBook::lookup(Board &board, double ran, int &ipawnToMove,
+                         int &ivertexDestination)
+{
+	if (data_ == NULL || board.getNTeams() != header_.nTeams_ ||
+	    board.getVertices().size() != header_.nVertices_) return false;
+	
+	INSTRUMENT_SCOPE(PROBE_BOOK);
+	
+	int isymmetry;
+	uint64_t hash = board.getCanonicalHash(isymmetry);
+	const BookPosition *end = positions_+header_.numPositions_;
+	const BookPosition *position = lower_bound(positions_, end, hash,
+		[](const BookPosition &a, uint64_t hash) {return a.hash_<hash;});
+	if (position == end || position->hash_ != hash) return false;
+	
+	const BookMove *moves = moves_+position->firstMove_;
+	int numMoves = position->numMoves_;
+	int minGames = header_.minGames_;
+	double sumWeights = 0;
+	for (int i=0; i<numMoves; i++)
+		if (moves[i].games_ >= minGames) sumWeights += moves[i].score_;
+	if (sumWeights <= 0) return false;
+	
+	double cumulatedWeight = 0;
+	for (int i=0; i<numMoves; i++)
+	{
+		if (moves[i].games_ < minGames) continue;
+		cumulatedWeight += moves[i].score_;
+		if (ran*sumWeights < cumulatedWeight || cumulatedWeight >= sumWeights)
+		{
+			// a collision of the hashes would give a move of another
+			// position, the move is checked
+			const Symmetry &symmetry = board.getSymmetry(isymmetry);
+			int ivertexFrom = symmetry.inverse_[moves[i].ivertexFrom_];
+			int ivertexTo = symmetry.inverse_[moves[i].ivertexTo_];
+			int ipawn = board.getPawnFromVertex(ivertexFrom);
+			if (ipawn<0 || board.getTeamOfPawn(ipawn) != board.getPlayingTeam() ||
+			    board.findPath(ivertexFrom, ivertexTo).size()==0) return false;
+			
+			ipawnToMove = ipawn;
+			ivertexDestination = ivertexTo;
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+
+
+
+
+#endif
@@ -0,0 +1,495 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o check check.cpp Board.h Board.cpp \       //
+//                   Record.cpp -pthread                                  //
+//    Run with     $ ./check [numGames]                                   //
+//                                                                        //
+//    This file is used for checking the incremental evaluations of the   //
+//    algorithms against plain computations, in the positions of games    //
+//    played by the algorithms (seed 2020). Each check prints its number  //
+//    of comparisons and of failures; the program returns 1 if any        //
+//    comparison fails.                                                   //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Checks
+//	o	geometry: tables of the moves on an empty board (Hexagram): the
+//		neighbours in the six directions against the neighbours, the
+//		ladders against the chains of jumps in a direction, and the
+//		relaxed distances against a ladder (one move) and the distances
+//	o	assignment: cost of the optimal assignment kept by the hamiltonian
+//		of the assignments from turn to turn, and cost after each
+//		candidate move, against the minimum over all the permutations of
+//		the targets (boards with at most 6 pawns per team)
+//	o	hop distance: fields of the hop distances kept by the hamiltonian
+//		from move to move, against the fields computed from scratch, and
+//		these against a search over the moves of a single pawn, the other
+//		pawns fixed
+//	o	batch: energies of the hamiltonian (with and without the hop
+//		distance term) and fitDistanceToTargets of all the moves of the
+//		playing team, by each kernel the processor supports, against the
+//		evaluation of each move alone
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <limits.h>
+#include <chrono>
+#include "Board.h"
+#include "algorithm.cpp"
+
+using namespace std;
+
+
+// comparisons and failures of a check
+class CheckResult
+{
+	public:
+		CheckResult() : numChecks_(0), numFailures_(0) {;}
+		
+		void compare(bool ok) {numChecks_++; if (!ok) numFailures_++;}
+		
+		long numChecks_;
+		long numFailures_;
+};
+
+void report(string name, CheckResult result, double time)
+{
+	cout << name << "  checks = " << result.numChecks_
+	     << "  failures = " << result.numFailures_
+	     << "  time = " << time << " s"
+	     << "  " << (result.numFailures_==0 ? "ok" : "FAILED") << endl;
+}
+
+
+
+void checkGeometry(int nTeams, int size, CheckResult &result)
+{
+	Hexagram board(nTeams, size);
+	vector<Vertex> vertices = board.getVertices();
+	int nVertices = vertices.size();
+	
+	for (int i=0; i<nVertices; i++)
+	{
+		vector<int> neighbours = vertices[i].getNeighbours();
+		vector<int> neighbours2 = vertices[i].getNeighbours2();
+		
+		int numNeighbours = 0;
+		for (int direction=0; direction<6; direction++)
+		{
+			int j = board.getNeighbourInDirection(i, direction);
+			const vector<int> &ladder = board.getLadder(i, direction);
+			if (j<0)
+			{
+				result.compare(ladder.size()==0);
+				continue;
+			}
+			numNeighbours++;
+			
+			// the opposite direction leads back
+			int opposite = (direction+3)%6;
+			result.compare(board.getNeighbourInDirection(j, opposite) == i);
+			
+			// first rung is the jump over j, then jumps in the direction
+			int jump = -1;
+			for (int k=0; k<neighbours.size(); k++)
+				if (neighbours[k] == j) jump = neighbours2[k];
+			result.compare(ladder.size()==0 ? jump<0 : ladder[0]==jump);
+			
+			for (int k=0; k<ladder.size(); k++)
+			{
+				int previous = k==0 ? i : ladder[k-1];
+				int over = board.getNeighbourInDirection(previous, direction);
+				result.compare(over>=0 && ladder[k] ==
+				               board.getNeighbourInDirection(over, direction));
+				result.compare(board.relaxedDistance(i, ladder[k]) == 1);
+			}
+		}
+		result.compare(numNeighbours == neighbours.size());
+		
+		for (int j=0; j<nVertices; j++)
+		{
+			int relaxed = board.relaxedDistance(i, j);
+			result.compare(relaxed == board.relaxedDistance(j, i));
+			result.compare(relaxed>=0 && relaxed <= board.vertexDistance(i, j));
+			result.compare((relaxed==0) == (i==j));
+		}
+	}
+}
+
+
+
+// Smallest summed distance of the pawns to the targets of the team over
+// all the permutations of the targets
+
+int bruteForceAssignment(Board &board, int team, vector<int> &pawnVertices)
+{
+	vector<int> targets = board.getTargetOfTeam(team);
+	int n = targets.size();
+	vector<int> permutation(n);
+	for (int i=0; i<n; i++) permutation[i] = i;
+	
+	int best = INT_MAX;
+	do
+	{
+		int cost = 0;
+		for (int i=0; i<n; i++)
+			cost += board.vertexDistance(pawnVertices[i],
+			                             targets[permutation[i]]);
+		best = min(best, cost);
+	}
+	while (next_permutation(permutation.begin(), permutation.end()));
+	
+	return best;
+}
+
+void checkAssignment(int nTeams, int size, int numGames, CheckResult &result,
+                     long &numIncremental, long &numFull)
+{
+	teamAssignments.clear();
+	
+	for (int igame=0; igame<numGames; igame++)
+	{
+		Hexagram board(nTeams, size);
+		int n = board.getNPawnsPerTeam();
+		
+		for (int counterMoves=0; counterMoves<1000; counterMoves++)
+		{
+			int pteam = board.getPlayingTeam();
+			if (pteam<0) break;
+			
+			// updates the assignment of the team kept by the thread
+			int ipawnToMove = -1;
+			int ivertexDestination = -1;
+			algorithmHamiltonianAssignment(board, ipawnToMove,
+			                               ivertexDestination);
+			TargetAssignment &assignment = teamAssignments[pteam];
+			
+			vector<int> pawnVertices(n);
+			for (int i=0; i<n; i++)
+				pawnVertices[i] = board.getVertexFromPawn(pteam*n+i);
+			result.compare(assignment.getCost() ==
+			               bruteForceAssignment(board, pteam, pawnVertices));
+			
+			// candidate moves
+			for (int i=0; i<n; i++)
+			{
+				vector<int> destinations =
+					board.availableMovesDirect(pawnVertices[i]);
+				for (int ivertex : board.availableMovesHopping(pawnVertices[i]))
+					destinations.push_back(ivertex);
+				
+				for (int ivertex : destinations)
+				{
+					vector<int> pawnVerticesAfter = pawnVertices;
+					pawnVerticesAfter[i] = ivertex;
+					int cost = assignment.costAfterMove(pteam*n+i, ivertex);
+					result.compare(cost == bruteForceAssignment(board, pteam,
+					                                    pawnVerticesAfter));
+				}
+			}
+			
+			if (board.move(ipawnToMove, ivertexDestination) != 0) break;
+		}
+	}
+	
+	for (TargetAssignment &assignment : teamAssignments)
+	{
+		numIncremental += assignment.getNumIncrementalUpdates();
+		numFull += assignment.getNumFullSolves();
+	}
+}
+
+
+
+// Moves needed by a pawn of the team on the vertex to reach a free vertex
+// of its target, the other pawns fixed (-1 if it can't), by a breadth-first
+// search over the steps and the chains of hops of the pawn
+
+int bruteForceHopDistance(Board &board, int team, int ivertexStart)
+{
+	vector<Vertex> vertices = board.getVertices();
+	int nVertices = vertices.size();
+	
+	// team of the pawn of each vertex, the moving pawn excluded
+	vector<int> occupant(nVertices,-1);
+	for (int i=0; i<nVertices; i++)
+	{
+		int ipawn = board.getPawnFromVertex(i);
+		if (ipawn>=0 && i!=ivertexStart)
+			occupant[i] = board.getTeamOfPawn(ipawn);
+	}
+	
+	vector<char> isTarget(nVertices,0);
+	for (int itarget : board.getTargetOfTeam(team)) isTarget[itarget] = 1;
+	
+	vector<int> distances(nVertices,-1);
+	vector<int> queue(1,ivertexStart);
+	distances[ivertexStart] = 0;
+	
+	for (int k=0; k<queue.size(); k++)
+	{
+		int ivertex = queue[k];
+		if (isTarget[ivertex]) return distances[ivertex];
+		
+		// steps, then chains of hops
+		vector<int> destinations;
+		for (int ineighbour : vertices[ivertex].getNeighbours())
+			if (occupant[ineighbour]<0) destinations.push_back(ineighbour);
+		
+		vector<char> reached(nVertices,0);
+		vector<int> hops(1,ivertex);
+		reached[ivertex] = 1;
+		for (int h=0; h<hops.size(); h++)
+		{
+			vector<int> neighbours = vertices[hops[h]].getNeighbours();
+			vector<int> neighbours2 = vertices[hops[h]].getNeighbours2();
+			for (int m=0; m<neighbours.size(); m++)
+			{
+				int ilanding = neighbours2[m];
+				if (ilanding<0 || reached[ilanding]) continue;
+				if (occupant[neighbours[m]]<0) continue;
+				if (occupant[ilanding]>=0) continue;
+				
+				reached[ilanding] = 1;
+				hops.push_back(ilanding);
+				destinations.push_back(ilanding);
+			}
+		}
+		
+		for (int idestination : destinations)
+			if (distances[idestination]<0)
+			{
+				distances[idestination] = distances[ivertex]+1;
+				queue.push_back(idestination);
+			}
+	}
+	
+	return -1;
+}
+
+void checkHopDistance(int nTeams, int size, int numGames, CheckResult &result,
+                      long &numIncremental, long &numFull)
+{
+	hopDistanceWeight = 0.5;
+	hopFields = HopDistanceFields();
+	
+	for (int igame=0; igame<numGames; igame++)
+	{
+		Hexagram board(nTeams, size);
+		int nVertices = board.getVertices().size();
+		
+		for (int counterMoves=0; counterMoves<1000; counterMoves++)
+		{
+			int pteam = board.getPlayingTeam();
+			if (pteam<0) break;
+			
+			// updates the fields kept by the thread
+			int ipawnToMove = -1;
+			int ivertexDestination = -1;
+			algorithmHamiltonian(board, ipawnToMove, ivertexDestination);
+			hopFields.update(board);
+			
+			HopDistanceFields fieldsFull(board);
+			for (int team=0; team<nTeams; team++)
+				for (int ivertex=0; ivertex<nVertices; ivertex++)
+				{
+					int distance = fieldsFull.distance(team, ivertex);
+					int distanceKept = hopFields.distance(team, ivertex);
+					result.compare(distance == distanceKept);
+					
+					// vertices a pawn of the team can be on
+					int ipawn = board.getPawnFromVertex(ivertex);
+					if (ipawn>=0 && board.getTeamOfPawn(ipawn)!=team) continue;
+					result.compare(distance ==
+					               bruteForceHopDistance(board, team, ivertex));
+				}
+			
+			if (board.move(ipawnToMove, ivertexDestination) != 0) break;
+		}
+	}
+	
+	numIncremental += hopFields.getNumIncrementalUpdates();
+	numFull += hopFields.getNumFullUpdates();
+	hopDistanceWeight = 0;
+}
+
+
+
+void checkBatch(int nTeams, int size, int numGames, CheckResult &result)
+{
+	int kernelDefault = getBatchKernel();
+	hopDistanceWeight = 0.5;
+	hopFields = HopDistanceFields();
+	BatchEvaluator evaluator;
+	
+	for (int igame=0; igame<numGames; igame++)
+	{
+		Hexagram board(nTeams, size);
+		
+		for (int counterMoves=0; counterMoves<1000; counterMoves++)
+		{
+			int pteam = board.getPlayingTeam();
+			if (pteam<0) break;
+			
+			int ipawnToMove = -1;
+			int ivertexDestination = -1;
+			algorithmHamiltonian(board, ipawnToMove, ivertexDestination);
+			hopFields.update(board);
+			
+			// moves of the playing team
+			vector<Move> moves;
+			MoveBatch batch;
+			vector<Pawn> pawns = board.getPawns();
+			for (int ipawn=0; ipawn<pawns.size(); ipawn++)
+			{
+				if (pawns[ipawn].getTeam() != pteam) continue;
+				
+				int ivertexFrom = board.getVertexFromPawn(ipawn);
+				vector<int> destinations;
+				destinations = board.availableMovesDirect(ivertexFrom);
+				for (int ivertexTo : board.availableMovesHopping(ivertexFrom))
+					destinations.push_back(ivertexTo);
+				
+				for (int ivertexTo : destinations)
+				{
+					moves.push_back(Move(ivertexFrom, ivertexTo));
+					batch.add(ivertexFrom, ivertexTo);
+				}
+			}
+			
+			for (int kernel=BATCH_KERNEL_SCALAR; kernel<=BATCH_KERNEL_AVX2; 
+			     kernel++)
+			{
+				if (!batchKernelSupported(kernel)) continue;
+				setBatchKernel(kernel);
+				
+				vector<double> energies(moves.size());
+				evaluator.hamiltonianEnergies(board, batch, 
+				                              hopFields.field(pteam), 0.5, 
+				                              energies);
+				for (int i=0; i<moves.size(); i++)
+					result.compare(fabs(energies[i]-
+					                    hamiltonian(board, moves[i])) < 1e-9);
+				
+				vector<int> noField;
+				evaluator.hamiltonianEnergies(board, batch, noField, 0, 
+				                              energies);
+				for (int i=0; i<moves.size(); i++)
+					result.compare(fabs(energies[i]-
+					                    hamiltonianTarget(board, moves[i]))
+					               < 1e-9);
+				
+				vector<double> fits(moves.size());
+				evaluator.fitDistanceToTargets(board, batch, pteam, fits);
+				for (int i=0; i<moves.size(); i++)
+					result.compare(fabs(fits[i]-
+					                    fitDistanceToTargets(board, 
+					                        moves[i].ivertexFrom_, 
+					                        moves[i].ivertexTo_, pteam))
+					               < 1e-9);
+			}
+			setBatchKernel(kernelDefault);
+			
+			if (board.move(ipawnToMove, ivertexDestination) != 0) break;
+		}
+	}
+	
+	hopDistanceWeight = 0;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	///////////////////////////// Parameters ///////////////////////////////
+	
+	int numGames = 10;
+	if (argc>1) numGames = atoi(argv[1]);
+	
+	seed = 2020;
+	gen.seed(seed);
+	temperature = 0.3;
+	useOpeningBook = false;
+	
+	cout << endl;
+	cout << "=========== Checks ============" << endl;
+	cout << endl;
+	cout << "numGames = " << numGames << endl;
+	cout << endl;
+	
+	/////////////////////////////// Checks /////////////////////////////////
+	
+	int numFailed = 0;
+	
+	{
+		CheckResult result;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int size=2; size<=5; size++) checkGeometry(6, size, result);
+		chrono::duration<double> time = chrono::steady_clock::now()-start;
+		
+		report("geometry", result, time.count());
+		if (result.numFailures_>0) numFailed++;
+	}
+	
+	{
+		CheckResult result;
+		long numIncremental = 0;
+		long numFull = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		checkAssignment(2, 3, numGames, result, numIncremental, numFull);
+		checkAssignment(6, 3, numGames, result, numIncremental, numFull);
+		chrono::duration<double> time = chrono::steady_clock::now()-start;
+		
+		report("assignment", result, time.count());
+		cout << "  incremental updates = " << numIncremental
+		     << "  full solves = " << numFull << endl;
+		if (result.numFailures_>0) numFailed++;
+	}
+	
+	{
+		CheckResult result;
+		long numIncremental = 0;
+		long numFull = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		checkHopDistance(2, 3, numGames, result, numIncremental, numFull);
+		checkHopDistance(3, 3, numGames, result, numIncremental, numFull);
+		checkHopDistance(6, 3, numGames, result, numIncremental, numFull);
+		chrono::duration<double> time = chrono::steady_clock::now()-start;
+		
+		report("hop distance", result, time.count());
+		cout << "  incremental updates = " << numIncremental
+		     << "  full updates = " << numFull << endl;
+		if (result.numFailures_>0) numFailed++;
+	}
+	
+	{
+		CheckResult result;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		checkBatch(2, 3, numGames, result);
+		checkBatch(6, 4, numGames, result);
+		chrono::duration<double> time = chrono::steady_clock::now()-start;
+		
+		report("batch", result, time.count());
+		cout << "  kernels =";
+		for (int kernel=BATCH_KERNEL_SCALAR; kernel<=BATCH_KERNEL_AVX2; 
+		     kernel++)
+			if (batchKernelSupported(kernel)) 
+				cout << " " << batchKernelName(kernel);
+		cout << endl;
+		if (result.numFailures_>0) numFailed++;
+	}
+	
+	///////////////////////////// Summary //////////////////////////////////
+	
+	cout << endl;
+	cout << "Number of failed checks = " << numFailed << endl;
+	
+	return numFailed>0;
+}
@@ -0,0 +1,312 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the endgame solver of the chinese checkers  //
+//    game.                                                               //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	When the last playing team has only a few pawns outside its target,
+//	the minimum number of moves to finish is searched exactly, the pawns
+//	of the other teams staying where they are. The search is an IDA* over
+//	the moves of the team, with as heuristic the sum over the pawns of
+//	their relaxed distance to the target: the number of moves a pawn would
+//	need if the occupation of the vertices was ignored (a move is then a
+//	step to a neighbour or any chain of jumps). Each move changes one pawn
+//	by at most one relaxed move, so the heuristic never overestimates.
+//
+//	Searches are bounded by a number of nodes; the positions of the
+//	solutions, and the positions that could not be solved, are cached by
+//	their canonical hash (one entry for symmetric positions, the moves
+//	mapped onto the canonical position) so that the following moves of the
+//	team are immediate.
+
+
+#ifndef ENDGAME
+#define ENDGAME
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <limits.h>
+#include "Board.h"
+#include "instrumentation.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const int ENDGAME_FOUND = -1;
+
+// Minimum number of moves from each vertex to the nearest source vertex
+// when the occupation of the vertices is ignored
+vector<int> relaxedMoveDistances(Board &board, vector<int> &sources);
+
+// solution of a position: moves to finish and first move, moves_<0 if
+// the position could not be solved
+class EndgameEntry
+{
+	public:
+		int moves_;
+		int ivertexFrom_;
+		int ivertexTo_;
+};
+
+class EndgameSolver
+{
+	public:
+		EndgameSolver(int maxPawnsOutside=3, long nodeBudget=20000,
+		              int cacheSize=1<<16)
+		: maxPawnsOutside_(maxPawnsOutside), nodeBudget_(nodeBudget),
+		  cacheSize_(cacheSize), nVerticesPrepared_(-1), teamPrepared_(-1),
+		  numSolved_(0), numFailed_(0), numCacheHits_(0) {;}
+		
+		// Gives the first move of a shortest way to finish and returns true
+		// if the playing team is in its endgame and it could be solved
+		bool solve(Board &board, int &ipawnToMove, int &ivertexDestination);
+		
+		long getNumSolved() {return numSolved_;}
+		long getNumFailed() {return numFailed_;}
+		long getNumCacheHits() {return numCacheHits_;}
+	
+	protected:
+		void prepare(Board &board, int team);
+		int search(Board &board, int g, int bound, int h);
+		
+		int maxPawnsOutside_;
+		long nodeBudget_;
+		int cacheSize_;
+		
+		// relaxed distances to the target of the team
+		int nVerticesPrepared_;
+		int teamPrepared_;
+		vector<int> relaxedDistances_;
+		vector<int> pawns_;              // pawns of the team
+		
+		// state of a search
+		long nodes_;
+		bool aborted_;
+		vector<pair<int,int>> solution_; // moves, from the last one
+		unordered_map<uint64_t,int> visited_;  // smallest g of a position
+		
+		unordered_map<uint64_t,EndgameEntry> cache_;
+		long numSolved_;
+		long numFailed_;
+		long numCacheHits_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+// Smallest relaxed distance (see Board::relaxedDistance) to a source
+
+vector<int> relaxedMoveDistances(Board &board, vector<int> &sources)
+{
+	int nVertices = board.getVertices().size();
+	vector<int> distances(nVertices,-1);
+	
+	for (int i=0; i<nVertices; i++)
+		for (int isource : sources)
+		{
+			int distance = board.relaxedDistance(i, isource);
+			if (distance>=0 && (distances[i]<0 || distance<distances[i]))
+				distances[i] = distance;
+		}
+	
+	return distances;
+}
+
+
+
+
+void EndgameSolver::prepare(Board &board, int team)
+{
+	int nVertices = board.getVertices().size();
+	if (nVertices == nVerticesPrepared_ && team == teamPrepared_) return;
+	
+	vector<int> targets = board.getTargetOfTeam(team);
+	relaxedDistances_ = relaxedMoveDistances(board, targets);
+	
+	pawns_.clear();
+	int nPawnsPerTeam = board.getNPawnsPerTeam();
+	for (int ipawn=team*nPawnsPerTeam; ipawn<(team+1)*nPawnsPerTeam; ipawn++)
+		pawns_.push_back(ipawn);
+	
+	nVerticesPrepared_ = nVertices;
+	teamPrepared_ = team;
+}
+
+
+
+// Returns ENDGAME_FOUND when the target is reached within the bound,
+// otherwise the smallest f=g+h that exceeded it (INT_MAX if none)
+
+int EndgameSolver::search(Board &board, int g, int bound, int h)
+{
+	if (g+h > bound) return g+h;
+	if (h==0) return ENDGAME_FOUND;
+	
+	if (++nodes_ > nodeBudget_)
+	{
+		aborted_ = true;
+		return INT_MAX;
+	}
+	
+	// reached before with as many moves left, nothing new below
+	uint64_t hash = board.getHash();
+	unordered_map<uint64_t,int>::iterator it = visited_.find(hash);
+	if (it != visited_.end() && it->second <= g) return INT_MAX;
+	visited_[hash] = g;
+	
+	// moves of the team, the ones that reduce the heuristic first
+	vector<int> numHops;
+	vector<pair<int,pair<int,int>>> moves;
+	for (int ipawn : pawns_)
+	{
+		int ivertexFrom = board.getVertexFromPawn(ipawn);
+		vector<int> destinations = board.availableMovesDirect(ivertexFrom);
+		for (int ivertexTo : board.availableMovesHoppingBFS(ivertexFrom, numHops))
+			destinations.push_back(ivertexTo);
+		
+		for (int ivertexTo : destinations)
+		{
+			int delta = relaxedDistances_[ivertexTo]
+			          - relaxedDistances_[ivertexFrom];
+			moves.push_back(make_pair(delta, make_pair(ivertexFrom, ivertexTo)));
+		}
+	}
+	stable_sort(moves.begin(), moves.end(),
+	            [](const pair<int,pair<int,int>> &a,
+	               const pair<int,pair<int,int>> &b) {return a.first<b.first;});
+	
+	int nextBound = INT_MAX;
+	for (pair<int,pair<int,int>> &move : moves)
+	{
+		int ivertexFrom = move.second.first;
+		int ivertexTo = move.second.second;
+		
+		board.moveUnchecked(ivertexFrom, ivertexTo);
+		int result = search(board, g+1, bound, h+move.first);
+		board.moveUnchecked(ivertexTo, ivertexFrom);
+		
+		if (result == ENDGAME_FOUND)
+		{
+			solution_.push_back(move.second);
+			return ENDGAME_FOUND;
+		}
+		if (aborted_) return INT_MAX;
+		nextBound = min(nextBound, result);
+	}
+	
+	return nextBound;
+}
+
+
+
+bool EndgameSolver::solve(Board &board, int &ipawnToMove,
+                          int &ivertexDestination)
+{
+	int team = board.getPlayingTeam();
+	if (team<0) return false;
+	
+	// the other pawns only stay where they are when the other teams have
+	// finished; otherwise teams that follow their solutions can block each
+	// other in a cycle
+	vector<int> winningOrder = board.getWinningOrder();
+	for (int team2=0; team2<winningOrder.size(); team2++)
+		if (team2 != team && winningOrder[team2]<0) return false;
+	
+	// endgame of the team, with a target that its pawns can fill
+	vector<int> targets = board.getTargetOfTeam(team);
+	int nPawnsPerTeam = board.getNPawnsPerTeam();
+	int nPawnsOnTarget = 0;
+	for (int itarget : targets)
+	{
+		int ipawn = board.getPawnFromVertex(itarget);
+		if (ipawn<0) continue;
+		if (board.getTeamOfPawn(ipawn) != team) return false;
+		nPawnsOnTarget++;
+	}
+	int nPawnsOutside = nPawnsPerTeam-nPawnsOnTarget;
+	if (nPawnsOutside==0 || nPawnsOutside>maxPawnsOutside_) return false;
+	
+	INSTRUMENT_SCOPE(PROBE_ENDGAME);
+	
+	// solved before
+	int isymmetry;
+	uint64_t hash = board.getCanonicalHash(isymmetry);
+	unordered_map<uint64_t,EndgameEntry>::iterator it = cache_.find(hash);
+	if (it != cache_.end())
+	{
+		numCacheHits_++;
+		if (it->second.moves_<0) return false;
+		
+		const Symmetry &symmetry = board.getSymmetry(isymmetry);
+		ipawnToMove = board.getPawnFromVertex(
+			symmetry.inverse_[it->second.ivertexFrom_]);
+		ivertexDestination = symmetry.inverse_[it->second.ivertexTo_];
+		return true;
+	}
+	if (cache_.size() >= cacheSize_) cache_.clear();
+	
+	// iterative deepening on the bound of f=g+h
+	prepare(board, team);
+	Board boardSearch = board;
+	
+	int h = 0;
+	for (int ipawn : pawns_)
+		h += relaxedDistances_[board.getVertexFromPawn(ipawn)];
+	
+	nodes_ = 0;
+	aborted_ = false;
+	int bound = h;
+	while (true)
+	{
+		visited_.clear();
+		solution_.clear();
+		int result = search(boardSearch, 0, bound, h);
+		if (result == ENDGAME_FOUND) break;
+		
+		if (aborted_ || result == INT_MAX)
+		{
+			EndgameEntry entry = {-1,-1,-1};
+			cache_[hash] = entry;
+			numFailed_++;
+			return false;
+		}
+		bound = result;
+	}
+	numSolved_++;
+	
+	// the positions along the solution are cached too
+	reverse(solution_.begin(), solution_.end());
+	for (int i=0; i<solution_.size(); i++)
+	{
+		uint64_t hashSearch = boardSearch.getCanonicalHash(isymmetry);
+		const Symmetry &symmetry = boardSearch.getSymmetry(isymmetry);
+		EndgameEntry entry = {int(solution_.size())-i,
+		                      symmetry.vertices_[solution_[i].first],
+		                      symmetry.vertices_[solution_[i].second]};
+		cache_[hashSearch] = entry;
+		boardSearch.moveUnchecked(solution_[i].first, solution_[i].second);
+	}
+	
+	ipawnToMove = board.getPawnFromVertex(solution_[0].first);
+	ivertexDestination = solution_[0].second;
+	return true;
+}
+
+
+
+
+
+#endif
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the cache of the evaluations of moves of    //
+//    the chinese checkers game.                                          //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The algorithms that evaluate every move of the playing team store the
+//	values by a key mixing the move, the geometry of the board and, when
+//	the evaluation depends on something else (e.g. a chosen target), an
+//	extra integer. Only the evaluations that don't depend on the other
+//	pawns can be stored this way; the same moves towards the same target
+//	recur in every game, so that these hit much more often than a key
+//	with the hash of the position would.
+//
+//	The table has a fixed size, divided in sets of EVAL_CACHE_WAYS
+//	entries; a key can only be in the set given by its low bits. When a
+//	set is full, the entry used the longest ago is replaced. Keys are 64
+//	bits and are compared whole, a false hit needs a collision of them.
+//	Each thread has its own caches (no synchronisation).
+
+
+#ifndef EVAL_CACHE
+#define EVAL_CACHE
+
+#include <vector>
+#include <stdint.h>
+#include "Board.h"
+#include "instrumentation.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const int EVAL_CACHE_WAYS = 4;
+
+class EvalCacheEntry
+{
+	public:
+		uint64_t key_;                   // 0 for an empty entry
+		double value_;
+		uint32_t lastUse_;
+};
+
+class EvalCache
+{
+	public:
+		// numSets is rounded up to a power of two
+		EvalCache(int numSets=1<<13);
+		
+		// Key of the evaluation of a move on the geometry of the board, the
+		// position of the pawns is not part of it
+		static uint64_t key(Board &board, int ivertexFrom, int ivertexTo,
+		                    int extra=0);
+		
+		// Returns true and gives the value if the key is stored
+		bool find(uint64_t key, double &value);
+		void store(uint64_t key, double value);
+		void clear();
+		
+		long getNumLookups() {return numLookups_;}
+		long getNumHits() {return numHits_;}
+	
+	protected:
+		uint32_t tick();
+		
+		vector<EvalCacheEntry> entries_;
+		uint64_t setMask_;
+		uint32_t clock_;                 // counts the uses
+		long numLookups_;
+		long numHits_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+EvalCache::EvalCache(int numSets)
+: clock_(0), numLookups_(0), numHits_(0)
+{
+	int numSets2 = 1;
+	while (numSets2 < numSets) numSets2 *= 2;
+	
+	setMask_ = numSets2-1;
+	entries_ = vector<EvalCacheEntry>(numSets2*EVAL_CACHE_WAYS);
+	clear();
+}
+
+void EvalCache::clear()
+{
+	for (EvalCacheEntry &entry : entries_)
+	{
+		entry.key_ = 0;
+		entry.value_ = 0;
+		entry.lastUse_ = 0;
+	}
+}
+
+
+
+// Move, extra integer and geometry mixed by the splitmix64 finaliser
+
+uint64_t EvalCache::key(Board &board, int ivertexFrom, int ivertexTo,
+                        int extra)
+{
+	uint64_t z = uint64_t(ivertexFrom) | uint64_t(ivertexTo)<<16
+	           | uint64_t(uint16_t(extra))<<32
+	           | uint64_t(board.getNTeams())<<48
+	           | uint64_t(board.getNPawnsPerTeam())<<56;
+	z = (z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+	z = (z^(z>>27))*0x94d049bb133111ebULL;
+	z = z^(z>>31);
+	
+	return z!=0 ? z : 1;
+}
+
+bool EvalCache::find(uint64_t key, double &value)
+{
+	numLookups_++;
+	INSTRUMENT_COUNT(PROBE_EVAL_CACHE_LOOKUPS,1);
+	
+	EvalCacheEntry *set = &entries_[(key&setMask_)*EVAL_CACHE_WAYS];
+	for (int i=0; i<EVAL_CACHE_WAYS; i++)
+		if (set[i].key_ == key)
+		{
+			set[i].lastUse_ = tick();
+			value = set[i].value_;
+			numHits_++;
+			INSTRUMENT_COUNT(PROBE_EVAL_CACHE_HITS,1);
+			return true;
+		}
+	
+	return false;
+}
+
+void EvalCache::store(uint64_t key, double value)
+{
+	// entry of the key if present, otherwise an empty one or the one used
+	// the longest ago (an empty entry has lastUse_ 0)
+	EvalCacheEntry *set = &entries_[(key&setMask_)*EVAL_CACHE_WAYS];
+	EvalCacheEntry *replaced = &set[0];
+	for (int i=0; i<EVAL_CACHE_WAYS; i++)
+	{
+		if (set[i].key_ == key) {replaced = &set[i]; break;}
+		if (set[i].lastUse_ < replaced->lastUse_) replaced = &set[i];
+	}
+	
+	replaced->key_ = key;
+	replaced->value_ = value;
+	replaced->lastUse_ = tick();
+}
+
+// the ages are only compared, they restart before the clock wraps around
+uint32_t EvalCache::tick()
+{
+	if (clock_ == UINT32_MAX)
+	{
+		for (EvalCacheEntry &entry : entries_)
+			entry.lastUse_ = entry.key_!=0 ? 1 : 0;
+		clock_ = 1;
+	}
+	
+	return ++clock_;
+}
+
+
+
+
+
+#endif
@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the parameterised linear evaluation of the  //
+//    positions of the chinese checkers game.                             //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The evaluation of a team is an estimate of the number of moves it still
+//	needs to reach its target, linear in the features
+//	o	bias (always 1)
+//	o	summed distances of the pawns to the best target vertex
+//	o	summed distances of the pawns not on target to the nearest free
+//		target vertex
+//	o	distance of the last pawn (straggler) to the best target vertex
+//	o	spread of the pawns, summed pairwise distances divided by the
+//		number of pawns (small when the pawns move as a group)
+//	The weights are fitted on a dataset of positions by tune.cpp and stored
+//	in a text file, one "<name> <value>" line per feature ('#' comments).
+//	The default weights only use the distance to the best target, which
+//	gives the same energies as hamiltonianTarget.
+
+
+#ifndef EVALUATION
+#define EVALUATION
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include "Board.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const int EVAL_BIAS = 0;
+const int EVAL_DISTANCE_BEST_TARGET = 1;
+const int EVAL_DISTANCE_FREE_TARGETS = 2;
+const int EVAL_STRAGGLER = 3;
+const int EVAL_SPREAD = 4;
+const int EVAL_NUM_FEATURES = 5;
+
+const string evalFeatureNames[EVAL_NUM_FEATURES] =
+	{"bias", "distanceBestTarget", "distanceFreeTargets", "straggler",
+	 "spread"};
+
+class EvalWeights
+{
+	public:
+		EvalWeights()
+		{
+			for (int i=0; i<EVAL_NUM_FEATURES; i++) weights_[i] = 0;
+			weights_[EVAL_DISTANCE_BEST_TARGET] = 1;
+		}
+		
+		double evaluate(double *features)
+		{
+			double value = 0;
+			for (int i=0; i<EVAL_NUM_FEATURES; i++)
+				value += weights_[i]*features[i];
+			return value;
+		}
+		
+		double weights_[EVAL_NUM_FEATURES];
+};
+
+// Returns 0 on success, 1 if the file can't be opened and 2 if a line is
+// not recognised (the weights are then left unchanged)
+int loadEvalWeights(string filename, EvalWeights &weights);
+int writeEvalWeights(string filename, EvalWeights &weights, string comment);
+
+// Features of the positions of a board, the geometry of the board is
+// cached at construction. The positions are given as the vertices of all
+// the pawns (team-major), so that positions of a dataset can be evaluated
+// without setting them on the board.
+class EvalFeatures
+{
+	public:
+		EvalFeatures(Board &board);
+		
+		void compute(vector<int> &pawnVertices, int team, double *features);
+	
+	protected:
+		Board &board_;
+		int nPawnsPerTeam_;
+		vector<vector<int>> targets_;
+		vector<int> bestTargets_;
+		vector<char> occupied_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+int loadEvalWeights(string filename, EvalWeights &weights)
+{
+	ifstream file(filename);
+	if (!file) return 1;
+	
+	EvalWeights weightsRead = weights;
+	string line;
+	
+	while (getline(file, line))
+	{
+		if (line == "" || line[0] == '#') continue;
+		
+		stringstream stream(line);
+		string name;
+		double value;
+		stream >> name >> value;
+		if (!stream) return 2;
+		
+		int ifeature = -1;
+		for (int i=0; i<EVAL_NUM_FEATURES; i++)
+			if (evalFeatureNames[i] == name) ifeature = i;
+		if (ifeature<0) return 2;
+		
+		weightsRead.weights_[ifeature] = value;
+	}
+	
+	weights = weightsRead;
+	return 0;
+}
+
+int writeEvalWeights(string filename, EvalWeights &weights, string comment)
+{
+	ofstream file(filename);
+	if (!file) return 1;
+	
+	if (comment != "") file << "# " << comment << endl;
+	for (int i=0; i<EVAL_NUM_FEATURES; i++)
+		file << evalFeatureNames[i] << " " << weights.weights_[i] << endl;
+	
+	return file ? 0 : 1;
+}
+
+
+
+
+EvalFeatures::EvalFeatures(Board &board)
+: board_(board), nPawnsPerTeam_(board.getNPawnsPerTeam()),
+  bestTargets_(board.getBestTargets()),
+  occupied_(board.getVertices().size(),0)
+{
+	for (int team=0; team<board.getNTeams(); team++)
+		targets_.push_back(board.getTargetOfTeam(team));
+}
+
+void EvalFeatures::compute(vector<int> &pawnVertices, int team,
+                           double *features)
+{
+	for (int i=0; i<EVAL_NUM_FEATURES; i++) features[i] = 0;
+	features[EVAL_BIAS] = 1;
+	
+	for (int ivertex : pawnVertices) occupied_[ivertex] = 1;
+	
+	int ibegin = team*nPawnsPerTeam_;
+	int iend = ibegin+nPawnsPerTeam_;
+	int itargetBest = bestTargets_[team];
+	
+	for (int i=ibegin; i<iend; i++)
+	{
+		int ivertex = pawnVertices[i];
+		
+		// distance to the best target and straggler
+		if (itargetBest>=0)
+		{
+			int distance = board_.vertexDistance(ivertex, itargetBest);
+			features[EVAL_DISTANCE_BEST_TARGET] += distance;
+			if (distance > features[EVAL_STRAGGLER])
+				features[EVAL_STRAGGLER] = distance;
+		}
+		
+		// distance to the nearest free target, for pawns not on target
+		bool onTarget = false;
+		int distanceFree = -1;
+		for (int itarget : targets_[team])
+		{
+			if (itarget == ivertex) onTarget = true;
+			if (occupied_[itarget]) continue;
+			
+			int distance = board_.vertexDistance(ivertex, itarget);
+			if (distanceFree<0 || distance<distanceFree) distanceFree = distance;
+		}
+		if (!onTarget && distanceFree>=0)
+			features[EVAL_DISTANCE_FREE_TARGETS] += distanceFree;
+		
+		// spread of the team
+		for (int j=i+1; j<iend; j++)
+			features[EVAL_SPREAD] += board_.vertexDistance(ivertex,
+			                                               pawnVertices[j]);
+	}
+	
+	features[EVAL_SPREAD] /= nPawnsPerTeam_;
+	
+	for (int ivertex : pawnVertices) occupied_[ivertex] = 0;
+}
+
+
+
+
+
+#endif
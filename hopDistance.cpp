@@ -0,0 +1,339 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the hop distance fields of the chinese      //
+//    checkers game.                                                      //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The field of a team gives, for each vertex, the number of moves a pawn
+//	of the team on it needs to reach a free vertex of the target, the other
+//	pawns staying where they are. Unlike the geometric distance, it counts
+//	a chain of hops as a single move.
+//
+//	A pawn can land on the empty vertices. From an empty vertex w, it can
+//	step to a neighbour, or hop along a chain of jumps (over a pawn, onto
+//	an empty vertex) to any vertex of the jump component of w among the
+//	empty vertices. Jumps are symmetric, so the field is a breadth-first
+//	search from the free targets over the reversed moves: when an empty
+//	vertex w is reached, its neighbours and the vertices of its component
+//	are one move further, and so are the pawns that can jump into the
+//	component. The vertices with a pawn are reached but not expanded, a
+//	pawn does not land on them. The pawn of a vertex is not in the way of
+//	its first move; the vertex it leaves is still counted as occupied for
+//	the next ones (one field per team, not per pawn).
+//
+//	The jump components are kept from move to move: a move only changes
+//	the components around the two vertices it changes, the other ones keep
+//	their labels. The fields are computed again for the teams that ask for
+//	them after a change, once per position rather than per candidate move.
+
+
+#ifndef HOP_DISTANCE
+#define HOP_DISTANCE
+
+#include <vector>
+#include "Board.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+class HopDistanceFields
+{
+	public:
+		HopDistanceFields() : nVertices_(0), nTeams_(0), numLabels_(0),
+		                      currentStamp_(0), numFullUpdates_(0),
+		                      numIncrementalUpdates_(0) {;}
+		HopDistanceFields(Board &board) 
+		: nVertices_(0), nTeams_(0), numLabels_(0), currentStamp_(0),
+		  numFullUpdates_(0), numIncrementalUpdates_(0)
+		{update(board);}
+		
+		// Follows the position of the board; the components are updated
+		// around the vertices that changed when there are few of them
+		void update(Board &board);
+		
+		// Moves needed by a pawn of the team on the vertex to reach a free
+		// target vertex, -1 if there is no way with the other pawns fixed
+		int distance(int team, int ivertex) {return field(team)[ivertex];}
+		vector<int> &field(int team);
+		
+		long getNumFullUpdates() {return numFullUpdates_;}
+		long getNumIncrementalUpdates() {return numIncrementalUpdates_;}
+	
+	protected:
+		void prepare(Board &board);
+		void computeComponents();
+		void updateComponents(vector<int> &changed);
+		void flood(int ivertex, int label);
+		void computeField(int team);
+		
+		// geometry
+		int nVertices_;
+		int nTeams_;
+		vector<vector<int>> neighbours_;
+		vector<vector<pair<int,int>>> jumps_;  // vertex jumped over, landing
+		vector<vector<int>> targets_;
+		
+		// position
+		vector<int> occupant_;            // team of the pawn, -1 if empty
+		vector<int> component_;           // jump component, -1 if occupied
+		int numLabels_;
+		
+		vector<vector<int>> fields_;
+		vector<char> fieldValid_;
+		
+		// work arrays
+		vector<int> queue_;
+		vector<int> stamp_;
+		int currentStamp_;
+		
+		long numFullUpdates_;
+		long numIncrementalUpdates_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+void HopDistanceFields::prepare(Board &board)
+{
+	vector<Vertex> vertices = board.getVertices();
+	nVertices_ = vertices.size();
+	nTeams_ = board.getNTeams();
+	
+	neighbours_.assign(nVertices_, vector<int>());
+	jumps_.assign(nVertices_, vector<pair<int,int>>());
+	for (int i=0; i<nVertices_; i++)
+	{
+		neighbours_[i] = vertices[i].getNeighbours();
+		vector<int> neighbours2 = vertices[i].getNeighbours2();
+		for (int k=0; k<neighbours_[i].size(); k++)
+			if (neighbours2[k]>=0)
+				jumps_[i].push_back(make_pair(neighbours_[i][k], neighbours2[k]));
+	}
+	
+	targets_.clear();
+	for (int team=0; team<nTeams_; team++)
+		targets_.push_back(board.getTargetOfTeam(team));
+	
+	occupant_.assign(nVertices_, -1);
+	component_.assign(nVertices_, -1);
+	fields_.assign(nTeams_, vector<int>(nVertices_,-1));
+	fieldValid_.assign(nTeams_, 0);
+	stamp_.assign(nVertices_, 0);
+	currentStamp_ = 0;
+	numFullUpdates_ = 0;
+	numIncrementalUpdates_ = 0;
+}
+
+void HopDistanceFields::update(Board &board)
+{
+	if (board.getVertices().size() != nVertices_ ||
+	    board.getNTeams() != nTeams_)
+		prepare(board);
+	
+	vector<int> changed;
+	bool teamsChanged = false;
+	for (int i=0; i<nVertices_; i++)
+	{
+		int ipawn = board.getPawnFromVertex(i);
+		int team = ipawn>=0 ? board.getTeamOfPawn(ipawn) : -1;
+		if (team == occupant_[i]) continue;
+		
+		// a vertex that stays occupied keeps its jumps
+		if (team<0 || occupant_[i]<0) changed.push_back(i);
+		else teamsChanged = true;
+		occupant_[i] = team;
+	}
+	if (changed.size()==0 && !teamsChanged && numFullUpdates_>0) return;
+	
+	if (numFullUpdates_ == 0 || changed.size() > nVertices_/8)
+	{
+		computeComponents();
+		numFullUpdates_++;
+	}
+	else if (changed.size() > 0)
+	{
+		updateComponents(changed);
+		numIncrementalUpdates_++;
+	}
+	
+	// the fields follow the teams of the pawns too
+	for (int team=0; team<nTeams_; team++) fieldValid_[team] = 0;
+}
+
+
+
+// Labels all the empty vertices reachable by jumps from the empty vertex
+
+void HopDistanceFields::flood(int ivertex, int label)
+{
+	currentStamp_++;
+	queue_.clear();
+	queue_.push_back(ivertex);
+	stamp_[ivertex] = currentStamp_;
+	
+	for (int k=0; k<queue_.size(); k++)
+	{
+		int i = queue_[k];
+		component_[i] = label;
+		
+		for (pair<int,int> &jump : jumps_[i])
+		{
+			int j = jump.second;
+			if (occupant_[jump.first]<0 || occupant_[j]>=0) continue;
+			if (stamp_[j] == currentStamp_) continue;
+			
+			stamp_[j] = currentStamp_;
+			queue_.push_back(j);
+		}
+	}
+}
+
+void HopDistanceFields::computeComponents()
+{
+	for (int i=0; i<nVertices_; i++) component_[i] = -1;
+	
+	numLabels_ = 0;
+	for (int i=0; i<nVertices_; i++)
+		if (occupant_[i]<0 && component_[i]<0) flood(i, numLabels_++);
+}
+
+// The jumps that changed are the ones starting or landing on a changed
+// vertex (second neighbours), or jumping over it (between neighbours).
+// Their empty ends are labelled again, which relabels the components
+// they belong to now; the vertices of the former components that are not
+// reached keep an old label and are labelled in their turn.
+
+void HopDistanceFields::updateComponents(vector<int> &changed)
+{
+	vector<int> seeds;
+	for (int i : changed)
+	{
+		seeds.push_back(i);
+		for (int j : neighbours_[i]) seeds.push_back(j);
+		for (pair<int,int> &jump : jumps_[i]) seeds.push_back(jump.second);
+	}
+	
+	// former components of the seeds
+	vector<char> oldLabel(numLabels_,0);
+	for (int i : seeds)
+		if (component_[i]>=0) oldLabel[component_[i]] = 1;
+	vector<int> formerMembers;
+	for (int i=0; i<nVertices_; i++)
+	{
+		if (component_[i]>=0 && oldLabel[component_[i]])
+		{
+			formerMembers.push_back(i);
+			component_[i] = -1;
+		}
+		if (occupant_[i]>=0) component_[i] = -1;
+	}
+	
+	for (int i : seeds)
+		if (occupant_[i]<0 && component_[i]<0) flood(i, numLabels_++);
+	for (int i : formerMembers)
+		if (occupant_[i]<0 && component_[i]<0) flood(i, numLabels_++);
+	
+	// compact the labels before they get large
+	if (numLabels_ > 4*nVertices_)
+	{
+		vector<int> newLabel(numLabels_,-1);
+		int numLabels = 0;
+		for (int i=0; i<nVertices_; i++)
+		{
+			if (component_[i]<0) continue;
+			if (newLabel[component_[i]]<0) newLabel[component_[i]] = numLabels++;
+			component_[i] = newLabel[component_[i]];
+		}
+		numLabels_ = numLabels;
+	}
+}
+
+
+
+
+vector<int> &HopDistanceFields::field(int team)
+{
+	if (!fieldValid_[team]) computeField(team);
+	return fields_[team];
+}
+
+void HopDistanceFields::computeField(int team)
+{
+	vector<int> &distances = fields_[team];
+	for (int i=0; i<nVertices_; i++) distances[i] = -1;
+	
+	// members of the components (vertices sorted by label)
+	vector<int> firstMember(numLabels_+1,0);
+	for (int i=0; i<nVertices_; i++)
+		if (component_[i]>=0) firstMember[component_[i]+1]++;
+	for (int l=0; l<numLabels_; l++) firstMember[l+1] += firstMember[l];
+	vector<int> members(firstMember[numLabels_]);
+	vector<int> position(firstMember.begin(), firstMember.end()-1);
+	for (int i=0; i<nVertices_; i++)
+		if (component_[i]>=0) members[position[component_[i]]++] = i;
+	vector<char> componentDone(numLabels_,0);
+	
+	// free targets, and the pawns of the team already there
+	queue_.clear();
+	for (int itarget : targets_[team])
+	{
+		if (occupant_[itarget]>=0 && occupant_[itarget] != team) continue;
+		distances[itarget] = 0;
+		if (occupant_[itarget]<0) queue_.push_back(itarget);
+	}
+	
+	for (int k=0; k<queue_.size(); k++)
+	{
+		int w = queue_[k];
+		int d = distances[w]+1;
+		
+		for (int u : neighbours_[w])
+			if (distances[u]<0)
+			{
+				distances[u] = d;
+				if (occupant_[u]<0) queue_.push_back(u);
+			}
+		
+		int label = component_[w];
+		if (componentDone[label]) continue;
+		componentDone[label] = 1;
+		
+		for (int m=firstMember[label]; m<firstMember[label+1]; m++)
+		{
+			int x = members[m];
+			if (distances[x]<0)
+			{
+				distances[x] = d;
+				queue_.push_back(x);
+			}
+			
+			// pawns that jump into the component
+			for (pair<int,int> &jump : jumps_[x])
+			{
+				int u = jump.second;
+				if (occupant_[jump.first]>=0 && occupant_[u]>=0 &&
+				    distances[u]<0)
+					distances[u] = d;
+			}
+		}
+	}
+	
+	fieldValid_[team] = 1;
+}
+
+
+
+
+
+#endif
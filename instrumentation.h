@@ -0,0 +1,242 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Header file for the instrumentation of the hot paths of the         //
+//    chinese checkers game (counters and scoped timers).                 //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The instrumentation is compiled only with -DINSTRUMENT, the macros
+//	expand to nothing otherwise. Each thread accumulates in its own table
+//	(no synchronisation on the hot paths), tables are merged when printing
+//	the report and when a thread exits. Times are inclusive: the time of
+//	Board::move contains the time of the move searches it calls.
+
+#ifndef INSTRUMENTATION
+#define INSTRUMENTATION
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+
+// instrumented places
+enum Probe
+{
+	PROBE_BOARD_MOVE,
+	PROBE_NEIGHBOURS,
+	PROBE_NEIGHBOURS2,
+	PROBE_MOVES_DIRECT,
+	PROBE_MOVES_HOPPING,
+	PROBE_MOVES_HOPPING_RECURSION,
+	PROBE_MOVES_HOPPING_BFS,
+	PROBE_TEAMS_ON_TARGET,
+	PROBE_RANDOM_MOVE,
+	PROBE_BEST_MOVE0_MIN_SUM,
+	PROBE_BEST_MOVE0_MIN_FREE,
+	PROBE_HAMILTONIAN,
+	PROBE_HAMILTONIAN_EVAL,
+	PROBE_HAMILTONIAN_ASSIGNMENT,
+	PROBE_SEARCH,
+	PROBE_SEARCH_NODES,
+	PROBE_ENDGAME,
+	PROBE_TABLEBASE,
+	PROBE_BOOK,
+	PROBE_EVAL_CACHE_LOOKUPS,
+	PROBE_EVAL_CACHE_HITS,
+	NUM_PROBES
+};
+
+inline string probeName(int probe)
+{
+	static const char *names[NUM_PROBES] =
+	{
+		"Board::move",
+		"Board::computeNeighbours",
+		"Board::computeNeighbours2",
+		"Board::availableMovesDirect",
+		"Board::availableMovesHopping",
+		"  hopping recursions",
+		"Board::availableMovesHoppingBFS",
+		"Board::teamsOnTarget",
+		"randomMove",
+		"bestMove0MinSum",
+		"bestMove0MinFree",
+		"algorithmHamiltonian",
+		"algorithmHamiltonianEval",
+		"algorithmHamiltonianAssignment",
+		"algorithmSearch",
+		"  search nodes",
+		"EndgameSolver::solve",
+		"EndgameTablebase::probe",
+		"OpeningBook::lookup",
+		"eval cache lookups",
+		"  eval cache hits"
+	};
+	
+	return names[probe];
+}
+
+
+#ifdef INSTRUMENT
+
+
+// counts and times of the probes
+class InstrumentCounts
+{
+	public:
+		InstrumentCounts() {clear();}
+		
+		void clear()
+		{
+			for (int i=0; i<NUM_PROBES; i++) {counts_[i] = 0; nanoseconds_[i] = 0;}
+		}
+		
+		void add(InstrumentCounts &other)
+		{
+			for (int i=0; i<NUM_PROBES; i++)
+			{
+				counts_[i] += other.counts_[i];
+				nanoseconds_[i] += other.nanoseconds_[i];
+			}
+		}
+		
+		long counts_[NUM_PROBES];
+		long nanoseconds_[NUM_PROBES];
+};
+
+// counts of one thread, registered for the report while the thread lives
+class InstrumentTable : public InstrumentCounts
+{
+	public:
+		InstrumentTable();
+		~InstrumentTable();
+};
+
+// tables of the running threads, plus the merged counts of finished ones
+class InstrumentRegistry
+{
+	public:
+		InstrumentRegistry() : numThreads_(0) {;}
+		
+		mutex mutex_;
+		vector<InstrumentTable*> tables_;
+		InstrumentCounts retired_;
+		int numThreads_;
+};
+
+inline InstrumentRegistry& instrumentRegistry()
+{
+	static InstrumentRegistry registry;
+	return registry;
+}
+
+inline InstrumentTable& instrumentTable()
+{
+	thread_local InstrumentTable table;
+	return table;
+}
+
+inline InstrumentTable::InstrumentTable()
+{
+	InstrumentRegistry &registry = instrumentRegistry();
+	lock_guard<mutex> lock(registry.mutex_);
+	registry.tables_.push_back(this);
+	registry.numThreads_++;
+}
+
+inline InstrumentTable::~InstrumentTable()
+{
+	InstrumentRegistry &registry = instrumentRegistry();
+	lock_guard<mutex> lock(registry.mutex_);
+	registry.retired_.add(*this);
+	for (int i=0; i<registry.tables_.size(); i++)
+		if (registry.tables_[i] == this)
+			registry.tables_.erase(registry.tables_.begin()+i);
+}
+
+// timer adding its lifetime to a probe
+class ScopedTimer
+{
+	public:
+		ScopedTimer(int probe) : probe_(probe)
+		{
+			start_ = chrono::steady_clock::now();
+		}
+		
+		~ScopedTimer()
+		{
+			chrono::nanoseconds time = chrono::steady_clock::now() - start_;
+			InstrumentTable &table = instrumentTable();
+			table.counts_[probe_]++;
+			table.nanoseconds_[probe_] += time.count();
+		}
+	
+	protected:
+		int probe_;
+		chrono::steady_clock::time_point start_;
+};
+
+inline void instrumentCount(int probe, long n)
+{
+	instrumentTable().counts_[probe] += n;
+}
+
+// Print the counts and times summed over all threads
+inline void instrumentReport(ostream &out)
+{
+	InstrumentRegistry &registry = instrumentRegistry();
+	lock_guard<mutex> lock(registry.mutex_);
+	
+	InstrumentCounts total = registry.retired_;
+	for (InstrumentTable *table : registry.tables_) total.add(*table);
+	
+	out << endl;
+	out << "=========== Instrumentation (" << registry.numThreads_
+	    << " threads) ============" << endl;
+	out << endl;
+	out << left << setw(34) << "probe" << right
+	    << setw(14) << "calls"
+	    << setw(14) << "total (ms)"
+	    << setw(14) << "ns/call" << endl;
+	
+	for (int i=0; i<NUM_PROBES; i++)
+	{
+		if (total.counts_[i]==0) continue;
+		
+		out << left << setw(34) << probeName(i) << right
+		    << setw(14) << total.counts_[i];
+		
+		if (total.nanoseconds_[i]>0)
+			out << setw(14) << fixed << setprecision(1)
+			    << total.nanoseconds_[i]*1e-6
+			    << setw(14) << double(total.nanoseconds_[i])/total.counts_[i];
+		
+		out << defaultfloat << endl;
+	}
+}
+
+#define INSTRUMENT_CONCAT2(a,b) a##b
+#define INSTRUMENT_CONCAT(a,b) INSTRUMENT_CONCAT2(a,b)
+#define INSTRUMENT_SCOPE(probe) \
+	ScopedTimer INSTRUMENT_CONCAT(scopedTimer,__LINE__)(probe)
+#define INSTRUMENT_COUNT(probe,n) instrumentCount(probe,n)
+
+
+#else
+
+
+#define INSTRUMENT_SCOPE(probe)
+#define INSTRUMENT_COUNT(probe,n)
+
+
+#endif
+
+#endif
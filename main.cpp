@@ -7,7 +7,8 @@
 //                                                                        //
 //    Developped under Ubuntu 18.04 with g++ 7.4.0 and sfml 2.4           //
 //    Compile with $ g++ -o chinese_checkers main.cpp Board.h Board.cpp \ //
-//                   -lsfml-graphics -lsfml-window -lsfml-system          //
+//                   Record.cpp -lsfml-graphics -lsfml-window \           //
+//                   -lsfml-system -pthread                               //
 //                                                                        //
 //    Controls: You can select a pawn by left-clicking on it and place    //
 //              it by releasing the mouse above the destination vertex.   //
@@ -46,13 +47,28 @@ int main()
 	/////////////////////////////// Files //////////////////////////////////
 	
 	system("mkdir -p data");
-	ofstream recordFile("data/record.dat");
+	// moves are written by a background thread
+	AsyncFileRecordSink recordSink("data/record.dat", true); // with hops
 	ifstream recordInFile("data/record_in.dat");
 	
+	// binary trace of the hot paths, decoded with trace_decode.cpp
+	#ifdef DEBUG
+	traceEnable(true);
+	#endif
+	
 	///////////////////////////// Game board ///////////////////////////////
 	
 	Hexagram board(6,3);
 	
+	// opening book built by test_algorithms.cpp, if any (see book.cpp)
+	openingBook.open(openingBookFilename(board.getNTeams(), board.getSize()));
+	
+	//////////////////////////// Algorithm limits //////////////////////////
+	
+	// maximum time spent by the algorithm on a move (in seconds), the
+	// moves of key 'A' are searched within it (see algorithm())
+	SearchLimits moveLimits(0.5);
+	
 	/////////////////////////////// Window /////////////////////////////////
 	
 	sf::RenderWindow window(sf::VideoMode(640,640), "Chinese Checkers");
@@ -76,6 +92,12 @@ int main()
 	// board save at each move
 	vector<Hexagram> boardSaves(1,board);
 	
+	// hops of the last move played by an algorithm or replayed, shown one
+	// per frame
+	int hopPawn = -1;
+	vector<int> hopPath;
+	int hopStep = 0;
+	
 	// seed from algorithm.cpp
 	cout << "seed = " << seed << endl;
 	
@@ -102,7 +124,8 @@ int main()
 					boardSaves.pop_back();
 					
 					counterMoves --;
-					recordFile << "Undo" << endl;
+					recordSink.recordUndo();
+					hopPawn = -1;
 				}
 			}
 			
@@ -126,15 +149,32 @@ int main()
 				int ipawnToMove = -1;
 				int ivertexDestination = -1;
 				Hexagram boardCopy = board;
-				algorithm(boardCopy, ipawnToMove, ivertexDestination);
+				algorithm(boardCopy, ipawnToMove, ivertexDestination, 
+				          moveLimits);
+				moveLatencies.report(cout);
+				
+				// hops of the move, for the animation (the algorithm may have
+				// found no move, then board.move rejects it below)
+				vector<int> path;
+				if (ipawnToMove >= 0 && ivertexDestination >= 0)
+				{
+					path.push_back(board.getVertexFromPawn(ipawnToMove));
+					for (int ivertex : board.findPath(path[0], 
+					                                  ivertexDestination))
+						path.push_back(ivertex);
+				}
 				
 				// place selected pawn
-				int status = board.move(ipawnToMove, ivertexDestination, recordFile);
+				int status = board.move(ipawnToMove, ivertexDestination, recordSink);
 				if (status == 0) 
 				{
 					counterMoves ++;
 					boardSaves.push_back(boardSave);
 					
+					hopPawn = ipawnToMove;
+					hopPath = path;
+					hopStep = 0;
+					
 					#ifdef DEBUG
 					cout << "*** Board print ***" << endl;
 					board.print();
@@ -247,7 +287,7 @@ int main()
 					Hexagram boardSave = board;
 					
 					// place selected pawn
-					int status = board.move(pawnSelected, ivertexMin, recordFile);
+					int status = board.move(pawnSelected, ivertexMin, recordSink);
 					if (status == 0) 
 					{
 						counterMoves ++;
@@ -281,28 +321,20 @@ int main()
 					string line = "";
 					getline(recordInFile,line);
 					
-					if (line.substr(0,4) == "Move")
+					// line is "Move from vertex <num> to <num>" or "Undo"
+					RecordEntry entry(-1,-1,-1);
+					bool recognised = readRecordEntry(line, entry);
+					
+					if (recognised && entry.type_ == RECORD_MOVE)
 					{
 						#ifdef DEBUG
 						cout << "--- Replay move ---" << endl;
 						cout << "line = \"" << line << "\"" << endl;
 						#endif
 						
-						// string is formatted as "Move from vertex <num> to <num>"
-						// find position of the first number in string
-						int posFrom = 0;
-						for (int i=4; i<line.size(); i++)
-							if (line[i-4] == 't' && line[i-3] == 'e' &&
-								line[i-2] == 'x' && line[i-1] == ' ') posFrom = i;
-						// find position of the second number in string
-						int posTo = 0;
-						for (int i=posFrom; i<line.size(); i++)
-							if (line[i-4] == ' ' && line[i-3] == 't' &&
-								line[i-2] == 'o' && line[i-1] == ' ') posTo = i;
-						
 						// identify move
-						int ivertexFrom = stoi(line.substr(posFrom,posTo-4-posFrom));
-						int ivertexTo = stoi(line.substr(posTo,line.size()-posTo));
+						int ivertexFrom = entry.ivertexFrom_;
+						int ivertexTo = entry.ivertexTo_;
 						int ipawn = board.getPawnFromVertex(ivertexFrom);
 						
 						#ifdef DEBUG
@@ -313,13 +345,27 @@ int main()
 						// save the board before making changes
 						Hexagram boardSave = board;
 						
-						// place selected pawn
-						int status = board.move(ipawn, ivertexTo, recordFile);
+						// place selected pawn, hop by hop if the hops were
+						// recorded
+						vector<int> path = entry.path_;
+						if (path.size()==0) 
+							path = board.findPath(ivertexFrom, ivertexTo);
+						
+						int status;
+						if (entry.path_.size()>0)
+							status = board.movePath(ipawn, path, recordSink);
+						else
+							status = board.move(ipawn, ivertexTo, recordSink);
 						if (status == 0) 
 						{
 							counterMoves ++;
 							boardSaves.push_back(boardSave);
 							
+							hopPawn = ipawn;
+							hopPath = path;
+							hopPath.insert(hopPath.begin(), ivertexFrom);
+							hopStep = 0;
+							
 							#ifdef DEBUG
 							cout << "*** Board print ***" << endl;
 							board.print();
@@ -332,7 +378,7 @@ int main()
 								 << status << endl;
 						}
 					}
-					else if (line == "Undo")
+					else if (recognised && entry.type_ == RECORD_UNDO)
 					{
 						#ifdef DEBUG
 						cout << "--- Replay undo ---" << endl;
@@ -346,7 +392,8 @@ int main()
 							boardSaves.pop_back();
 							
 							counterMoves --;
-							recordFile << "Undo" << endl;
+							recordSink.recordUndo();
+							hopPawn = -1;
 						}
 						else 
 						{
@@ -376,7 +423,16 @@ int main()
 		renderTextVertices(window,board);
 		#endif
 		
-		renderPawns(window,board,pawnSelected);
+		// the pawn moving along its hops is drawn by the animation
+		if (hopPawn >= 0 && pawnSelected < 0)
+		{
+			renderPawns(window,board,hopPawn);
+			renderHopAnimation(window,board,hopPawn,hopPath,hopStep);
+			
+			hopStep ++;
+			if (hopStep >= hopPath.size()) hopPawn = -1;
+		}
+		else renderPawns(window,board,pawnSelected);
 		
 		if (pawnSelected >= 0) 
 			renderSelectedPawn(window,board,pawnSelected);
@@ -397,6 +453,10 @@ int main()
 	
 	////////////////////////////////////////////////////////////////////////
 	
+	#ifdef DEBUG
+	traceDump("data/trace.bin");
+	#endif
+	
 	return 0;
 }
 
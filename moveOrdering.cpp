@@ -0,0 +1,350 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the move ordering used by lookahead         //
+//    searches in the chinese checkers game.                              //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Moves are scored by
+//	o	forward progress towards the team's best target vertex
+//	o	length of the hop chain (long chains are often the best moves)
+//	o	a history table indexed by (from,to), rewarding moves that caused
+//		cutoffs anywhere in the search
+//	Killer moves (moves that caused a cutoff at the same ply) are tried
+//	first. The MovePicker then generates the moves in stages, so that a
+//	cutoff on an early move avoids building the rest of the list.
+
+
+#ifndef MOVE_ORDERING
+#define MOVE_ORDERING
+
+#include <iostream>
+#include <vector>
+#include "Board.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+// weights of the ordering score
+const int ORDERING_PROGRESS_WEIGHT = 1000;
+const int ORDERING_HOP_WEIGHT = 100;
+const int ORDERING_HISTORY_MAX = 1<<20;
+
+// maximum ply for killer moves
+const int ORDERING_MAX_PLY = 64;
+
+// move with its ordering information
+class OrderedMove
+{
+	public:
+		OrderedMove(int ivertexFrom, int ivertexTo, int numHops)
+		: ivertexFrom_(ivertexFrom), ivertexTo_(ivertexTo),
+		  numHops_(numHops), score_(0) {;}
+		
+		int ivertexFrom_;
+		int ivertexTo_;
+		int numHops_;  // 0 for a direct move
+		int score_;
+};
+
+// tables shared by all the nodes of a search
+class MoveOrdering
+{
+	public:
+		MoveOrdering(int nVertices) : nVertices_(nVertices)
+		{
+			history_ = vector<int>(nVertices*nVertices,0);
+			killers_ = vector<int>(2*ORDERING_MAX_PLY,-1);
+		}
+		
+		void clear();
+		void ageHistory();
+		
+		int score(Board &board, int team, int ivertexFrom, int ivertexTo,
+		          int numHops);
+		
+		bool isKiller(int ply, int ivertexFrom, int ivertexTo);
+		int getKiller(int ply, int slot) {return killers_[2*ply+slot];}
+		void updateKillers(int ply, int ivertexFrom, int ivertexTo);
+		void updateHistory(int ivertexFrom, int ivertexTo, int depth);
+		
+		int getNVertices() {return nVertices_;}
+	
+	protected:
+		int nVertices_;
+		vector<int> history_;  // indexed by ivertexFrom*nVertices+ivertexTo
+		vector<int> killers_;  // two per ply, encoded as in history
+};
+
+// staged generator of ordered moves for the given team
+class MovePicker
+{
+	public:
+		MovePicker(Board &board, int team, MoveOrdering &ordering, int ply)
+		: board_(board), team_(team), ordering_(ordering), ply_(ply),
+		  stage_(STAGE_KILLERS), iNext_(0) {;}
+		
+		bool next(int &ivertexFrom, int &ivertexTo);
+	
+	protected:
+		enum Stage
+		{
+			STAGE_KILLERS,
+			STAGE_GOOD_HOPS,
+			STAGE_DIRECT,
+			STAGE_BAD_HOPS,
+			STAGE_DONE
+		};
+		
+		void generateHops();
+		void generateDirect();
+		bool validKiller(int ivertexFrom, int ivertexTo);
+		bool pickBest(vector<OrderedMove> &moves, int &ivertexFrom,
+		              int &ivertexTo);
+		
+		Board &board_;
+		int team_;
+		MoveOrdering &ordering_;
+		int ply_;
+		int stage_;
+		int iNext_;
+		vector<OrderedMove> hops_;
+		vector<OrderedMove> badHops_;
+		vector<OrderedMove> direct_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+void MoveOrdering::clear()
+{
+	for (int i=0; i<history_.size(); i++) history_[i] = 0;
+	for (int i=0; i<killers_.size(); i++) killers_[i] = -1;
+}
+
+
+
+// Called between two searches so that old information fades out
+void MoveOrdering::ageHistory()
+{
+	for (int i=0; i<history_.size(); i++) history_[i] /= 2;
+	for (int i=0; i<killers_.size(); i++) killers_[i] = -1;
+}
+
+
+
+int MoveOrdering::score(Board &board, int team, int ivertexFrom,
+                        int ivertexTo, int numHops)
+{
+	int itarget = board.getBestTargets()[team];
+	
+	int progress = 0;
+	if (itarget>=0) progress = board.vertexDistance(ivertexFrom, itarget)
+	                         - board.vertexDistance(ivertexTo, itarget);
+	
+	int history = history_[ivertexFrom*nVertices_+ivertexTo];
+	
+	return ORDERING_PROGRESS_WEIGHT * progress
+	     + ORDERING_HOP_WEIGHT * numHops
+	     + history * ORDERING_HOP_WEIGHT / ORDERING_HISTORY_MAX;
+}
+
+
+
+bool MoveOrdering::isKiller(int ply, int ivertexFrom, int ivertexTo)
+{
+	if (ply>=ORDERING_MAX_PLY) return false;
+	
+	int code = ivertexFrom*nVertices_+ivertexTo;
+	return killers_[2*ply]==code || killers_[2*ply+1]==code;
+}
+
+
+
+void MoveOrdering::updateKillers(int ply, int ivertexFrom, int ivertexTo)
+{
+	if (ply>=ORDERING_MAX_PLY) return;
+	
+	int code = ivertexFrom*nVertices_+ivertexTo;
+	if (killers_[2*ply]==code) return;
+	
+	killers_[2*ply+1] = killers_[2*ply];
+	killers_[2*ply] = code;
+}
+
+
+
+// Moves causing cutoffs close to the root are worth more. The table is
+// halved when an entry saturates to keep the relative ordering.
+void MoveOrdering::updateHistory(int ivertexFrom, int ivertexTo, int depth)
+{
+	int &entry = history_[ivertexFrom*nVertices_+ivertexTo];
+	entry += depth*depth;
+	
+	if (entry>ORDERING_HISTORY_MAX)
+		for (int i=0; i<history_.size(); i++) history_[i] /= 2;
+}
+
+
+
+
+// Return the next move in order, false when all moves have been produced
+
+bool MovePicker::next(int &ivertexFrom, int &ivertexTo)
+{
+	while (stage_ != STAGE_DONE)
+	{
+		if (stage_ == STAGE_KILLERS)
+		{
+			while (ply_<ORDERING_MAX_PLY && iNext_<2)
+			{
+				int code = ordering_.getKiller(ply_, iNext_++);
+				if (code<0) continue;
+				
+				int nVertices = ordering_.getNVertices();
+				ivertexFrom = code/nVertices;
+				ivertexTo = code%nVertices;
+				
+				if (validKiller(ivertexFrom, ivertexTo)) return true;
+			}
+			
+			generateHops();
+			stage_ = STAGE_GOOD_HOPS;
+		}
+		else if (stage_ == STAGE_GOOD_HOPS)
+		{
+			if (pickBest(hops_, ivertexFrom, ivertexTo)) return true;
+			
+			generateDirect();
+			stage_ = STAGE_DIRECT;
+		}
+		else if (stage_ == STAGE_DIRECT)
+		{
+			if (pickBest(direct_, ivertexFrom, ivertexTo)) return true;
+			stage_ = STAGE_BAD_HOPS;
+		}
+		else if (stage_ == STAGE_BAD_HOPS)
+		{
+			if (pickBest(badHops_, ivertexFrom, ivertexTo)) return true;
+			stage_ = STAGE_DONE;
+		}
+	}
+	
+	return false;
+}
+
+
+
+// Hop moves of all pawns of the team, split between the ones that make
+// progress towards the target and the others (tried after direct moves)
+
+void MovePicker::generateHops()
+{
+	vector<Pawn> pawns = board_.getPawns();
+	vector<int> numHops;
+	
+	for (int ipawn=0; ipawn<pawns.size(); ipawn++)
+	{
+		if (pawns[ipawn].getTeam() != team_) continue;
+		
+		int ivertexFrom = board_.getVertexFromPawn(ipawn);
+		vector<int> destinations =
+			board_.availableMovesHoppingBFS(ivertexFrom, numHops);
+		
+		for (int i=0; i<destinations.size(); i++)
+		{
+			int ivertexTo = destinations[i];
+			if (ordering_.isKiller(ply_, ivertexFrom, ivertexTo)) continue;
+			
+			OrderedMove move(ivertexFrom, ivertexTo, numHops[i]);
+			move.score_ = ordering_.score(board_, team_, ivertexFrom,
+			                              ivertexTo, numHops[i]);
+			
+			if (move.score_>0) hops_.push_back(move);
+			else badHops_.push_back(move);
+		}
+	}
+}
+
+
+
+void MovePicker::generateDirect()
+{
+	vector<Pawn> pawns = board_.getPawns();
+	
+	for (int ipawn=0; ipawn<pawns.size(); ipawn++)
+	{
+		if (pawns[ipawn].getTeam() != team_) continue;
+		
+		int ivertexFrom = board_.getVertexFromPawn(ipawn);
+		
+		for (int ivertexTo : board_.availableMovesDirect(ivertexFrom))
+		{
+			if (ordering_.isKiller(ply_, ivertexFrom, ivertexTo)) continue;
+			
+			OrderedMove move(ivertexFrom, ivertexTo, 0);
+			move.score_ = ordering_.score(board_, team_, ivertexFrom,
+			                              ivertexTo, 0);
+			direct_.push_back(move);
+		}
+	}
+}
+
+
+
+// A killer comes from another position, check that it applies to this one
+
+bool MovePicker::validKiller(int ivertexFrom, int ivertexTo)
+{
+	int ipawn = board_.getPawnFromVertex(ivertexFrom);
+	if (ipawn<0 || board_.getTeamOfPawn(ipawn) != team_) return false;
+	if (board_.getPawnFromVertex(ivertexTo)>=0) return false;
+	
+	for (int ivertex : board_.availableMovesDirect(ivertexFrom))
+		if (ivertex == ivertexTo) return true;
+	
+	vector<int> numHops;
+	for (int ivertex : board_.availableMovesHoppingBFS(ivertexFrom, numHops))
+		if (ivertex == ivertexTo) return true;
+	
+	return false;
+}
+
+
+
+// Selection of the best remaining move. Cheaper than a full sort when a
+// cutoff happens after a few moves.
+
+bool MovePicker::pickBest(vector<OrderedMove> &moves, int &ivertexFrom,
+                          int &ivertexTo)
+{
+	if (moves.size()==0) return false;
+	
+	int ibest = 0;
+	for (int i=1; i<moves.size(); i++)
+		if (moves[i].score_ > moves[ibest].score_) ibest = i;
+	
+	ivertexFrom = moves[ibest].ivertexFrom_;
+	ivertexTo = moves[ibest].ivertexTo_;
+	
+	moves[ibest] = moves.back();
+	moves.pop_back();
+	
+	return true;
+}
+
+
+
+
+
+#endif
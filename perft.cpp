@@ -0,0 +1,272 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o perft perft.cpp Board.h Board.cpp \      //
+//                   Record.cpp -pthread                                  //
+//    Run with     $ ./perft [maxDepth] [check]                           //
+//                                                                        //
+//    This file is used for testing and timing the move generation. It    //
+//    counts the leaves of the game tree up to a given depth ("perft")    //
+//    from start positions and stored mid-game positions, and compares   //
+//    the counts with reference numbers. With the "check" argument, the   //
+//    recursive and breadth-first hopping move searches are also checked  //
+//    against each other, and the hop paths and the incremental hash, at  //
+//    every node.                                                         //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Conventions for the counts
+//	o	moves of a pawn are its direct moves and its hopping destinations,
+//		each destination counted once
+//	o	teams play in turn, teams on target at the root do not play
+//	o	a team without any move contributes no leaf
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdlib.h>
+#include <chrono>
+#include "Board.h"
+
+using namespace std;
+
+
+// position with its reference counts (index i is depth i+1)
+class PerftPosition
+{
+	public:
+		PerftPosition(string name, int nTeams, int size, int playingTeam,
+		              string pawnVertices, vector<long> counts)
+		: name_(name), nTeams_(nTeams), size_(size),
+		  playingTeam_(playingTeam), pawnVertices_(pawnVertices),
+		  counts_(counts) {;}
+		
+		string name_;
+		int nTeams_;
+		int size_;
+		int playingTeam_;
+		string pawnVertices_;  // empty for the start position
+		vector<long> counts_;
+};
+
+
+// Mid-game positions were obtained by playing the given number of moves
+// with algorithmHamiltonian (temperature 0.3, seed 2020). Reference counts
+// up to depth 3 were checked against a plain search using Board::move.
+
+vector<PerftPosition> perftPositions()
+{
+	vector<PerftPosition> positions;
+	
+	positions.push_back(PerftPosition("start (2,2)", 2, 2, 0, "",
+		{6, 36, 396, 4356, 48764}));
+	positions.push_back(PerftPosition("start (2,3)", 2, 3, 0, "",
+		{10, 100, 1800, 32400, 632520}));
+	positions.push_back(PerftPosition("start (2,4)", 2, 4, 0, "",
+		{14, 196, 4760, 115600, 3188520}));
+	positions.push_back(PerftPosition("start (3,3)", 3, 3, 0, "",
+		{10, 100, 1000, 18000, 324120}));
+	positions.push_back(PerftPosition("start (6,3)", 6, 3, 0, "",
+		{10, 103, 1065, 11009, 113800}));
+	positions.push_back(PerftPosition("start (6,4)", 6, 4, 0, "",
+		{14, 199, 2828, 40189, 571130}));
+	
+	positions.push_back(PerftPosition("(2,3) after 20", 2, 3, 0,
+		"34 48 26 70 19 17 28 14 42 45 9 49",
+		{32, 1091, 36065, 1160463}));
+	positions.push_back(PerftPosition("(2,4) after 30", 2, 4, 0,
+		"111 38 113 114 45 37 40 78 119 50 51 36 48 66 31 29 57 79 84 85",
+		{56, 3037, 169309, 9378197}));
+	positions.push_back(PerftPosition("(3,3) after 45", 3, 3, 0,
+		"37 31 26 8 36 45 63 4 29 0 1 15 55 20 44 6 54 40",
+		{37, 1113, 27482, 919701}));
+	positions.push_back(PerftPosition("(6,3) after 40", 6, 3, 4,
+		"19 50 11 70 14 51 9 39 27 31 53 23 61 32 7 64 22 25 30 36 37 67 "
+		"20 6 55 34 38 58 15 60 12 1 41 21 26 5",
+		{27, 796, 20307, 649089}));
+	positions.push_back(PerftPosition("(6,3) after 90", 6, 3, 0,
+		"45 36 46 27 66 1 12 59 57 55 56 44 21 8 0 14 4 40 70 5 20 72 32 "
+		"68 53 34 25 52 43 48 62 10 38 63 65 50",
+		{20, 596, 19358, 662501}));
+	
+	return positions;
+}
+
+
+
+// Compare the two hopping move searches, returns false if they differ
+
+bool checkHopping(Board &board, int ivertex, vector<int> &destinations)
+{
+	vector<int> destinationsRec = board.availableMovesHopping(ivertex);
+	
+	for (int ivertex1 : destinationsRec)
+	{
+		bool found = false;
+		for (int ivertex2 : destinations) if (ivertex1==ivertex2) found = true;
+		if (!found) return false;
+	}
+	
+	for (int ivertex1 : destinations)
+	{
+		bool found = false;
+		for (int ivertex2 : destinationsRec) if (ivertex1==ivertex2) found = true;
+		if (!found) return false;
+	}
+	
+	// each destination has a chain of hops that Board::validPath accepts
+	for (int ivertex1 : destinations)
+	{
+		vector<int> path = board.findPath(ivertex, ivertex1);
+		if (path.size()==0 || path.back()!=ivertex1) return false;
+		if (!board.validPath(ivertex, path)) return false;
+	}
+	
+	return true;
+}
+
+
+
+long perft(Board &board, vector<int> &teams, int ply, int depth, bool check,
+           bool &checkOk)
+{
+	if (depth==0) return 1;
+	
+	// the hash updated by the moves is the one of the position
+	if (check)
+	{
+		Board boardHashed = board;
+		boardHashed.setPosition(board.getPawnVertices(), 
+		                        board.getPlayingTeam());
+		if (boardHashed.getHash() != board.getHash()) checkOk = false;
+	}
+	
+	int team = teams[ply%teams.size()];
+	int nPawns = board.getNTeams()*board.getNPawnsPerTeam();
+	vector<int> numHops;
+	long count = 0;
+	
+	for (int ipawn=0; ipawn<nPawns; ipawn++)
+	{
+		if (board.getTeamOfPawn(ipawn) != team) continue;
+		
+		int ivertexFrom = board.getVertexFromPawn(ipawn);
+		vector<int> destinations = board.availableMovesDirect(ivertexFrom);
+		vector<int> destinationsHop =
+			board.availableMovesHoppingBFS(ivertexFrom, numHops);
+		
+		if (check && !checkHopping(board, ivertexFrom, destinationsHop))
+			checkOk = false;
+		
+		for (int ivertexTo : destinationsHop) destinations.push_back(ivertexTo);
+		
+		// leaves are counted without playing the last moves
+		if (depth==1)
+		{
+			count += destinations.size();
+			continue;
+		}
+		
+		for (int ivertexTo : destinations)
+		{
+			board.moveUnchecked(ivertexFrom, ivertexTo);
+			count += perft(board, teams, ply+1, depth-1, check, checkOk);
+			board.moveUnchecked(ivertexTo, ivertexFrom);
+		}
+	}
+	
+	return count;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	///////////////////////////// Parameters ///////////////////////////////
+	
+	int maxDepth = 5;
+	bool check = false;
+	
+	for (int i=1; i<argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "check") check = true;
+		else maxDepth = atoi(argv[i]);
+	}
+	
+	cout << endl;
+	cout << "=========== Perft ============" << endl;
+	cout << endl;
+	cout << "maxDepth = " << maxDepth << endl;
+	cout << "check = " << check << endl;
+	cout << endl;
+	
+	//////////////////////////////// Runs //////////////////////////////////
+	
+	int numFailed = 0;
+	long totalLeaves = 0;
+	double totalTime = 0;
+	
+	for (PerftPosition position : perftPositions())
+	{
+		Hexagram board(position.nTeams_, position.size_);
+		
+		if (position.pawnVertices_ != "")
+		{
+			vector<int> pawnVertices;
+			stringstream stream(position.pawnVertices_);
+			int ivertex;
+			while (stream >> ivertex) pawnVertices.push_back(ivertex);
+			board.setPosition(pawnVertices, position.playingTeam_);
+		}
+		
+		// playing order, starting with the playing team
+		vector<int> winningOrder = board.getWinningOrder();
+		vector<int> teams;
+		for (int i=0; i<position.nTeams_; i++)
+		{
+			int team = (position.playingTeam_+i)%position.nTeams_;
+			if (winningOrder[team]<0) teams.push_back(team);
+		}
+		
+		for (int depth=1; depth<=maxDepth && depth<=position.counts_.size();
+		     depth++)
+		{
+			bool checkOk = true;
+			
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			long leaves = perft(board, teams, 0, depth, check, checkOk);
+			chrono::duration<double> time = chrono::steady_clock::now()-start;
+			
+			long reference = position.counts_[depth-1];
+			bool ok = (leaves == reference) && checkOk;
+			if (!ok) numFailed++;
+			
+			totalLeaves += leaves;
+			totalTime += time.count();
+			
+			cout << position.name_ << "  depth " << depth
+			     << "  leaves = " << leaves
+			     << "  reference = " << reference
+			     << "  time = " << time.count() << " s"
+			     << "  moves/s = " << leaves/max(time.count(),1e-9)
+			     << "  " << (ok ? "ok" : "FAILED")
+			     << (checkOk ? "" : " (hopping searches differ)") << endl;
+		}
+	}
+	
+	///////////////////////////// Summary //////////////////////////////////
+	
+	cout << endl;
+	cout << "Total leaves = " << totalLeaves << endl;
+	cout << "Total time = " << totalTime << " s" << endl;
+	cout << "Average moves/s = " << totalLeaves/max(totalTime,1e-9) << endl;
+	cout << "Number of failed counts = " << numFailed << endl;
+	
+	return numFailed>0;
+}
@@ -0,0 +1,192 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o record_convert record_convert.cpp \       //
+//                   Record.cpp -pthread                                  //
+//    Run with     $ ./record_convert text2bin <output> <nTeams> <size> \ //
+//                   <seed> <text record> [<text record> ...]             //
+//                 $ ./record_convert bin2text <input> <game>             //
+//                 $ ./record_convert info <input>                        //
+//                                                                        //
+//    This file is used for converting game records between the text      //
+//    format written by the game (one game per file) and the compact      //
+//    binary format of Record.h (many games per file).                    //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include "Record.h"
+
+using namespace std;
+
+
+
+
+int textToBinary(int argc, char **argv)
+{
+	if (argc<7)
+	{
+		cerr << "usage: " << argv[0] << " text2bin <output> <nTeams> <size>"
+		     << " <seed> <text record> [<text record> ...]" << endl;
+		return 1;
+	}
+	
+	int nTeams = atoi(argv[3]);
+	int size = atoi(argv[4]);
+	int seed = atoi(argv[5]);
+	
+	// games are read first to know if they contain the hops of the moves
+	vector<vector<RecordEntry>> games;
+	bool storePaths = false;
+	long numEntries = 0;
+	
+	for (int i=6; i<argc; i++)
+	{
+		ifstream textFile(argv[i]);
+		if (!textFile)
+		{
+			cerr << "Could not open " << argv[i] << endl;
+			return 1;
+		}
+		
+		games.push_back(vector<RecordEntry>());
+		
+		string line;
+		int iline = 0;
+		while (getline(textFile, line))
+		{
+			iline++;
+			if (line == "") continue;
+			
+			RecordEntry entry(-1,-1,-1);
+			if (!readRecordEntry(line, entry))
+			{
+				cerr << argv[i] << ":" << iline << ": line not recognised \""
+				     << line << "\"" << endl;
+				return 1;
+			}
+			
+			if (entry.path_.size()>0) storePaths = true;
+			games.back().push_back(entry);
+			numEntries++;
+		}
+	}
+	
+	BinaryRecordSink recordSink(argv[2], RECORD_BOARD_HEXAGRAM, size, nTeams,
+	                            seed, storePaths);
+	
+	for (vector<RecordEntry> &game : games)
+	{
+		recordSink.beginGame();
+		
+		for (RecordEntry &entry : game)
+		{
+			if (entry.type_ == RECORD_UNDO) recordSink.recordUndo();
+			else if (entry.path_.size()>0)
+				recordSink.recordMovePath(entry.ivertexFrom_, entry.path_);
+			else recordSink.recordMove(entry.ivertexFrom_, entry.ivertexTo_);
+		}
+	}
+	
+	if (recordSink.close() != 0)
+	{
+		cerr << "Could not write " << argv[2] << endl;
+		return 1;
+	}
+	
+	cout << "Converted " << argc-6 << " games (" << numEntries
+	     << " entries) into " << argv[2] << endl;
+	
+	return 0;
+}
+
+
+
+int binaryToText(int argc, char **argv)
+{
+	if (argc<4)
+	{
+		cerr << "usage: " << argv[0] << " bin2text <input> <game>" << endl;
+		return 1;
+	}
+	
+	BinaryRecordReader reader;
+	int status = reader.open(argv[2]);
+	if (status != 0)
+	{
+		cerr << "Could not read " << argv[2] << ", error code " << status
+		     << endl;
+		return 1;
+	}
+	
+	int igame = atoi(argv[3]);
+	if (igame<0 || igame>=reader.getNumGames())
+	{
+		cerr << "Game " << igame << " is not in the record ("
+		     << reader.getNumGames() << " games)" << endl;
+		return 1;
+	}
+	
+	for (RecordEntry &entry : reader.getEntries(igame))
+		writeRecordEntry(cout, entry);
+	
+	return 0;
+}
+
+
+
+int info(int argc, char **argv)
+{
+	if (argc<3)
+	{
+		cerr << "usage: " << argv[0] << " info <input>" << endl;
+		return 1;
+	}
+	
+	BinaryRecordReader reader;
+	int status = reader.open(argv[2]);
+	if (status != 0)
+	{
+		cerr << "Could not read " << argv[2] << ", error code " << status
+		     << endl;
+		return 1;
+	}
+	
+	BinaryRecordHeader header = reader.getHeader();
+	long numEntries = 0;
+	for (int i=0; i<reader.getNumGames(); i++)
+		numEntries += reader.getNumEntries(i);
+	
+	cout << "version = " << header.version_ << endl;
+	cout << "boardType = " << header.boardType_ << endl;
+	cout << "boardSize = " << header.boardSize_ << endl;
+	cout << "nTeams = " << header.nTeams_ << endl;
+	cout << "seed = " << header.seed_ << endl;
+	cout << "paths = " << reader.hasPaths() << endl;
+	cout << "numGames = " << header.numGames_ << endl;
+	cout << "numEntries = " << numEntries << endl;
+	
+	return 0;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	string mode = argc>1 ? argv[1] : "";
+	
+	if (mode == "text2bin") return textToBinary(argc, argv);
+	if (mode == "bin2text") return binaryToText(argc, argv);
+	if (mode == "info") return info(argc, argv);
+	
+	cerr << "usage: " << argv[0] << " text2bin|bin2text|info ..." << endl;
+	return 1;
+}
@@ -222,6 +222,59 @@ void renderSelectedPawn(sf::RenderWindow &window, Board board,
 
 
 
+// Draw a pawn moving along the vertices of its hops (path, starting
+// vertex included), at the given step, with the hops already made.
+
+void renderHopAnimation(sf::RenderWindow &window, Board board, int ipawn,
+                        vector<int> path, int step)
+{
+	#ifdef DEBUG_RENDERING
+	cout << "--- Rendering hop animation ---" << endl;
+	#endif
+	
+	if (ipawn<0 || path.size()==0) return;
+	if (step>=path.size()) step = path.size()-1;
+	
+	vector<Vertex> vertices = board.getVertices();
+	sf::Color color = colorOfTeam(board.getTeamOfPawn(ipawn));
+	
+	// hops already made, drawn as edges of the team color
+	for (int i=0; i<step; i++)
+	{
+		double x = vertices[path[i]].getX();
+		double y = vertices[path[i]].getY();
+		double x2 = vertices[path[i+1]].getX();
+		double y2 = vertices[path[i+1]].getY();
+		
+		double d = sqrt((x2-x)*(x2-x)+(y2-y)*(y2-y));
+		double angle = atan2(y2-y,x2-x) * 180/PI;
+		
+		double hopWidth = 0.06;
+		sf::RectangleShape hopShape(sf::Vector2f(d,hopWidth));
+		hopShape.setFillColor(color);
+		hopShape.setRotation(angle);
+		
+		// correct position to take into account the rectangle width
+		double xc = x - hopWidth/2*cos(PI/180*(angle+90));
+		double yc = y - hopWidth/2*sin(PI/180*(angle+90));
+		hopShape.setPosition(sf::Vector2f(xc,yc));
+		
+		window.draw(hopShape);
+	}
+	
+	// pawn at the current step
+	double pawnSize = 0.2;
+	sf::CircleShape pawnShape(pawnSize);
+	pawnShape.setPosition(sf::Vector2f(vertices[path[step]].getX()-pawnSize,
+	                                   vertices[path[step]].getY()-pawnSize));
+	pawnShape.setFillColor(color);
+	
+	window.draw(pawnShape);
+}
+
+
+
+
 void renderWinners(sf::RenderWindow &window, Hexagram board)
 {
 	#ifdef DEBUG_RENDERING
@@ -0,0 +1,383 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o replay replay.cpp Board.h Board.cpp \     //
+//                   Record.cpp -pthread                                  //
+//    Run with     $ ./replay [-j threads] [-b nTeams size] <record> ...  //
+//                                                                        //
+//    This file is used for checking archives of recorded games. Every    //
+//    game is replayed with Board::move, on all the cores, and the final  //
+//    winning orders are checked. Binary records (see Record.h) contain   //
+//    many games and their board; text records contain one game each and  //
+//    are played on the board given by -b (default 6 teams, size 3).      //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Errors of a replayed game (first invalid entry)
+//	o	1, 2, 3: error code of Board::move
+//	o	4: undo without any move to undo
+//	o	5: the game is finished but entries remain
+//	Games that end before all teams reach their target are counted as
+//	unfinished, not as invalid. Moves recorded with their hops are checked
+//	hop by hop (Board::movePath) instead of searching all the hops.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "Board.h"
+
+using namespace std;
+
+
+// a game in one of the records
+class ReplayGame
+{
+	public:
+		int irecord_;
+		int igame_;       // game in a binary record, -1 for a text record
+};
+
+// source of the games, binary or text
+class ReplayRecord
+{
+	public:
+		string filename_;
+		int nTeams_;
+		int size_;
+		BinaryRecordReader *reader_;      // NULL for a text record
+		vector<RecordEntry> textEntries_;
+};
+
+class ReplayResult
+{
+	public:
+		ReplayResult() : numMoves_(0), numUndos_(0), numOutOfTurn_(0),
+		                 error_(0), ientryError_(-1), ivertexFrom_(-1),
+		                 ivertexTo_(-1), finished_(false),
+		                 winningOrderOk_(true), winner_(-1) {;}
+		
+		long numMoves_;
+		long numUndos_;
+		long numOutOfTurn_;  // moves of another team than the playing one
+		int error_;          // 0 if all entries are valid
+		int ientryError_;
+		int ivertexFrom_;
+		int ivertexTo_;
+		bool finished_;
+		bool winningOrderOk_;
+		int winner_;
+};
+
+
+
+// Check that the teams on target are ranked 1, 2, ... without gaps
+
+bool checkWinningOrder(Hexagram &board)
+{
+	vector<int> winningOrder = board.getWinningOrder();
+	vector<int> ranks;
+	for (int rank : winningOrder) if (rank>=0) ranks.push_back(rank);
+	sort(ranks.begin(), ranks.end());
+	
+	for (int i=0; i<ranks.size(); i++) if (ranks[i]!=i+1) return false;
+	if (ranks.size() != board.teamsOnTarget().size()) return false;
+	
+	return true;
+}
+
+
+
+ReplayResult replayGame(Hexagram &start, ReplayRecord &record, int igame)
+{
+	ReplayResult result;
+	Hexagram board = start;
+	vector<Hexagram> boardSaves;
+	
+	vector<RecordEntry> entries = record.reader_ ?
+	                              record.reader_->getEntries(igame) :
+	                              record.textEntries_;
+	int nVertices = board.getVertices().size();
+	NullRecordSink recordSink;
+	
+	for (int i=0; i<entries.size(); i++)
+	{
+		RecordEntry &entry = entries[i];
+		int error = 0;
+		
+		if (board.getPlayingTeam()<0)
+		{
+			error = 5;
+		}
+		else if (entry.type_ == RECORD_UNDO)
+		{
+			if (boardSaves.size()>0)
+			{
+				board = boardSaves.back();
+				boardSaves.pop_back();
+				result.numUndos_++;
+			}
+			else error = 4;
+		}
+		else
+		{
+			int ipawn = -1;
+			if (entry.ivertexFrom_>=0 && entry.ivertexFrom_<nVertices)
+				ipawn = board.getPawnFromVertex(entry.ivertexFrom_);
+			
+			if (ipawn<0) error = 2;
+			else
+			{
+				if (board.getTeamOfPawn(ipawn) != board.getPlayingTeam())
+					result.numOutOfTurn_++;
+				
+				boardSaves.push_back(board);
+				
+				// moves with their hops are checked hop by hop, direct moves
+				// and single hops too, other moves need a search
+				vector<int> path = entry.path_;
+				if (path.size()==0) path.push_back(entry.ivertexTo_);
+				
+				if (entry.path_.size()>0 ||
+				    board.validPath(entry.ivertexFrom_, path))
+					error = board.movePath(ipawn, path, recordSink);
+				else
+					error = board.move(ipawn, entry.ivertexTo_);
+				
+				if (error==0) result.numMoves_++;
+			}
+		}
+		
+		if (error != 0)
+		{
+			result.error_ = error;
+			result.ientryError_ = i;
+			result.ivertexFrom_ = entry.ivertexFrom_;
+			result.ivertexTo_ = entry.ivertexTo_;
+			return result;
+		}
+	}
+	
+	result.finished_ = board.getPlayingTeam()<0;
+	result.winningOrderOk_ = checkWinningOrder(board);
+	
+	vector<int> winningOrder = board.getWinningOrder();
+	for (int team=0; team<winningOrder.size(); team++)
+		if (winningOrder[team]==1) result.winner_ = team;
+	
+	return result;
+}
+
+
+
+// Replay the games taken from a shared counter
+
+void replayWorker(vector<ReplayRecord> &records, vector<ReplayGame> &games,
+                  vector<ReplayResult> &results, atomic<int> &nextGame)
+{
+	// start positions, built once per thread
+	vector<Hexagram> starts;
+	for (ReplayRecord &record : records)
+		starts.push_back(Hexagram(record.nTeams_, record.size_));
+	
+	while (true)
+	{
+		int i = nextGame.fetch_add(1);
+		if (i>=games.size()) break;
+		
+		ReplayGame &game = games[i];
+		results[i] = replayGame(starts[game.irecord_], records[game.irecord_],
+		                        game.igame_);
+	}
+}
+
+
+
+int main(int argc, char **argv)
+{
+	///////////////////////////// Parameters ///////////////////////////////
+	
+	int numThreads = thread::hardware_concurrency();
+	int nTeamsText = 6;
+	int sizeText = 3;
+	vector<string> filenames;
+	
+	for (int i=1; i<argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "-j" && i+1<argc) numThreads = atoi(argv[++i]);
+		else if (arg == "-b" && i+2<argc)
+		{
+			nTeamsText = atoi(argv[++i]);
+			sizeText = atoi(argv[++i]);
+		}
+		else filenames.push_back(arg);
+	}
+	if (numThreads<1) numThreads = 1;
+	
+	if (filenames.size()==0)
+	{
+		cerr << "usage: " << argv[0] << " [-j threads] [-b nTeams size]"
+		     << " <record> [<record> ...]" << endl;
+		return 1;
+	}
+	
+	////////////////////////////// Records /////////////////////////////////
+	
+	vector<ReplayRecord> records;
+	vector<ReplayGame> games;
+	
+	for (string filename : filenames)
+	{
+		ReplayRecord record;
+		record.filename_ = filename;
+		record.reader_ = new BinaryRecordReader();
+		
+		int status = record.reader_->open(filename);
+		if (status == 1)
+		{
+			cerr << "Could not open " << filename << endl;
+			return 1;
+		}
+		
+		if (status == 0)
+		{
+			BinaryRecordHeader header = record.reader_->getHeader();
+			if (header.boardType_ != RECORD_BOARD_HEXAGRAM)
+			{
+				cerr << filename << ": unknown board type " << header.boardType_
+				     << endl;
+				return 1;
+			}
+			record.nTeams_ = header.nTeams_;
+			record.size_ = header.boardSize_;
+			
+			for (int igame=0; igame<record.reader_->getNumGames(); igame++)
+			{
+				ReplayGame game = {int(records.size()), igame};
+				games.push_back(game);
+			}
+		}
+		else
+		{
+			// not a binary record, read as text
+			delete record.reader_;
+			record.reader_ = NULL;
+			record.nTeams_ = nTeamsText;
+			record.size_ = sizeText;
+			
+			ifstream textFile(filename);
+			string line;
+			while (getline(textFile, line))
+			{
+				RecordEntry entry(-1,-1,-1);
+				if (readRecordEntry(line, entry))
+					record.textEntries_.push_back(entry);
+				else if (line != "")
+					cerr << filename << ": line ignored \"" << line << "\"" << endl;
+			}
+			
+			ReplayGame game = {int(records.size()), -1};
+			games.push_back(game);
+		}
+		
+		records.push_back(record);
+	}
+	
+	cout << endl;
+	cout << "=========== Replay ============" << endl;
+	cout << endl;
+	cout << "records = " << records.size() << endl;
+	cout << "games = " << games.size() << endl;
+	cout << "threads = " << numThreads << endl;
+	cout << endl;
+	
+	////////////////////////////// Replay //////////////////////////////////
+	
+	vector<ReplayResult> results(games.size());
+	atomic<int> nextGame(0);
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	vector<thread> workers;
+	for (int i=0; i<numThreads; i++)
+		workers.push_back(thread(replayWorker, ref(records), ref(games),
+		                         ref(results), ref(nextGame)));
+	for (thread &worker : workers) worker.join();
+	
+	chrono::duration<double> time = chrono::steady_clock::now()-start;
+	
+	////////////////////////////// Report //////////////////////////////////
+	
+	long numMoves = 0;
+	long numUndos = 0;
+	long numOutOfTurn = 0;
+	int numInvalid = 0;
+	int numUnfinished = 0;
+	int numBadWinningOrder = 0;
+	vector<int> wins;
+	
+	for (int i=0; i<games.size(); i++)
+	{
+		ReplayResult &result = results[i];
+		ReplayRecord &record = records[games[i].irecord_];
+		
+		numMoves += result.numMoves_;
+		numUndos += result.numUndos_;
+		numOutOfTurn += result.numOutOfTurn_;
+		
+		if (result.error_ != 0)
+		{
+			// first invalid entry of the first corrupt games
+			if (numInvalid<20)
+			{
+				cout << record.filename_;
+				if (games[i].igame_>=0) cout << " game " << games[i].igame_;
+				cout << ": entry " << result.ientryError_
+				     << " from vertex " << result.ivertexFrom_
+				     << " to " << result.ivertexTo_
+				     << " is invalid, error code " << result.error_ << endl;
+			}
+			numInvalid++;
+			continue;
+		}
+		
+		if (!result.finished_) numUnfinished++;
+		if (!result.winningOrderOk_) numBadWinningOrder++;
+		
+		if (result.winner_>=0)
+		{
+			if (result.winner_>=wins.size()) wins.resize(result.winner_+1,0);
+			wins[result.winner_]++;
+		}
+	}
+	
+	if (numInvalid>0) cout << endl;
+	cout << "Number of replayed games is " << games.size() << endl;
+	cout << "Number of invalid games is " << numInvalid << endl;
+	cout << "Number of unfinished games is " << numUnfinished << endl;
+	cout << "Number of inconsistent winning orders is " << numBadWinningOrder
+	     << endl;
+	cout << "Number of moves is " << numMoves << " (" << numUndos
+	     << " undos, " << numOutOfTurn << " out of turn)" << endl;
+	for (int team=0; team<wins.size(); team++)
+		cout << "Games won by team " << team << ": " << wins[team] << endl;
+	
+	cout << endl;
+	cout << "Time = " << time.count() << " s" << endl;
+	cout << "Games/s = " << games.size()/max(time.count(),1e-9) << endl;
+	cout << "Moves/s = " << numMoves/max(time.count(),1e-9) << endl;
+	
+	for (ReplayRecord &record : records) delete record.reader_;
+	
+	return numInvalid>0 || numBadWinningOrder>0;
+}
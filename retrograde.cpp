@@ -0,0 +1,446 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o retrograde retrograde.cpp Board.h \       //
+//                   Board.cpp Record.cpp -pthread                        //
+//    Run with     $ ./retrograde [-j threads] [-k maxOutside] \          //
+//                   [-m megabytes] [size ...]                            //
+//                                                                        //
+//    This file is used for generating the endgame tablebases of the      //
+//    games with two teams (see tablebase.cpp), written in                //
+//    data/tablebase_<size>.tb, and for checking them by playing the      //
+//    perfect games of sampled positions with Board::move.                //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The subtables are solved in the order of the number of pawns outside,
+//	a move never increases it. Within a subtable, the pass p sets the
+//	positions decided in p plies: at odd p the wins (a move to a position
+//	lost in p-1 plies, or a move that fills the target when p=1), at even
+//	p the losses (all the moves lead to a position won in at most p-1
+//	plies, one of them in exactly p-1). The passes stop when one changes
+//	nothing and no position of the lower subtables is decided later.
+//	The positions are shared between the threads by blocks.
+//
+//	Memory: one byte per position of all the subtables during the
+//	generation, limited by -m (in megabytes).
+//
+//	Size of the subtables (positions, maxOutside=1 / 2)
+//	o	size 2: 2e4 / 6e6
+//	o	size 3: 3e5 / 2e9
+//	o	size 4: 2e6 / 3e10
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <random>
+#include "Board.h"
+#include "tablebase.cpp"
+
+using namespace std;
+
+
+const uint8_t RETROGRADE_UNUSED = 255;
+const uint64_t RETROGRADE_BLOCK = 4096;
+
+class RetrogradeGenerator
+{
+	public:
+		RetrogradeGenerator(TablebaseLayout &layout, int numThreads);
+		
+		// Returns the number of passes
+		int solveSubtable(int subtable);
+		int write(string filename);
+		
+		void count(int subtable, uint64_t &numWon, uint64_t &numLost,
+		           uint64_t &numUnresolved);
+		int getMaxValue(int subtable) {return maxValues_[subtable];}
+	
+	protected:
+		void markUnused(int subtable, int p, TablebaseLayout layout);
+		void pass(int subtable, int p, TablebaseLayout layout);
+		int childValue(TablebaseChild &child);
+		void runThreads(void (RetrogradeGenerator::*work)(int,int,
+		                TablebaseLayout), int subtable, int p);
+		
+		TablebaseLayout &layout_;
+		int numThreads_;
+		vector<vector<uint8_t>> values_;
+		vector<int> maxValues_;
+		
+		// shared by the threads during a pass
+		atomic<uint64_t> nextBlock_;
+		atomic<long> numChanged_;
+};
+
+
+
+
+RetrogradeGenerator::RetrogradeGenerator(TablebaseLayout &layout,
+                                         int numThreads)
+: layout_(layout), numThreads_(numThreads),
+  values_(layout.getNumSubtables()), maxValues_(layout.getNumSubtables(),0)
+{;}
+
+// values of the subtable being solved are written by the other threads,
+// the positions set during a pass are not used by that pass
+
+int RetrogradeGenerator::childValue(TablebaseChild &child)
+{
+	if (child.terminal_) return TABLEBASE_TERMINAL;
+	
+	uint8_t value = __atomic_load_n(&values_[child.subtable_][child.index_],
+	                                __ATOMIC_RELAXED);
+	return value==0 ? TABLEBASE_UNRESOLVED : value;
+}
+
+void RetrogradeGenerator::markUnused(int subtable, int p,
+                                     TablebaseLayout layout)
+{
+	vector<uint8_t> &values = values_[subtable];
+	TablebasePosition position;
+	
+	for (uint64_t block=nextBlock_++; block*RETROGRADE_BLOCK<values.size();
+	     block=nextBlock_++)
+	{
+		uint64_t end = min((block+1)*RETROGRADE_BLOCK, (uint64_t)values.size());
+		for (uint64_t index=block*RETROGRADE_BLOCK; index<end; index++)
+			if (!layout.decode(subtable, index, position))
+				values[index] = RETROGRADE_UNUSED;
+	}
+}
+
+void RetrogradeGenerator::pass(int subtable, int p, TablebaseLayout layout)
+{
+	vector<uint8_t> &values = values_[subtable];
+	TablebasePosition position;
+	vector<TablebaseChild> children;
+	long numChanged = 0;
+	
+	for (uint64_t block=nextBlock_++; block*RETROGRADE_BLOCK<values.size();
+	     block=nextBlock_++)
+	{
+		uint64_t end = min((block+1)*RETROGRADE_BLOCK, (uint64_t)values.size());
+		for (uint64_t index=block*RETROGRADE_BLOCK; index<end; index++)
+		{
+			if (__atomic_load_n(&values[index], __ATOMIC_RELAXED) != 0) continue;
+			
+			layout.decode(subtable, index, position);
+			layout.children(position, children);
+			if (children.size()==0) continue;
+			
+			bool decided = false;
+			if (p%2==1)
+			{
+				// a move to a position lost by the other team
+				for (TablebaseChild &child : children)
+					if (childValue(child) == p-1)
+					{
+						decided = true;
+						break;
+					}
+			}
+			else
+			{
+				// all the moves lead to positions won by the other team
+				int maxValue = 0;
+				decided = true;
+				for (TablebaseChild &child : children)
+				{
+					int value = childValue(child);
+					if (value<=0 || value%2==0)
+					{
+						decided = false;
+						break;
+					}
+					maxValue = max(maxValue, value);
+				}
+				decided = decided && maxValue == p-1;
+			}
+			
+			if (decided)
+			{
+				__atomic_store_n(&values[index], (uint8_t)p, __ATOMIC_RELAXED);
+				numChanged++;
+			}
+		}
+	}
+	
+	numChanged_ += numChanged;
+}
+
+void RetrogradeGenerator::runThreads(void (RetrogradeGenerator::*work)(int,
+                                     int, TablebaseLayout), int subtable, int p)
+{
+	nextBlock_ = 0;
+	numChanged_ = 0;
+	
+	vector<thread> workers;
+	for (int i=0; i<numThreads_; i++)
+		workers.push_back(thread(work, this, subtable, p, layout_));
+	for (thread &worker : workers) worker.join();
+}
+
+int RetrogradeGenerator::solveSubtable(int subtable)
+{
+	values_[subtable] = vector<uint8_t>(layout_.subtableSize(subtable),0);
+	runThreads(&RetrogradeGenerator::markUnused, subtable, 0);
+	
+	// largest value of the subtables it depends on
+	int maxLower = 0;
+	int n0 = layout_.subtableN0(subtable);
+	int n1 = layout_.subtableN1(subtable);
+	for (int i=0; i<values_.size(); i++)
+		if (i!=subtable && layout_.subtableN0(i)<=n0 &&
+		    layout_.subtableN1(i)<=n1)
+			maxLower = max(maxLower, maxValues_[i]);
+	
+	int p = 1;
+	for (; p<=TABLEBASE_MAX_VALUE; p++)
+	{
+		runThreads(&RetrogradeGenerator::pass, subtable, p);
+		if (numChanged_ > 0) maxValues_[subtable] = p;
+		else if (p > maxLower) break;
+	}
+	
+	return p;
+}
+
+void RetrogradeGenerator::count(int subtable, uint64_t &numWon,
+                                uint64_t &numLost, uint64_t &numUnresolved)
+{
+	numWon = 0;
+	numLost = 0;
+	numUnresolved = 0;
+	for (uint8_t value : values_[subtable])
+	{
+		if (value == RETROGRADE_UNUSED) continue;
+		else if (value == 0) numUnresolved++;
+		else if (value%2 == 1) numWon++;
+		else numLost++;
+	}
+}
+
+// Values packed on the bits needed by the largest one, the unused
+// positions written as 0. A spare byte ends each subtable so that a value
+// can always be read as two bytes.
+
+int RetrogradeGenerator::write(string filename)
+{
+	TablebaseHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic_, "CCENDTB1", 8);
+	header.version_ = TABLEBASE_VERSION;
+	header.boardSize_ = layout_.getBoardSize();
+	header.nVertices_ = layout_.getNVertices();
+	header.maxOutside_ = layout_.getMaxOutside();
+	header.numSubtables_ = layout_.getNumSubtables();
+	
+	vector<TablebaseSubtable> subtables(header.numSubtables_);
+	uint64_t offset = sizeof(header) + subtables.size()*sizeof(TablebaseSubtable);
+	for (int i=0; i<subtables.size(); i++)
+	{
+		TablebaseSubtable &table = subtables[i];
+		table.n0_ = layout_.subtableN0(i);
+		table.n1_ = layout_.subtableN1(i);
+		table.maxValue_ = maxValues_[i];
+		table.bits_ = 1;
+		while ((1<<table.bits_) <= maxValues_[i]) table.bits_++;
+		table.offset_ = offset;
+		table.count_ = values_[i].size();
+		offset += (table.count_*table.bits_+8+63)/64*8;
+	}
+	
+	ofstream file(filename, ios::binary);
+	file.write((char*)&header, sizeof(header));
+	file.write((char*)subtables.data(), subtables.size()*sizeof(TablebaseSubtable));
+	
+	for (int i=0; i<subtables.size(); i++)
+	{
+		TablebaseSubtable &table = subtables[i];
+		vector<uint8_t> packed((table.count_*table.bits_+8+63)/64*8,0);
+		for (uint64_t index=0; index<table.count_; index++)
+		{
+			uint8_t value = values_[i][index];
+			if (value == RETROGRADE_UNUSED) value = 0;
+			uint64_t bit = index*table.bits_;
+			uint16_t shifted = value << (bit%8);
+			packed[bit/8] |= shifted & 0xff;
+			packed[bit/8+1] |= shifted >> 8;
+		}
+		file.write((char*)packed.data(), packed.size());
+	}
+	
+	file.close();
+	return file ? 0 : 1;
+}
+
+
+
+// Plays the perfect game from sampled positions with the tablebases and
+// Board::move, the game must end after the number of plies of the value
+// with the expected winner. Returns the number of failures.
+
+int checkTablebase(string filename, int numSamples)
+{
+	EndgameTablebase tablebase;
+	if (tablebase.open(filename) != 0) return numSamples;
+	
+	TablebaseHeader header;
+	ifstream file(filename, ios::binary);
+	file.read((char*)&header, sizeof(header));
+	file.close();
+	
+	Hexagram board(2, header.boardSize_);
+	TablebaseLayout layout(board, header.maxOutside_);
+	default_random_engine gen(header.boardSize_);
+	
+	int numFailures = 0;
+	int numChecked = 0;
+	for (int attempt=0; attempt<100*numSamples && numChecked<numSamples;
+	     attempt++)
+	{
+		int subtable = gen()%layout.getNumSubtables();
+		uint64_t index = gen()%layout.subtableSize(subtable);
+		TablebasePosition position;
+		if (!layout.decode(subtable, index, position)) continue;
+		int value = tablebase.value(subtable, index);
+		if (value==0) continue;
+		numChecked++;
+		
+		board.setPosition(layout.pawnVertices(position), position.side_);
+		int winner = value%2==1 ? position.side_ : 1-position.side_;
+		
+		int plies = 0;
+		int ipawn, ivertex, v;
+		while (board.getWinningOrder()[winner]<0 && plies<value &&
+		       tablebase.perfectMove(board, ipawn, ivertex, v) &&
+		       board.move(ipawn, ivertex)==0) plies++;
+		
+		if (plies!=value || board.getWinningOrder()[winner]!=1) numFailures++;
+	}
+	
+	return numFailures;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	///////////////////////////// Parameters ///////////////////////////////
+	
+	int numThreads = thread::hardware_concurrency();
+	int maxOutside = 1;
+	long maxMegabytes = 2048;
+	int numSamples = 1000;
+	vector<int> sizes;
+	
+	for (int i=1; i<argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "-j" && i+1<argc) numThreads = atoi(argv[++i]);
+		else if (arg == "-k" && i+1<argc) maxOutside = atoi(argv[++i]);
+		else if (arg == "-m" && i+1<argc) maxMegabytes = atol(argv[++i]);
+		else sizes.push_back(atoi(argv[i]));
+	}
+	if (numThreads<1) numThreads = 1;
+	if (sizes.size()==0) sizes = {2, 3, 4};
+	if (maxOutside<1 || maxOutside>TABLEBASE_MAX_OUTSIDE)
+	{
+		cerr << "maxOutside must be between 1 and " << TABLEBASE_MAX_OUTSIDE
+		     << endl;
+		return 1;
+	}
+	
+	if (system("mkdir -p data") != 0)
+	{
+		cerr << "Could not create the directory data" << endl;
+		return 1;
+	}
+	
+	cout << endl;
+	cout << "=========== Retrograde analysis ============" << endl;
+	cout << endl;
+	cout << "threads = " << numThreads << endl;
+	cout << "maxOutside = " << maxOutside << endl;
+	cout << "memory = " << maxMegabytes << " MB" << endl;
+	
+	for (int size : sizes)
+	{
+		Hexagram board(2, size);
+		if (maxOutside > board.getNPawnsPerTeam())
+		{
+			cerr << "Size " << size << " has only " << board.getNPawnsPerTeam()
+			     << " pawns per team" << endl;
+			return 1;
+		}
+		TablebaseLayout layout(board, maxOutside);
+		
+		uint64_t totalSize = 0;
+		for (int i=0; i<layout.getNumSubtables(); i++)
+			totalSize += layout.subtableSize(i);
+		if (totalSize > maxMegabytes*1000000)
+		{
+			cerr << "Size " << size << ": " << totalSize/1000000
+			     << " MB needed, reduce maxOutside or increase -m" << endl;
+			return 1;
+		}
+		
+		cout << endl;
+		cout << "Size " << size << " (" << totalSize << " positions)" << endl;
+		
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		RetrogradeGenerator generator(layout, numThreads);
+		
+		// subtables in the order of the number of pawns outside
+		for (int nTotal=2; nTotal<=2*maxOutside; nTotal++)
+			for (int n0=1; n0<=maxOutside; n0++)
+			{
+				int n1 = nTotal-n0;
+				if (n1<1 || n1>maxOutside) continue;
+				
+				int subtable = layout.subtableOf(n0, n1);
+				int passes = generator.solveSubtable(subtable);
+				
+				uint64_t numWon, numLost, numUnresolved;
+				generator.count(subtable, numWon, numLost, numUnresolved);
+				cout << "  (" << n0 << "," << n1 << "): "
+				     << layout.subtableSize(subtable) << " indices, "
+				     << numWon << " won, " << numLost << " lost, "
+				     << numUnresolved << " not resolved, longest "
+				     << generator.getMaxValue(subtable) << " plies, "
+				     << passes << " passes" << endl;
+			}
+		
+		chrono::duration<double> time = chrono::steady_clock::now()-start;
+		
+		string filename = "data/tablebase_" + to_string(size) + ".tb";
+		if (generator.write(filename) != 0)
+		{
+			cerr << "Could not write " << filename << endl;
+			return 1;
+		}
+		
+		ifstream file(filename, ios::binary | ios::ate);
+		cout << "Time = " << time.count() << " s" << endl;
+		cout << "Written " << filename << " (" << file.tellg() << " bytes for "
+		     << totalSize << " positions)" << endl;
+		
+		int numFailures = checkTablebase(filename, numSamples);
+		cout << "Check of " << numSamples << " perfect games: " << numFailures
+		     << " failures" << endl;
+		if (numFailures>0) return 1;
+	}
+	
+	return 0;
+}
@@ -4,27 +4,109 @@ if [ $# -gt 0 ]
 then
 	if [ $1 == "debug" ]
 	then
-		g++ -o chinese_checkers main.cpp Board.h Board.cpp \
-			-lsfml-graphics -lsfml-window -lsfml-system \
+		g++ -o chinese_checkers main.cpp Board.h Board.cpp Record.cpp \
+			-lsfml-graphics -lsfml-window -lsfml-system -pthread \
 			-DDEBUG
 		./chinese_checkers > out.txt 2> out2.txt
 	fi
 	
+	# "./run.sh trace [text|chrome]" decodes the trace of the debug build
+	if [ $1 == "trace" ]
+	then
+		g++ -O3 -o trace_decode trace_decode.cpp
+		./trace_decode data/trace.bin ${@:2}
+	fi
+	
+	# "./run.sh convert text2bin|bin2text|info ..." (see record_convert.cpp)
+	if [ $1 == "convert" ]
+	then
+		g++ -O3 -o record_convert record_convert.cpp Record.cpp -pthread
+		./record_convert ${@:2}
+	fi
+	
+	# "./run.sh replay [-j threads] [-b nTeams size] <record> ..."
+	if [ $1 == "replay" ]
+	then
+		g++ -O3 -o replay replay.cpp Board.h Board.cpp Record.cpp -pthread
+		./replay ${@:2}
+	fi
+	
+	# "./run.sh tune [-j threads] [-o weights] ... <shard> ..."
+	if [ $1 == "tune" ]
+	then
+		g++ -O3 -o tune tune.cpp Board.h Board.cpp Record.cpp Dataset.cpp \
+			-pthread
+		./tune ${@:2}
+	fi
+	
+	# "./run.sh sweep [-j threads] [-m minGames] [-g maxGames] ... [grid]"
+	if [ $1 == "sweep" ]
+	then
+		g++ -O3 -o sweep sweep.cpp Board.h Board.cpp Record.cpp -pthread
+		./sweep ${@:2}
+	fi
+	
 	if [ $1 == "tests" ]
 	then
 		mkdir -p analysis
 		git log | head > analysis/code_version.txt
 		
-		g++ -O3 -o tests test_algorithms.cpp Board.h Board.cpp \
-			-lsfml-graphics -lsfml-window -lsfml-system
+		# "./run.sh tests instrument" for the hot path counters and timers
+		FLAGS=""
+		if [ $# -gt 1 ] && [ $2 == "instrument" ]
+		then
+			FLAGS="-DINSTRUMENT"
+		fi
+		
+		g++ -O3 -o tests test_algorithms.cpp Board.h Board.cpp Record.cpp \
+			Dataset.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread \
+			$FLAGS
 		time ./tests > analysis/out.txt 2> analysis/out2.txt &
 		
 		cat analysis/out.txt
 		cat analysis/out2.txt
 	fi
+	
+	if [ $1 == "perft" ]
+	then
+		g++ -O3 -o perft perft.cpp Board.h Board.cpp Record.cpp -pthread
+		./perft ${@:2}
+	fi
+	
+	# "./run.sh check [numGames]" checks the incremental evaluations
+	if [ $1 == "check" ]
+	then
+		g++ -O3 -o check check.cpp Board.h Board.cpp Record.cpp -pthread
+		./check ${@:2}
+	fi
+	
+	# "./run.sh solitaire [-j threads] [-n nodes] [size ...]"
+	if [ $1 == "solitaire" ]
+	then
+		g++ -O3 -o solitaire solitaire.cpp Board.h Board.cpp Record.cpp -pthread
+		./solitaire ${@:2}
+	fi
+	
+	# "./run.sh retrograde [-j threads] [-k maxOutside] [-m megabytes] [size ...]"
+	if [ $1 == "retrograde" ]
+	then
+		g++ -O3 -o retrograde retrograde.cpp Board.h Board.cpp Record.cpp \
+			-pthread
+		./retrograde ${@:2}
+	fi
+	
+	if [ $1 == "bench" ]
+	then
+		mkdir -p analysis
+		git log | head > analysis/code_version.txt
+		
+		g++ -O3 -o benchmark benchmark.cpp Board.h Board.cpp Record.cpp \
+			-pthread
+		./benchmark ${@:2}
+	fi
 else
-	g++ -o chinese_checkers main.cpp Board.h Board.cpp \
-		-lsfml-graphics -lsfml-window -lsfml-system
+	g++ -o chinese_checkers main.cpp Board.h Board.cpp Record.cpp \
+		-lsfml-graphics -lsfml-window -lsfml-system -pthread
 	./chinese_checkers 
 fi
 
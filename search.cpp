@@ -0,0 +1,418 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the lookahead search and the management     //
+//    of the time spent per move in the chinese checkers game.            //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The search is an iterative deepening alpha-beta search in which the
+//	playing team maximises its evaluation and all the other teams try to
+//	minimise it ("paranoid" search). It is anytime: each decision comes
+//	with limits (time and/or number of nodes), the search polls them
+//	regularly and returns the best move found so far when they are reached.
+
+
+#ifndef SEARCH
+#define SEARCH
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "Board.h"
+#include "instrumentation.h"
+#include "trace.h"
+#include "moveOrdering.cpp"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const int SEARCH_INFINITY = 1<<30;
+const int SEARCH_MAX_DEPTH = 32;
+const int SEARCH_POLL_INTERVAL = 256; // nodes between two clock readings
+
+// limits given to an algorithm for one decision
+class SearchLimits
+{
+	public:
+		SearchLimits(double timeBudget=-1, long nodeBudget=-1,
+		             int maxDepth=SEARCH_MAX_DEPTH)
+		: timeBudget_(timeBudget), nodeBudget_(nodeBudget),
+		  maxDepth_(maxDepth) {;}
+		
+		// true if the time or the number of nodes is limited
+		bool bounded() {return timeBudget_>=0 || nodeBudget_>=0;}
+		
+		double timeBudget_; // seconds, negative for no limit
+		long nodeBudget_;   // negative for no limit
+		int maxDepth_;
+};
+
+// cooperative clock polled inside the search
+class SearchClock
+{
+	public:
+		SearchClock(SearchLimits limits)
+		: limits_(limits), nodes_(0), stopped_(false)
+		{
+			start_ = chrono::steady_clock::now();
+		}
+		
+		bool poll();
+		bool stopped() {return stopped_;}
+		long getNodes() {return nodes_;}
+		SearchLimits getLimits() {return limits_;}
+		double elapsed();
+	
+	protected:
+		SearchLimits limits_;
+		chrono::steady_clock::time_point start_;
+		long nodes_;
+		bool stopped_;
+};
+
+// best move found so far, readable at any time
+class SearchResult
+{
+	public:
+		SearchResult() : ivertexFrom_(-1), ivertexTo_(-1), score_(0),
+		                 depth_(0), nodes_(0), time_(0) {;}
+		
+		int ivertexFrom_;
+		int ivertexTo_;
+		int score_;
+		int depth_;    // last completed depth
+		long nodes_;
+		double time_;
+};
+
+// latencies of the decisions, to check that the budget is respected
+class LatencyLog
+{
+	public:
+		void add(double seconds) {latencies_.push_back(seconds);}
+		void add(LatencyLog &other)
+		{
+			for (double seconds : other.latencies_) add(seconds);
+		}
+		int size() {return latencies_.size();}
+		void clear() {latencies_.clear();}
+		double percentile(double fraction);
+		void report(ostream &out);
+	
+	protected:
+		vector<double> latencies_;
+};
+
+// state of the search, board is modified and restored during the search
+class Search
+{
+	public:
+		Search(Board &board, SearchLimits limits);
+		
+		SearchResult run();
+		SearchResult getResult() {return result_;}
+	
+	protected:
+		int searchNode(int depth, int ply, int alpha, int beta);
+		int evaluate();
+		void makeMove(int ivertexFrom, int ivertexTo);
+		void unmakeMove(int ivertexFrom, int ivertexTo);
+		
+		Board &board_;
+		SearchClock clock_;
+		MoveOrdering ordering_;
+		SearchResult result_;
+		int rootTeam_;
+		vector<int> teams_;          // playing order, root team first
+		vector<int> teamDistances_;  // summed distances to best targets
+		vector<int> bestTargets_;
+};
+
+// Algorithm using the search
+void algorithmSearch(Board &board, int &ipawnToMove, int &ivertexDestination,
+                     SearchLimits limits);
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+// Returns true when the search must stop. The time is only read every
+// few nodes as it is much more expensive than a node count.
+
+bool SearchClock::poll()
+{
+	nodes_++;
+	
+	if (stopped_) return true;
+	
+	if (limits_.nodeBudget_>=0 && nodes_>=limits_.nodeBudget_)
+		stopped_ = true;
+	
+	if (limits_.timeBudget_>=0 && nodes_%SEARCH_POLL_INTERVAL==0)
+		if (elapsed()>=limits_.timeBudget_) stopped_ = true;
+	
+	return stopped_;
+}
+
+
+
+double SearchClock::elapsed()
+{
+	chrono::duration<double> time = chrono::steady_clock::now() - start_;
+	return time.count();
+}
+
+
+
+
+double LatencyLog::percentile(double fraction)
+{
+	if (latencies_.size()==0) return 0;
+	
+	vector<double> sorted = latencies_;
+	sort(sorted.begin(), sorted.end());
+	
+	int index = int(fraction*(sorted.size()-1)+0.5);
+	return sorted[index];
+}
+
+
+
+void LatencyLog::report(ostream &out)
+{
+	out << "Move latency over " << latencies_.size() << " moves (ms): "
+	    << "p50 = " << 1e3*percentile(0.50) << " "
+	    << "p90 = " << 1e3*percentile(0.90) << " "
+	    << "p99 = " << 1e3*percentile(0.99) << " "
+	    << "max = " << 1e3*percentile(1.00) << endl;
+}
+
+
+
+
+Search::Search(Board &board, SearchLimits limits)
+: board_(board), clock_(limits), ordering_(board.getVertices().size())
+{
+	rootTeam_ = board.getPlayingTeam();
+	bestTargets_ = board.getBestTargets();
+	
+	// playing order, teams that have finished do not play anymore
+	vector<int> winningOrder = board.getWinningOrder();
+	int nTeams = board.getNTeams();
+	for (int i=0; i<nTeams; i++)
+	{
+		int team = (rootTeam_+i)%nTeams;
+		if (winningOrder[team]<0) teams_.push_back(team);
+	}
+	
+	// initial distances
+	teamDistances_ = vector<int>(nTeams,0);
+	vector<Pawn> pawns = board.getPawns();
+	for (int ipawn=0; ipawn<pawns.size(); ipawn++)
+	{
+		int team = pawns[ipawn].getTeam();
+		if (bestTargets_[team]<0) continue;
+		teamDistances_[team] += board.vertexDistance(
+		                        board.getVertexFromPawn(ipawn),
+		                        bestTargets_[team]);
+	}
+}
+
+
+
+// Evaluation from the point of view of the root team: its own distance
+// to travel against the average of the other teams'
+
+int Search::evaluate()
+{
+	int nOthers = teams_.size()-1;
+	if (nOthers==0) return -teamDistances_[rootTeam_];
+	
+	int sumOthers = 0;
+	for (int i=1; i<teams_.size(); i++) sumOthers += teamDistances_[teams_[i]];
+	
+	return sumOthers - nOthers*teamDistances_[rootTeam_];
+}
+
+
+
+void Search::makeMove(int ivertexFrom, int ivertexTo)
+{
+	int ipawn = board_.getPawnFromVertex(ivertexFrom);
+	int team = board_.getTeamOfPawn(ipawn);
+	
+	if (bestTargets_[team]>=0)
+		teamDistances_[team] +=
+			board_.vertexDistance(ivertexTo, bestTargets_[team])
+		  - board_.vertexDistance(ivertexFrom, bestTargets_[team]);
+	
+	board_.moveUnchecked(ivertexFrom, ivertexTo);
+}
+
+
+
+void Search::unmakeMove(int ivertexFrom, int ivertexTo)
+{
+	makeMove(ivertexTo, ivertexFrom);
+}
+
+
+
+int Search::searchNode(int depth, int ply, int alpha, int beta)
+{
+	INSTRUMENT_COUNT(PROBE_SEARCH_NODES,1);
+	
+	if (clock_.poll()) return 0;
+	if (depth==0) return evaluate();
+	
+	int team = teams_[ply%teams_.size()];
+	bool maximising = (team == rootTeam_);
+	int best = maximising ? -SEARCH_INFINITY : SEARCH_INFINITY;
+	bool hasMoves = false;
+	
+	MovePicker picker(board_, team, ordering_, ply);
+	int ivertexFrom, ivertexTo;
+	
+	while (picker.next(ivertexFrom, ivertexTo))
+	{
+		makeMove(ivertexFrom, ivertexTo);
+		int value = searchNode(depth-1, ply+1, alpha, beta);
+		unmakeMove(ivertexFrom, ivertexTo);
+		
+		if (clock_.stopped()) return 0;
+		hasMoves = true;
+		
+		if (maximising && value>best)
+		{
+			best = value;
+			if (best>alpha) alpha = best;
+		}
+		else if (!maximising && value<best)
+		{
+			best = value;
+			if (best<beta) beta = best;
+		}
+		
+		if (alpha>=beta)
+		{
+			ordering_.updateKillers(ply, ivertexFrom, ivertexTo);
+			ordering_.updateHistory(ivertexFrom, ivertexTo, depth);
+			break;
+		}
+	}
+	
+	// a team without any move passes
+	if (!hasMoves) return searchNode(depth-1, ply+1, alpha, beta);
+	
+	return best;
+}
+
+
+
+// Iterative deepening. The best move of the previous iteration is searched
+// first, so a better move found in an interrupted iteration can be trusted.
+
+SearchResult Search::run()
+{
+	// root moves, in the order of the move picker
+	vector<int> rootFrom;
+	vector<int> rootTo;
+	MovePicker picker(board_, rootTeam_, ordering_, 0);
+	int ivertexFrom, ivertexTo;
+	while (picker.next(ivertexFrom, ivertexTo))
+	{
+		rootFrom.push_back(ivertexFrom);
+		rootTo.push_back(ivertexTo);
+	}
+	
+	if (rootFrom.size()==0) return result_;
+	
+	// the best ordered move is the fallback if no iteration completes
+	result_.ivertexFrom_ = rootFrom[0];
+	result_.ivertexTo_ = rootTo[0];
+	
+	for (int depth=1; depth<=clock_.getLimits().maxDepth_; depth++)
+	{
+		int alpha = -SEARCH_INFINITY;
+		int ibest = -1;
+		
+		for (int i=0; i<rootFrom.size(); i++)
+		{
+			makeMove(rootFrom[i], rootTo[i]);
+			int value = searchNode(depth-1, 1, alpha, SEARCH_INFINITY);
+			unmakeMove(rootFrom[i], rootTo[i]);
+			
+			if (clock_.stopped()) break;
+			
+			if (value>alpha)
+			{
+				alpha = value;
+				ibest = i;
+			}
+		}
+		
+		if (ibest>=0)
+		{
+			result_.ivertexFrom_ = rootFrom[ibest];
+			result_.ivertexTo_ = rootTo[ibest];
+			result_.score_ = alpha;
+			
+			// best move first for the next iteration
+			swap(rootFrom[0], rootFrom[ibest]);
+			swap(rootTo[0], rootTo[ibest]);
+		}
+		
+		if (clock_.stopped()) break;
+		result_.depth_ = depth;
+	}
+	
+	result_.nodes_ = clock_.getNodes();
+	result_.time_ = clock_.elapsed();
+	
+	TRACE_EVENT(TRACE_SEARCH_RESULT, result_.depth_, 
+	            int(min(result_.nodes_, long(INT32_MAX))), result_.score_);
+	
+	return result_;
+}
+
+
+
+
+void algorithmSearch(Board &board, int &ipawnToMove, int &ivertexDestination,
+                     SearchLimits limits)
+{
+	INSTRUMENT_SCOPE(PROBE_SEARCH);
+	
+	TRACE_EVENT(TRACE_ALGORITHM_BEGIN, TRACE_SEARCH, 
+	            board.getPlayingTeam(), 0);
+	
+	Search search(board, limits);
+	SearchResult result = search.run();
+	if (result.ivertexFrom_<0) 
+	{
+		TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_SEARCH, -1, -1);
+		return;
+	}
+	
+	ipawnToMove = board.getPawnFromVertex(result.ivertexFrom_);
+	ivertexDestination = result.ivertexTo_;
+	
+	TRACE_EVENT(TRACE_ALGORITHM_END, TRACE_SEARCH, ipawnToMove, 
+	            ivertexDestination);
+}
+
+
+
+
+
+#endif
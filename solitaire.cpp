@@ -0,0 +1,547 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o solitaire solitaire.cpp Board.h \         //
+//                   Board.cpp Record.cpp -pthread                        //
+//    Run with     $ ./solitaire [-j threads] [-n nodes] [size ...]       //
+//                                                                        //
+//    This file is used for finding the minimum number of moves of the    //
+//    single-team game (the pawns cross the board from branch 0 to        //
+//    branch 3) for board sizes 2 to 4. The search is an IDA* on all the  //
+//    cores, guided by a pattern database stored on disk. The solutions   //
+//    are replayed with Board::move, and the number of nodes per second   //
+//    is reported.                                                        //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Pattern database
+//	The heuristic is additive over the pawns: each pawn needs at least its
+//	relaxed number of moves to the nearest target vertex, the number of
+//	moves it would need if it could hop over any vertex, occupied or not
+//	(see Board::relaxedDistance). A move moves a single pawn, so the sum
+//	never overestimates. The table only depends on the board size; it is
+//	written once in data/solitaire_<size>.pdb and mapped in memory
+//	afterwards.
+//	o	header (24 bytes): "CCSOLPDB", version, board size, number of
+//		vertices, reserved
+//	o	one byte per vertex, the relaxed distance to the target
+//	It is weak: almost the whole board is one jump away, so the heuristic
+//	is about the number of pawns. Size 2 is solved in a fraction of a
+//	second (11 moves); for sizes 3 and 4 the default budget of 2e8 nodes
+//	only proves lower bounds (16 and 18 moves).
+//
+//	Parallel search
+//	The positions two moves away from the start are shared between the
+//	threads at each iteration of the IDA*; each thread searches them with
+//	its own board, its own table of visited positions and its own table of
+//	lower bounds learned in the previous iterations (the number of moves
+//	left is at least the bound that failed minus g).
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Board.h"
+#include "endgame.cpp"
+
+using namespace std;
+
+
+const int SOLITAIRE_PDB_VERSION = 1;
+const int SOLITAIRE_FOUND = -1;
+const int SOLITAIRE_MAX_ENTRIES = 1<<23;   // positions in the tables
+
+struct SolitairePdbHeader
+{
+	char magic_[8];
+	uint32_t version_;
+	uint32_t boardSize_;
+	uint32_t nVertices_;
+	uint32_t reserved_;
+};
+
+// Read-only pattern database mapped in memory
+class PatternDatabase
+{
+	public:
+		PatternDatabase() : data_(NULL), size_(0), distances_(NULL) {;}
+		PatternDatabase(const PatternDatabase&) = delete;
+		~PatternDatabase();
+		
+		// Returns 0 on success, 1 if the file can't be opened and 2 if it
+		// is not a database of the board
+		int open(string filename, int boardSize, int nVertices);
+		
+		int getDistance(int ivertex) {return distances_[ivertex];}
+	
+	protected:
+		const unsigned char *data_;
+		size_t size_;
+		const uint8_t *distances_;
+};
+
+// a move and the change of the heuristic
+class SolitaireMove
+{
+	public:
+		int delta_;
+		int ivertexFrom_;
+		int ivertexTo_;
+};
+
+// state of a thread of the search
+class SolitaireThread
+{
+	public:
+		SolitaireThread(Hexagram &board) : board_(board), nodes_(0) {;}
+		
+		Hexagram board_;
+		unordered_map<uint64_t,int> visited_;  // smallest g of a position
+		unordered_map<uint64_t,int> bounds_;   // learned moves left
+		vector<SolitaireMove> path_;
+		long nodes_;                           // not yet added to the total
+};
+
+// position two moves away from the start
+class SolitaireTask
+{
+	public:
+		SolitaireMove moves_[2];
+};
+
+class SolitaireSearch
+{
+	public:
+		SolitaireSearch(Hexagram &board, PatternDatabase &pdb, int numThreads,
+		                long nodeBudget);
+		
+		// length of the shortest solution, -1 if the budget was reached
+		int run();
+		
+		vector<SolitaireMove> getSolution() {return solution_;}
+		int getInitialBound() {return initialBound_;}
+		int getBound() {return bound_;}
+		long getNodes() {return nodes_;}
+	
+	protected:
+		int heuristic(Board &board);
+		vector<SolitaireMove> generateMoves(Board &board);
+		void searchTasks(SolitaireThread *state, int bound);
+		int search(SolitaireThread &state, int g, int bound, int h);
+		
+		Hexagram &board_;
+		PatternDatabase &pdb_;
+		int numThreads_;
+		long nodeBudget_;
+		int nPawns_;
+		int maxEntries_;                  // per table of a thread
+		
+		vector<SolitaireTask> tasks_;
+		vector<SolitaireThread> threads_;
+		atomic<int> nextTask_;
+		atomic<long> nodes_;
+		atomic<bool> found_;
+		atomic<bool> aborted_;
+		mutex mutex_;
+		int nextBound_;
+		int initialBound_;
+		int bound_;
+		vector<SolitaireMove> solution_;
+};
+
+
+
+PatternDatabase::~PatternDatabase()
+{
+	if (data_ != NULL) munmap((void*)data_, size_);
+}
+
+int PatternDatabase::open(string filename, int boardSize, int nVertices)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd<0) return 1;
+	
+	struct stat status;
+	if (fstat(fd, &status)<0 ||
+	    status.st_size != sizeof(SolitairePdbHeader)+nVertices)
+	{
+		::close(fd);
+		return 2;
+	}
+	
+	size_ = status.st_size;
+	void *data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		size_ = 0;
+		return 1;
+	}
+	data_ = (const unsigned char*)data;
+	
+	SolitairePdbHeader header;
+	memcpy(&header, data_, sizeof(header));
+	if (memcmp(header.magic_, "CCSOLPDB", 8) != 0 ||
+	    header.version_ != SOLITAIRE_PDB_VERSION ||
+	    header.boardSize_ != boardSize || header.nVertices_ != nVertices)
+	{
+		munmap((void*)data_, size_);
+		data_ = NULL;
+		size_ = 0;
+		return 2;
+	}
+	distances_ = data_+sizeof(header);
+	
+	return 0;
+}
+
+// Compute the pattern database of a single-team board and write it
+
+int writePatternDatabase(string filename, Hexagram &board)
+{
+	vector<int> targets = board.getTargetOfTeam(0);
+	vector<int> distances = relaxedMoveDistances(board, targets);
+	
+	SolitairePdbHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic_, "CCSOLPDB", 8);
+	header.version_ = SOLITAIRE_PDB_VERSION;
+	header.boardSize_ = board.getSize();
+	header.nVertices_ = distances.size();
+	
+	vector<uint8_t> table;
+	for (int distance : distances) table.push_back(distance);
+	
+	ofstream file(filename, ios::binary);
+	file.write((char*)&header, sizeof(header));
+	file.write((char*)table.data(), table.size());
+	file.close();
+	
+	return file ? 0 : 1;
+}
+
+
+
+
+SolitaireSearch::SolitaireSearch(Hexagram &board, PatternDatabase &pdb,
+                                 int numThreads, long nodeBudget)
+: board_(board), pdb_(pdb), numThreads_(numThreads),
+  nodeBudget_(nodeBudget), nPawns_(board.getNPawnsPerTeam()),
+  maxEntries_(SOLITAIRE_MAX_ENTRIES/(2*numThreads)),
+  nextTask_(0), nodes_(0), found_(false), aborted_(false),
+  initialBound_(0), bound_(0)
+{;}
+
+int SolitaireSearch::heuristic(Board &board)
+{
+	int h = 0;
+	for (int ipawn=0; ipawn<nPawns_; ipawn++)
+		h += pdb_.getDistance(board.getVertexFromPawn(ipawn));
+	return h;
+}
+
+// Moves of all the pawns, the ones that reduce the heuristic first
+
+vector<SolitaireMove> SolitaireSearch::generateMoves(Board &board)
+{
+	vector<SolitaireMove> moves;
+	vector<int> numHops;
+	
+	for (int ipawn=0; ipawn<nPawns_; ipawn++)
+	{
+		int ivertexFrom = board.getVertexFromPawn(ipawn);
+		vector<int> destinations = board.availableMovesDirect(ivertexFrom);
+		for (int ivertexTo : board.availableMovesHoppingBFS(ivertexFrom, numHops))
+			destinations.push_back(ivertexTo);
+		
+		for (int ivertexTo : destinations)
+		{
+			SolitaireMove move = {pdb_.getDistance(ivertexTo)
+			                      -pdb_.getDistance(ivertexFrom),
+			                      ivertexFrom, ivertexTo};
+			moves.push_back(move);
+		}
+	}
+	
+	stable_sort(moves.begin(), moves.end(),
+	            [](const SolitaireMove &a, const SolitaireMove &b)
+	            {return a.delta_<b.delta_;});
+	
+	return moves;
+}
+
+
+
+// Returns SOLITAIRE_FOUND when the target is reached within the bound,
+// otherwise the smallest f=g+h that exceeded it (INT_MAX if none)
+
+int SolitaireSearch::search(SolitaireThread &state, int g, int bound, int h)
+{
+	if (g+h > bound) return g+h;
+	if (h==0) return SOLITAIRE_FOUND;
+	if (found_ || aborted_) return INT_MAX;
+	
+	// the total is updated by blocks to limit the contention
+	if (++state.nodes_ >= 1024)
+	{
+		if (nodes_.fetch_add(state.nodes_)+state.nodes_ > nodeBudget_)
+			aborted_ = true;
+		state.nodes_ = 0;
+	}
+	
+	// lower bound learned in the previous iterations
+	Hexagram &board = state.board_;
+	uint64_t hash = board.getHash();
+	unordered_map<uint64_t,int>::iterator it = state.bounds_.find(hash);
+	if (it != state.bounds_.end() && g+it->second > bound)
+		return g+it->second;
+	
+	// reached before with as many moves left, nothing new below
+	it = state.visited_.find(hash);
+	if (it != state.visited_.end())
+	{
+		if (it->second <= g) return bound+1;
+		it->second = g;
+	}
+	else if (state.visited_.size() < maxEntries_)
+		state.visited_[hash] = g;
+	
+	int nextBound = INT_MAX;
+	for (SolitaireMove &move : generateMoves(board))
+	{
+		board.moveUnchecked(move.ivertexFrom_, move.ivertexTo_);
+		state.path_.push_back(move);
+		int result = search(state, g+1, bound, h+move.delta_);
+		state.path_.pop_back();
+		board.moveUnchecked(move.ivertexTo_, move.ivertexFrom_);
+		
+		if (result == SOLITAIRE_FOUND)
+		{
+			lock_guard<mutex> lock(mutex_);
+			if (solution_.size()==0)
+			{
+				solution_ = state.path_;
+				solution_.push_back(move);
+			}
+			found_ = true;
+			return SOLITAIRE_FOUND;
+		}
+		nextBound = min(nextBound, result);
+	}
+	
+	// no way to finish in less than nextBound-g moves from here
+	if (!found_ && !aborted_ && nextBound != INT_MAX &&
+	    state.bounds_.size() < maxEntries_)
+		state.bounds_[hash] = nextBound-g;
+	
+	return nextBound;
+}
+
+
+
+// One iteration of the IDA*, the threads take the tasks in turn
+
+void SolitaireSearch::searchTasks(SolitaireThread *thread, int bound)
+{
+	SolitaireThread &state = *thread;
+	state.visited_.clear();
+	int nextBound = INT_MAX;
+	
+	for (int i=nextTask_++; i<tasks_.size(); i=nextTask_++)
+	{
+		SolitaireTask &task = tasks_[i];
+		for (SolitaireMove &move : task.moves_)
+		{
+			state.board_.moveUnchecked(move.ivertexFrom_, move.ivertexTo_);
+			state.path_.push_back(move);
+		}
+		
+		int result = search(state, 2, bound, heuristic(state.board_));
+		
+		for (int k=1; k>=0; k--)
+			state.board_.moveUnchecked(task.moves_[k].ivertexTo_,
+			                           task.moves_[k].ivertexFrom_);
+		state.path_.clear();
+		
+		if (result == SOLITAIRE_FOUND || found_ || aborted_) break;
+		nextBound = min(nextBound, result);
+	}
+	
+	nodes_ += state.nodes_;
+	state.nodes_ = 0;
+	lock_guard<mutex> lock(mutex_);
+	nextBound_ = min(nextBound_, nextBound);
+}
+
+int SolitaireSearch::run()
+{
+	// positions two moves away, each one once
+	Hexagram board = board_;
+	unordered_map<uint64_t,bool> seen;
+	for (SolitaireMove &move1 : generateMoves(board))
+	{
+		board.moveUnchecked(move1.ivertexFrom_, move1.ivertexTo_);
+		for (SolitaireMove &move2 : generateMoves(board))
+		{
+			board.moveUnchecked(move2.ivertexFrom_, move2.ivertexTo_);
+			if (!seen[board.getHash()])
+			{
+				seen[board.getHash()] = true;
+				SolitaireTask task = {{move1, move2}};
+				tasks_.push_back(task);
+			}
+			board.moveUnchecked(move2.ivertexTo_, move2.ivertexFrom_);
+		}
+		board.moveUnchecked(move1.ivertexTo_, move1.ivertexFrom_);
+	}
+	
+	initialBound_ = max(heuristic(board_),2);
+	bound_ = initialBound_;
+	
+	threads_.assign(numThreads_, SolitaireThread(board_));
+	
+	while (true)
+	{
+		nextTask_ = 0;
+		nextBound_ = INT_MAX;
+		
+		vector<thread> workers;
+		for (int i=0; i<numThreads_; i++)
+			workers.push_back(thread(&SolitaireSearch::searchTasks, this,
+			                         &threads_[i], bound_));
+		for (thread &worker : workers) worker.join();
+		
+		if (found_) return solution_.size();
+		if (aborted_ || nextBound_ == INT_MAX) return -1;
+		bound_ = nextBound_;
+	}
+}
+
+
+
+// Check a solution with Board::move, from the start position
+
+bool checkSolution(int size, vector<SolitaireMove> &solution)
+{
+	Hexagram board(1, size);
+	
+	for (SolitaireMove &move : solution)
+	{
+		int ipawn = board.getPawnFromVertex(move.ivertexFrom_);
+		if (ipawn<0 || board.move(ipawn, move.ivertexTo_) != 0) return false;
+	}
+	
+	return board.getWinningOrder()[0]==1;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	///////////////////////////// Parameters ///////////////////////////////
+	
+	int numThreads = thread::hardware_concurrency();
+	long nodeBudget = 200000000;
+	vector<int> sizes;
+	
+	for (int i=1; i<argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "-j" && i+1<argc) numThreads = atoi(argv[++i]);
+		else if (arg == "-n" && i+1<argc) nodeBudget = atol(argv[++i]);
+		else sizes.push_back(atoi(argv[i]));
+	}
+	if (numThreads<1) numThreads = 1;
+	if (sizes.size()==0) sizes = {2, 3, 4};
+	
+	if (system("mkdir -p data") != 0)
+	{
+		cerr << "Could not create the directory data" << endl;
+		return 1;
+	}
+	
+	cout << endl;
+	cout << "=========== Solitaire ============" << endl;
+	cout << endl;
+	cout << "threads = " << numThreads << endl;
+	cout << "nodeBudget = " << nodeBudget << endl;
+	
+	bool allOk = true;
+	
+	for (int size : sizes)
+	{
+		if (size<2 || size>4)
+		{
+			cerr << "Size " << size << " is not supported (2 to 4)" << endl;
+			return 1;
+		}
+		
+		Hexagram board(1, size);
+		int nVertices = board.getVertices().size();
+		
+		// pattern database, computed the first time
+		string filename = "data/solitaire_" + to_string(size) + ".pdb";
+		PatternDatabase pdb;
+		if (pdb.open(filename, size, nVertices) != 0)
+		{
+			if (writePatternDatabase(filename, board) != 0 ||
+			    pdb.open(filename, size, nVertices) != 0)
+			{
+				cerr << "Could not write " << filename << endl;
+				return 1;
+			}
+		}
+		
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		
+		SolitaireSearch search(board, pdb, numThreads, nodeBudget);
+		int length = search.run();
+		
+		chrono::duration<double> time = chrono::steady_clock::now()-start;
+		
+		cout << endl;
+		cout << "Size " << size << " (" << board.getNPawnsPerTeam()
+		     << " pawns, " << nVertices << " vertices)" << endl;
+		cout << "Heuristic at the start = " << search.getInitialBound() << endl;
+		
+		if (length>=0)
+		{
+			vector<SolitaireMove> solution = search.getSolution();
+			bool ok = checkSolution(size, solution);
+			allOk = allOk && ok;
+			
+			cout << "Minimum number of moves = " << length
+			     << (ok ? "" : " (invalid solution)") << endl;
+			cout << "Solution =";
+			for (SolitaireMove &move : solution)
+				cout << " " << move.ivertexFrom_ << "-" << move.ivertexTo_;
+			cout << endl;
+		}
+		else
+			cout << "Not solved within the budget, minimum number of moves >= "
+			     << search.getBound() << endl;
+		
+		cout << "Nodes = " << search.getNodes() << endl;
+		cout << "Time = " << time.count() << " s" << endl;
+		cout << "Nodes/s = " << search.getNodes()/max(time.count(),1e-9)
+		     << endl;
+	}
+	
+	return allOk ? 0 : 1;
+}
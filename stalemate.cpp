@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the detection of the games of chinese       //
+//    checkers that are stuck (cycles and stalemates).                    //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Simulated games sometimes never end, e.g. when the last pawn of a team
+//	is blocked in the target by a pawn of a team that has finished. They
+//	used to be played until the limit of moves and discarded. A game is
+//	classified as
+//	o	a cycle, when a position (hash of the board, playing team
+//		included) is seen repetitionLimit times since the last progress
+//		(the counts restart at each progress, which only delays the
+//		detection of a cycle through positions seen before it)
+//	o	a stalemate, when no team has improved its best summed distance to
+//		its best target vertex for noProgressRounds rounds
+//	and can be stopped there. Moves played since the last progress are
+//	counted as wasted.
+//
+//	At low temperature (0.1) some games leave a long cycle by chance and
+//	finish after hundreds of moves; the default limits (20 repetitions,
+//	150 rounds) stop a few of them with the stuck ones. No finished game
+//	came close to them at temperature 0.3 and above.
+
+
+#ifndef STALEMATE
+#define STALEMATE
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include "Board.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const int GAME_RUNNING = 0;
+const int GAME_FINISHED = 1;
+const int GAME_CYCLE = 2;
+const int GAME_STALEMATE = 3;
+const int GAME_MOVE_LIMIT = 4;   // stopped by the limit of moves
+
+class StalemateDetector
+{
+	public:
+		StalemateDetector(Board &board, int repetitionLimit=20,
+		                  int noProgressRounds=150);
+		
+		// to call after each move, returns the state of the game
+		int update(Board &board);
+		
+		int getMovesSinceProgress() {return movesSinceProgress_;}
+		double getRoundsSinceProgress() {return roundsSinceProgress_;}
+	
+	protected:
+		int teamDistance(Board &board, int team);
+		
+		int repetitionLimit_;
+		int noProgressRounds_;
+		unordered_map<uint64_t,int> repetitions_;
+		vector<int> bestDistances_;
+		vector<int> bestTargets_;
+		int movesSinceProgress_;
+		double roundsSinceProgress_;     // a move is 1/(teams playing) round
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+StalemateDetector::StalemateDetector(Board &board, int repetitionLimit,
+                                     int noProgressRounds)
+: repetitionLimit_(repetitionLimit), noProgressRounds_(noProgressRounds),
+  bestTargets_(board.getBestTargets()), movesSinceProgress_(0),
+  roundsSinceProgress_(0)
+{
+	for (int team=0; team<board.getNTeams(); team++)
+		bestDistances_.push_back(teamDistance(board, team));
+	
+	repetitions_[board.getHash()] = 1;
+}
+
+int StalemateDetector::teamDistance(Board &board, int team)
+{
+	if (bestTargets_[team]<0) return 0;
+	
+	int distance = 0;
+	int nPawnsPerTeam = board.getNPawnsPerTeam();
+	for (int ipawn=team*nPawnsPerTeam; ipawn<(team+1)*nPawnsPerTeam; ipawn++)
+		distance += board.vertexDistance(board.getVertexFromPawn(ipawn),
+		                                 bestTargets_[team]);
+	return distance;
+}
+
+int StalemateDetector::update(Board &board)
+{
+	if (board.getPlayingTeam()<0) return GAME_FINISHED;
+	
+	// progress of the teams, only the one that moved can have changed but
+	// it is not known here
+	bool progress = false;
+	for (int team=0; team<bestDistances_.size(); team++)
+	{
+		int distance = teamDistance(board, team);
+		if (distance < bestDistances_[team])
+		{
+			bestDistances_[team] = distance;
+			progress = true;
+		}
+	}
+	
+	int nTeamsPlaying = 0;
+	for (int rank : board.getWinningOrder()) if (rank<0) nTeamsPlaying++;
+	
+	if (progress)
+	{
+		movesSinceProgress_ = 0;
+		roundsSinceProgress_ = 0;
+		
+		// heuristic reset: the best distances only decrease, so a team can
+		// go back to a position seen before its progress without any new
+		// progress; the repetitions of such a cycle are counted again from
+		// zero, which delays its detection (or leaves it to the stalemate
+		// limit) but doesn't miss it
+		repetitions_.clear();
+	}
+	else
+	{
+		movesSinceProgress_++;
+		roundsSinceProgress_ += 1.0/nTeamsPlaying;
+	}
+	
+	if (roundsSinceProgress_ >= noProgressRounds_) return GAME_STALEMATE;
+	
+	if (++repetitions_[board.getHash()] >= repetitionLimit_) return GAME_CYCLE;
+	
+	return GAME_RUNNING;
+}
+
+
+
+
+
+#endif
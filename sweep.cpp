@@ -0,0 +1,529 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o sweep sweep.cpp Board.h Board.cpp \       //
+//                   Record.cpp -pthread                                  //
+//    Run with     $ ./sweep [-j threads] [-b nTeams size] \              //
+//                   [-m minGames] [-g maxGames] [-o table] [grid]        //
+//                                                                        //
+//    This file is used for comparing the parameters of the algorithms    //
+//    by self-play. Team 0 plays with the parameters of a point of a      //
+//    grid against opponents playing with the parameters of the same      //
+//    point; the games of all the points are played by a shared pool of   //
+//    threads and the results are written in a single table (default      //
+//    "analysis/sweep.dat") with 95% confidence intervals.                //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Grid file, one parameter per line followed by its values ('#' comments)
+//		algorithm hamiltonian hamiltonianEval
+//		temperature 0.1 0.3 1
+//		hopWeight 0 0.5
+//		weights default data/evalWeights.dat
+//		opponentAlgorithm hamiltonian
+//		opponentTemperature 0.3
+//		opponentHopWeight 0
+//		opponentWeights default
+//	The points are all the combinations of the values. Algorithms are
+//	random, minSum, minFree, hamiltonian, hamiltonianEval and search.
+//
+//	The score of a point is the number of moves team 0 needs to reach its
+//	target (lower is better). A game where it doesn't, because the game
+//	reached maxNumMoves or was stopped early as stuck, counts as many
+//	moves as team 0 could play in maxNumMoves (maxNumMoves/nTeams), so
+//	that getting stuck is never better than finishing. Every point plays
+//	minGames games, then games are given to the points whose confidence
+//	interval overlaps the one of the best point, until the intervals are
+//	separated or the points reach maxGames games.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Board.h"
+#include "algorithm.cpp"
+#include "stalemate.cpp"
+
+using namespace std;
+
+
+const string sweepAlgorithms[] =
+	{"random", "minSum", "minFree", "hamiltonian", "hamiltonianEval", "search"};
+
+// parameters of the algorithm of a team
+class SweepPlayer
+{
+	public:
+		string algorithm_;
+		double temperature_;
+		double hopWeight_;        // of the hop distance term (hamiltonian)
+		string weightsFilename_;  // "default" for the default weights
+		EvalWeights weights_;
+};
+
+// point of the grid and statistics of its games
+class SweepPoint
+{
+	public:
+		SweepPoint() : numScheduled_(0), numGames_(0), numWins_(0),
+		               numUnfinished_(0), sumMoves_(0), sumSquaresMoves_(0) {;}
+		
+		double mean() {return numGames_>0 ? sumMoves_/numGames_ : 0;}
+		double halfWidth();   // of the 95% confidence interval
+		double winRate() {return numGames_>0 ? double(numWins_)/numGames_ : 0;}
+		
+		SweepPlayer player_;     // team 0
+		SweepPlayer opponent_;   // other teams
+		
+		int numScheduled_;       // games given to the workers
+		int numGames_;           // games completed
+		int numWins_;
+		int numUnfinished_;      // team 0 did not reach its target
+		double sumMoves_;        // scores of the games
+		double sumSquaresMoves_;
+};
+
+class SweepGameResult
+{
+	public:
+		int teamMoves_;   // moves of team 0
+		int score_;       // teamMoves_, or the penalty if not finished
+		bool finished_;   // team 0 reached its target
+		bool win_;
+};
+
+// Adaptive allocation of the games to the points, shared by the workers
+class SweepScheduler
+{
+	public:
+		SweepScheduler(vector<SweepPoint> &points, int minGames, int maxGames)
+		: points_(points), minGames_(minGames), maxGames_(maxGames),
+		  numInFlight_(0), numGames_(0) {;}
+		
+		// point of the next game, -1 when the sweep is over
+		int nextPoint(int &igame);
+		void report(int ipoint, SweepGameResult result);
+		int best();
+	
+	protected:
+		int choosePoint();
+		
+		vector<SweepPoint> &points_;
+		int minGames_;
+		int maxGames_;
+		int numInFlight_;
+		int numGames_;           // games given, used for the seeds
+		mutex mutex_;
+		condition_variable completed_;
+};
+
+
+
+double SweepPoint::halfWidth()
+{
+	if (numGames_<2) return INFINITY;
+	
+	double mean = sumMoves_/numGames_;
+	double variance = (sumSquaresMoves_-numGames_*mean*mean)/(numGames_-1);
+	return 1.96*sqrt(max(variance,0.0)/numGames_);
+}
+
+
+
+// Best point among the ones with at least two games
+
+int SweepScheduler::best()
+{
+	int ibest = -1;
+	for (int i=0; i<points_.size(); i++)
+	{
+		if (points_[i].numGames_<2) continue;
+		if (ibest<0 || points_[i].mean()<points_[ibest].mean()) ibest = i;
+	}
+	return ibest;
+}
+
+// Point with the fewest games among the ones that still need some, -1 if
+// none does with the results known so far
+
+int SweepScheduler::choosePoint()
+{
+	int ichosen = -1;
+	
+	// first minGames games for every point
+	for (int i=0; i<points_.size(); i++)
+		if (points_[i].numScheduled_<minGames_ && (ichosen<0 ||
+		    points_[i].numScheduled_<points_[ichosen].numScheduled_))
+			ichosen = i;
+	if (ichosen>=0) return ichosen;
+	
+	// then the points that can't be separated from the best one
+	int ibest = best();
+	if (ibest<0) return -1;
+	SweepPoint &bestPoint = points_[ibest];
+	
+	for (int i=0; i<points_.size(); i++)
+	{
+		if (i==ibest || points_[i].numScheduled_>=maxGames_) continue;
+		
+		SweepPoint &point = points_[i];
+		bool overlap = fabs(point.mean()-bestPoint.mean()) <
+		               point.halfWidth()+bestPoint.halfWidth();
+		if (!overlap) continue;
+		
+		// the best point plays too when it has fewer games
+		int icandidate = i;
+		if (bestPoint.numScheduled_<point.numScheduled_ &&
+		    bestPoint.numScheduled_<maxGames_) icandidate = ibest;
+		
+		if (ichosen<0 ||
+		    points_[icandidate].numScheduled_<points_[ichosen].numScheduled_)
+			ichosen = icandidate;
+	}
+	
+	return ichosen;
+}
+
+// Waits for the games in progress when they can change the allocation
+
+int SweepScheduler::nextPoint(int &igame)
+{
+	unique_lock<mutex> lock(mutex_);
+	
+	while (true)
+	{
+		int ipoint = choosePoint();
+		if (ipoint>=0)
+		{
+			points_[ipoint].numScheduled_++;
+			numInFlight_++;
+			igame = numGames_++;
+			return ipoint;
+		}
+		
+		if (numInFlight_==0) return -1;
+		completed_.wait(lock);
+	}
+}
+
+void SweepScheduler::report(int ipoint, SweepGameResult result)
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		
+		SweepPoint &point = points_[ipoint];
+		point.numGames_++;
+		point.numWins_ += result.win_;
+		point.numUnfinished_ += !result.finished_;
+		point.sumMoves_ += result.score_;
+		point.sumSquaresMoves_ += double(result.score_)*result.score_;
+		
+		numInFlight_--;
+	}
+	completed_.notify_all();
+}
+
+
+
+void playMove(SweepPlayer &player, Board &board, int &ipawnToMove,
+              int &ivertexDestination, SearchLimits limits)
+{
+	temperature = player.temperature_;
+	hopDistanceWeight = player.hopWeight_;
+	evalWeights = player.weights_;
+	
+	string algorithm = player.algorithm_;
+	if (algorithm == "random")
+		randomMove(board, ipawnToMove, ivertexDestination);
+	else if (algorithm == "minSum")
+		bestMove0MinSum(board, ipawnToMove, ivertexDestination);
+	else if (algorithm == "minFree")
+		bestMove0MinFree(board, ipawnToMove, ivertexDestination);
+	else if (algorithm == "hamiltonianEval")
+		algorithmHamiltonianEval(board, ipawnToMove, ivertexDestination);
+	else if (algorithm == "search")
+		algorithmSearch(board, ipawnToMove, ivertexDestination, limits);
+	else
+		algorithmHamiltonian(board, ipawnToMove, ivertexDestination);
+}
+
+SweepGameResult playGame(SweepPoint &point, int nTeams, int size,
+                         int maxNumMoves, SearchLimits limits)
+{
+	Hexagram board(nTeams, size);
+	StalemateDetector stalemateDetector(board);
+	int teamMoves = 0;
+	
+	for (int counterMoves=0; counterMoves<maxNumMoves; counterMoves++)
+	{
+		int pteam = board.getPlayingTeam();
+		if (pteam<0) break;
+		
+		int ipawnToMove = -1;
+		int ivertexDestination = -1;
+		
+		// use a copy to prevent the algorithm from making changes
+		Hexagram boardCopy = board;
+		playMove(pteam==0 ? point.player_ : point.opponent_, boardCopy,
+		         ipawnToMove, ivertexDestination, limits);
+		
+		if (board.move(ipawnToMove, ivertexDestination) != 0) break;
+		if (pteam==0) teamMoves++;
+		
+		// stuck games are stopped, team 0 counts as unfinished
+		if (stalemateDetector.update(board) != GAME_RUNNING) break;
+	}
+	
+	SweepGameResult result;
+	result.teamMoves_ = teamMoves;
+	result.finished_ = board.getWinningOrder()[0]>=0;
+	result.win_ = board.getWinningOrder()[0]==1;
+	
+	// moves of team 0 in a game of maxNumMoves moves
+	int penalty = (maxNumMoves+nTeams-1)/nTeams;
+	result.score_ = result.finished_ ? teamMoves : penalty;
+	
+	return result;
+}
+
+
+
+// Read the grid file into the points of the grid, returns 0 on success,
+// 1 if the file can't be opened and 2 if a line is not recognised
+
+int readGrid(string filename, vector<SweepPoint> &points)
+{
+	vector<string> algorithms(1,"hamiltonian");
+	vector<double> temperatures(1,0.3);
+	vector<double> hopWeights(1,0);
+	vector<string> weights(1,"default");
+	vector<string> opponentAlgorithms(1,"hamiltonian");
+	vector<double> opponentTemperatures(1,0.3);
+	vector<double> opponentHopWeights(1,0);
+	vector<string> opponentWeights(1,"default");
+	
+	if (filename != "")
+	{
+		ifstream file(filename);
+		if (!file) return 1;
+		
+		string line;
+		while (getline(file, line))
+		{
+			stringstream stream(line);
+			string name;
+			if (!(stream >> name) || name[0] == '#') continue;
+			
+			vector<string> values;
+			string value;
+			while (stream >> value) values.push_back(value);
+			if (values.size()==0) return 2;
+			
+			vector<double> numbers;
+			for (string value : values) numbers.push_back(atof(value.c_str()));
+			
+			if (name == "algorithm") algorithms = values;
+			else if (name == "temperature") temperatures = numbers;
+			else if (name == "hopWeight") hopWeights = numbers;
+			else if (name == "weights") weights = values;
+			else if (name == "opponentAlgorithm") opponentAlgorithms = values;
+			else if (name == "opponentTemperature") opponentTemperatures = numbers;
+			else if (name == "opponentHopWeight") opponentHopWeights = numbers;
+			else if (name == "opponentWeights") opponentWeights = values;
+			else return 2;
+		}
+	}
+	
+	// the algorithms must exist
+	for (vector<string> *names : {&algorithms, &opponentAlgorithms})
+		for (string algorithm : *names)
+		{
+			bool known = false;
+			for (string name : sweepAlgorithms) known |= name == algorithm;
+			if (!known) return 2;
+		}
+	
+	for (string algorithm : algorithms)
+	for (double temperature : temperatures)
+	for (double hopWeight : hopWeights)
+	for (string weightsFilename : weights)
+	for (string opponentAlgorithm : opponentAlgorithms)
+	for (double opponentTemperature : opponentTemperatures)
+	for (double opponentHopWeight : opponentHopWeights)
+	for (string opponentWeightsFilename : opponentWeights)
+	{
+		SweepPoint point;
+		point.player_.algorithm_ = algorithm;
+		point.player_.temperature_ = temperature;
+		point.player_.hopWeight_ = hopWeight;
+		point.player_.weightsFilename_ = weightsFilename;
+		point.opponent_.algorithm_ = opponentAlgorithm;
+		point.opponent_.temperature_ = opponentTemperature;
+		point.opponent_.hopWeight_ = opponentHopWeight;
+		point.opponent_.weightsFilename_ = opponentWeightsFilename;
+		points.push_back(point);
+	}
+	
+	return 0;
+}
+
+string describePlayer(SweepPlayer &player)
+{
+	stringstream stream;
+	stream << player.algorithm_;
+	if (player.algorithm_.substr(0,11) == "hamiltonian")
+		stream << " T=" << player.temperature_;
+	if (player.algorithm_ == "hamiltonian" && player.hopWeight_ != 0)
+		stream << " hop=" << player.hopWeight_;
+	if (player.algorithm_ == "hamiltonianEval")
+		stream << " " << player.weightsFilename_;
+	return stream.str();
+}
+
+
+
+int main(int argc, char **argv)
+{
+	///////////////////////////// Parameters ///////////////////////////////
+	
+	int numThreads = thread::hardware_concurrency();
+	int nTeams = 6;
+	int boardSize = 3;
+	int minGames = 20;
+	int maxGames = 400;
+	int maxNumMoves = 1000;
+	SearchLimits moveLimits(-1,20000);
+	string tableFilename = "analysis/sweep.dat";
+	string gridFilename = "";
+	
+	for (int i=1; i<argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "-j" && i+1<argc) numThreads = atoi(argv[++i]);
+		else if (arg == "-b" && i+2<argc)
+		{
+			nTeams = atoi(argv[++i]);
+			boardSize = atoi(argv[++i]);
+		}
+		else if (arg == "-m" && i+1<argc) minGames = atoi(argv[++i]);
+		else if (arg == "-g" && i+1<argc) maxGames = atoi(argv[++i]);
+		else if (arg == "-o" && i+1<argc) tableFilename = argv[++i];
+		else gridFilename = arg;
+	}
+	if (numThreads<1) numThreads = 1;
+	if (minGames<2) minGames = 2;
+	if (maxGames<minGames) maxGames = minGames;
+	
+	//////////////////////////////// Grid //////////////////////////////////
+	
+	vector<SweepPoint> points;
+	int status = readGrid(gridFilename, points);
+	if (status != 0)
+	{
+		cerr << "Could not read the grid " << gridFilename << ", error code "
+		     << status << endl;
+		return 1;
+	}
+	
+	for (SweepPoint &point : points)
+	for (SweepPlayer *player : {&point.player_, &point.opponent_})
+	{
+		if (player->weightsFilename_ == "default") continue;
+		if (loadEvalWeights(player->weightsFilename_, player->weights_) != 0)
+		{
+			cerr << "Could not read the weights " << player->weightsFilename_
+			     << endl;
+			return 1;
+		}
+	}
+	
+	cout << endl;
+	cout << "=========== Sweep ============" << endl;
+	cout << endl;
+	cout << "points = " << points.size() << endl;
+	cout << "nTeams = " << nTeams << endl;
+	cout << "boardSize = " << boardSize << endl;
+	cout << "minGames = " << minGames << endl;
+	cout << "maxGames = " << maxGames << endl;
+	cout << "threads = " << numThreads << endl;
+	cout << "seed = " << seed << endl;
+	cout << endl;
+	
+	////////////////////////////// Games ///////////////////////////////////
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	SweepScheduler scheduler(points, minGames, maxGames);
+	
+	// the seed of a game only depends on the order in which it was given
+	auto worker = [&]()
+	{
+		int igame;
+		for (int ipoint = scheduler.nextPoint(igame); ipoint>=0;
+		     ipoint = scheduler.nextPoint(igame))
+		{
+			gen.seed(seed+igame);
+			scheduler.report(ipoint, playGame(points[ipoint], nTeams, boardSize,
+			                                  maxNumMoves, moveLimits));
+		}
+	};
+	
+	vector<thread> workers;
+	for (int i=0; i<numThreads; i++) workers.push_back(thread(worker));
+	for (thread &workerThread : workers) workerThread.join();
+	
+	chrono::duration<double> time = chrono::steady_clock::now()-start;
+	
+	////////////////////////////// Table ///////////////////////////////////
+	
+	int ibest = scheduler.best();
+	int numGames = 0;
+	for (SweepPoint &point : points) numGames += point.numGames_;
+	
+	if (system("mkdir -p analysis") != 0)
+	{
+		cerr << "Could not create the directory analysis" << endl;
+		return 1;
+	}
+	ofstream tableFile(tableFilename);
+	
+	stringstream table;
+	table << "# point  games  score  ci95  winRate  ci95  unfinished"
+	      << "  player | opponents  (* best)" << endl;
+	
+	for (int i=0; i<points.size(); i++)
+	{
+		SweepPoint &point = points[i];
+		double winRate = point.winRate();
+		double winHalfWidth = 1.96*sqrt(winRate*(1-winRate)
+		                                /max(point.numGames_,1));
+		
+		table << i << (i==ibest ? "*" : "") << "  " << point.numGames_
+		      << "  " << point.mean() << "  " << point.halfWidth()
+		      << "  " << winRate << "  " << winHalfWidth
+		      << "  " << point.numUnfinished_
+		      << "  " << describePlayer(point.player_)
+		      << " | " << describePlayer(point.opponent_) << endl;
+	}
+	
+	cout << table.str();
+	tableFile << table.str();
+	
+	cout << endl;
+	cout << "Number of games is " << numGames << endl;
+	cout << "Time = " << time.count() << " s" << endl;
+	cout << "Table written in " << tableFilename << endl;
+	
+	return 0;
+}
@@ -0,0 +1,622 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Implementation file for the endgame tablebases of the chinese       //
+//    checkers game with two teams.                                       //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Positions of Hexagram(2,size) where both teams have between 1 and
+//	maxOutside pawns outside their target are solved by retrograde
+//	analysis (retrograde.cpp) and stored on disk. The pawns already in
+//	their target are assumed to stay there: a team only moves its pawns
+//	outside, and a pawn that enters the target is not moved anymore. The
+//	team that fills its target first wins.
+//
+//	The values are therefore those of this restricted game. In the real
+//	game, a team can also move the pawns of its target (to open a path,
+//	or to make room for a hop), which can be faster; a win in the
+//	tablebases is a win in at most that many plies, not perfect play.
+//
+//	A position is given by, for each team, the vertices of its pawns
+//	outside the target and the vertices of the target without a pawn of
+//	the team, and by the playing team. The positions with n0 and n1 pawns
+//	outside form a subtable, in which a position is indexed by the ranks
+//	of these sets (combinatorial number system), a perfect hash of the
+//	placements. Indices where two pawns would share a vertex are unused.
+//
+//	Value of a position (plies to the end of the restricted game, perfect
+//	play in it)
+//	o	0: not resolved (no win for any team, or no move available)
+//	o	odd d: the playing team fills its target in d plies
+//	o	even d: the other team fills its target in d plies
+//
+//	File (data/tablebase_<size>.tb)
+//	o	header (32 bytes): "CCENDTB1", version, board size, number of
+//		vertices, maxOutside, number of subtables, reserved
+//	o	one descriptor per subtable (32 bytes): n0, n1, bits per value,
+//		maximum value, offset of the values in the file, number of values
+//	o	the values, packed on as few bits as the maximum value needs (at
+//		most 8, a value can span two bytes), read through a memory map
+
+
+#ifndef TABLEBASE
+#define TABLEBASE
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Board.h"
+#include "instrumentation.h"
+
+using namespace std;
+
+
+///////////////////////////// Declarations /////////////////////////////////
+
+
+const int TABLEBASE_VERSION = 1;
+const int TABLEBASE_MAX_OUTSIDE = 4;
+const int TABLEBASE_TERMINAL = 0;     // value of a child where the mover won
+const int TABLEBASE_UNRESOLVED = -1;  // value of a child not resolved
+const int TABLEBASE_MAX_VALUE = 254;
+
+struct TablebaseHeader
+{
+	char magic_[8];
+	uint32_t version_;
+	uint32_t boardSize_;
+	uint32_t nVertices_;
+	uint32_t maxOutside_;
+	uint32_t numSubtables_;
+	uint32_t reserved_;
+};
+
+struct TablebaseSubtable
+{
+	uint32_t n0_;
+	uint32_t n1_;
+	uint32_t bits_;
+	uint32_t maxValue_;
+	uint64_t offset_;
+	uint64_t count_;
+};
+
+// position restricted to the pawns that move, vertices sorted
+class TablebasePosition
+{
+	public:
+		int side_;
+		int n_[2];
+		int outside_[2][TABLEBASE_MAX_OUTSIDE];
+		int empty_[2][TABLEBASE_MAX_OUTSIDE];
+};
+
+// move of a pawn outside and the position it leads to
+class TablebaseChild
+{
+	public:
+		int ivertexFrom_;
+		int ivertexTo_;
+		bool terminal_;                  // the mover filled its target
+		int subtable_;
+		uint64_t index_;
+};
+
+// Geometry of the board and indexing of the positions, shared by the
+// generator and the probes
+class TablebaseLayout
+{
+	public:
+		TablebaseLayout(Hexagram &board, int maxOutside);
+		
+		int getBoardSize() {return boardSize_;}
+		int getNVertices() {return nVertices_;}
+		int getMaxOutside() {return maxOutside_;}
+		int getNumSubtables() {return maxOutside_*maxOutside_;}
+		int subtableOf(int n0, int n1) {return (n0-1)*maxOutside_+(n1-1);}
+		int subtableN0(int subtable) {return subtable/maxOutside_+1;}
+		int subtableN1(int subtable) {return subtable%maxOutside_+1;}
+		uint64_t subtableSize(int subtable);
+		
+		// position of a board, false if it is not in the tablebases
+		bool fromBoard(Board &board, TablebasePosition &position);
+		
+		// false for the unused indices
+		bool decode(int subtable, uint64_t index, TablebasePosition &position);
+		uint64_t encode(TablebasePosition &position);
+		
+		// vertices of the pawns, in the order of Board::setPosition
+		vector<int> pawnVertices(TablebasePosition &position);
+		
+		// moves of the playing team and the positions they lead to
+		void children(TablebasePosition &position,
+		              vector<TablebaseChild> &children);
+	
+	protected:
+		uint64_t rank(int *elements, int n, vector<int> &listIndex);
+		void unrank(uint64_t rank, int n, vector<int> &list, int *elements);
+		void destinations(int ivertex, vector<int> &result);
+		
+		int boardSize_;
+		int nVertices_;
+		int nTarget_;
+		int maxOutside_;
+		vector<vector<int>> neighbours_;
+		vector<vector<int>> neighbours2_;
+		
+		// vertices outside the target and in the target of each team, and
+		// index of a vertex in these lists (-1 if not in it)
+		vector<int> outsideList_[2];
+		vector<int> targetList_[2];
+		vector<int> outsideIndex_[2];
+		vector<int> targetIndex_[2];
+		vector<vector<uint64_t>> binomials_;
+		
+		// scratch space
+		vector<int> occupancy_;          // team+1 on each vertex, 0 if free
+		vector<int> visited_;
+};
+
+// Tablebases read from a file, the values stay in the memory map
+class EndgameTablebase
+{
+	public:
+		EndgameTablebase()
+		: layout_(NULL), data_(NULL), size_(0), numProbes_(0), numHits_(0) {;}
+		EndgameTablebase(const EndgameTablebase&) = delete;
+		~EndgameTablebase() {close();}
+		
+		// Returns 0 on success, 1 if the file can't be opened and 2 if it
+		// is not a valid tablebase file
+		int open(string filename);
+		void close();
+		bool isOpen() {return layout_ != NULL;}
+		
+		// value of a position in a subtable
+		int value(int subtable, uint64_t index);
+		
+		// Gives the move of a perfect play of the restricted game and the
+		// value of the position, returns true if the position is in the
+		// tablebases and resolved
+		bool perfectMove(Board &board, int &ipawnToMove,
+		                 int &ivertexDestination, int &value);
+		
+		// Gives the move of the fastest win of the restricted game and
+		// returns true if the position is in the tablebases and won by the
+		// playing team in it. Lost positions
+		// are left to the algorithms: with two teams the rank is the same
+		// whatever the moves, and the perfect play only delays the other
+		// team.
+		bool probe(Board &board, int &ipawnToMove, int &ivertexDestination);
+		
+		long getNumProbes() {return numProbes_;}
+		long getNumHits() {return numHits_;}
+	
+	protected:
+		TablebaseLayout *layout_;
+		const unsigned char *data_;
+		size_t size_;
+		vector<TablebaseSubtable> subtables_;
+		long numProbes_;
+		long numHits_;
+};
+
+
+
+//////////////////////////// Implementations ///////////////////////////////
+
+
+
+
+TablebaseLayout::TablebaseLayout(Hexagram &board, int maxOutside)
+: boardSize_(board.getSize()), nVertices_(board.getVertices().size()),
+  nTarget_(board.getNPawnsPerTeam()), maxOutside_(maxOutside),
+  occupancy_(nVertices_,0), visited_(nVertices_,0)
+{
+	assert(board.getNTeams()==2);
+	assert(maxOutside>=1 && maxOutside<=TABLEBASE_MAX_OUTSIDE);
+	
+	for (Vertex &vertex : board.getVertices())
+	{
+		neighbours_.push_back(vertex.getNeighbours());
+		neighbours2_.push_back(vertex.getNeighbours2());
+	}
+	
+	for (int team=0; team<2; team++)
+	{
+		vector<int> target = board.getTargetOfTeam(team);
+		sort(target.begin(), target.end());
+		
+		targetIndex_[team] = vector<int>(nVertices_,-1);
+		outsideIndex_[team] = vector<int>(nVertices_,-1);
+		for (int ivertex=0; ivertex<nVertices_; ivertex++)
+		{
+			if (find(target.begin(), target.end(), ivertex) != target.end())
+			{
+				targetIndex_[team][ivertex] = targetList_[team].size();
+				targetList_[team].push_back(ivertex);
+			}
+			else
+			{
+				outsideIndex_[team][ivertex] = outsideList_[team].size();
+				outsideList_[team].push_back(ivertex);
+			}
+		}
+	}
+	
+	// binomial coefficients C(n,k) for k up to maxOutside
+	for (int n=0; n<=nVertices_; n++)
+	{
+		binomials_.push_back(vector<uint64_t>(maxOutside_+1,0));
+		binomials_[n][0] = 1;
+		for (int k=1; k<=maxOutside_ && n>0; k++)
+			binomials_[n][k] = binomials_[n-1][k-1] + binomials_[n-1][k];
+	}
+}
+
+uint64_t TablebaseLayout::subtableSize(int subtable)
+{
+	uint64_t size = 2;
+	int n[2] = {subtableN0(subtable), subtableN1(subtable)};
+	for (int team=0; team<2; team++)
+		size *= binomials_[outsideList_[team].size()][n[team]]
+		      * binomials_[nTarget_][n[team]];
+	return size;
+}
+
+// Rank of a set in the combinatorial number system, the elements being
+// sorted vertices and listIndex their index in the list of the set
+
+uint64_t TablebaseLayout::rank(int *elements, int n, vector<int> &listIndex)
+{
+	uint64_t result = 0;
+	for (int i=0; i<n; i++) result += binomials_[listIndex[elements[i]]][i+1];
+	return result;
+}
+
+void TablebaseLayout::unrank(uint64_t rank, int n, vector<int> &list,
+                             int *elements)
+{
+	int c = list.size();
+	for (int i=n-1; i>=0; i--)
+	{
+		do c--; while (binomials_[c][i+1] > rank);
+		rank -= binomials_[c][i+1];
+		elements[i] = list[c];
+	}
+}
+
+uint64_t TablebaseLayout::encode(TablebasePosition &position)
+{
+	uint64_t index = 0;
+	for (int team=0; team<2; team++)
+	{
+		int n = position.n_[team];
+		index = index*binomials_[outsideList_[team].size()][n]
+		      + rank(position.outside_[team], n, outsideIndex_[team]);
+		index = index*binomials_[nTarget_][n]
+		      + rank(position.empty_[team], n, targetIndex_[team]);
+	}
+	return 2*index + position.side_;
+}
+
+bool TablebaseLayout::decode(int subtable, uint64_t index,
+                             TablebasePosition &position)
+{
+	position.n_[0] = subtableN0(subtable);
+	position.n_[1] = subtableN1(subtable);
+	position.side_ = index%2;
+	index /= 2;
+	
+	for (int team=1; team>=0; team--)
+	{
+		int n = position.n_[team];
+		uint64_t numEmpty = binomials_[nTarget_][n];
+		uint64_t numOutside = binomials_[outsideList_[team].size()][n];
+		unrank(index%numEmpty, n, targetList_[team], position.empty_[team]);
+		index /= numEmpty;
+		unrank(index%numOutside, n, outsideList_[team], position.outside_[team]);
+		index /= numOutside;
+	}
+	
+	// targets filled except the empty vertices, then the pawns outside
+	fill(occupancy_.begin(), occupancy_.end(), 0);
+	for (int team=0; team<2; team++)
+	{
+		for (int ivertex : targetList_[team]) occupancy_[ivertex] = team+1;
+		for (int i=0; i<position.n_[team]; i++)
+			occupancy_[position.empty_[team][i]] = 0;
+	}
+	for (int team=0; team<2; team++)
+		for (int i=0; i<position.n_[team]; i++)
+		{
+			int ivertex = position.outside_[team][i];
+			if (occupancy_[ivertex] != 0) return false;
+			occupancy_[ivertex] = team+1;
+		}
+	
+	return true;
+}
+
+vector<int> TablebaseLayout::pawnVertices(TablebasePosition &position)
+{
+	vector<int> vertices;
+	for (int team=0; team<2; team++)
+	{
+		int *empty = position.empty_[team];
+		int n = position.n_[team];
+		for (int ivertex : targetList_[team])
+			if (find(empty, empty+n, ivertex) == empty+n)
+				vertices.push_back(ivertex);
+		for (int i=0; i<n; i++) vertices.push_back(position.outside_[team][i]);
+	}
+	return vertices;
+}
+
+bool TablebaseLayout::fromBoard(Board &board, TablebasePosition &position)
+{
+	if (board.getNTeams()!=2 || board.getVertices().size()!=nVertices_)
+		return false;
+	
+	position.side_ = board.getPlayingTeam();
+	vector<int> winningOrder = board.getWinningOrder();
+	if (position.side_<0 || winningOrder[0]>=0 || winningOrder[1]>=0)
+		return false;
+	
+	fill(occupancy_.begin(), occupancy_.end(), 0);
+	for (int team=0; team<2; team++)
+	{
+		int n = 0;
+		for (int ipawn=team*nTarget_; ipawn<(team+1)*nTarget_; ipawn++)
+		{
+			int ivertex = board.getVertexFromPawn(ipawn);
+			occupancy_[ivertex] = team+1;
+			if (targetIndex_[team][ivertex]>=0) continue;
+			if (n>=maxOutside_) return false;
+			position.outside_[team][n++] = ivertex;
+		}
+		if (n==0) return false;
+		position.n_[team] = n;
+		sort(position.outside_[team], position.outside_[team]+n);
+	}
+	
+	for (int team=0; team<2; team++)
+	{
+		int n = 0;
+		for (int ivertex : targetList_[team])
+			if (occupancy_[ivertex] != team+1)
+				position.empty_[team][n++] = ivertex;
+	}
+	
+	return true;
+}
+
+// Destinations of a pawn with the occupancy of decode or fromBoard, steps
+// to free neighbours and chains of jumps (breadth-first search)
+
+void TablebaseLayout::destinations(int ivertex, vector<int> &result)
+{
+	result.clear();
+	
+	for (int ivertex2 : neighbours_[ivertex])
+		if (occupancy_[ivertex2]==0) result.push_back(ivertex2);
+	
+	// as in Board, the starting vertex still counts as occupied
+	visited_[ivertex] = 1;
+	vector<int> queue(1,ivertex);
+	for (int k=0; k<queue.size(); k++)
+	{
+		int ivertexCurrent = queue[k];
+		for (int i=0; i<neighbours_[ivertexCurrent].size(); i++)
+		{
+			int ivertex1 = neighbours_[ivertexCurrent][i];
+			int ivertex2 = neighbours2_[ivertexCurrent][i];
+			if (ivertex2<0 || visited_[ivertex2]) continue;
+			if (occupancy_[ivertex1]!=0 && occupancy_[ivertex2]==0)
+			{
+				visited_[ivertex2] = 1;
+				queue.push_back(ivertex2);
+				result.push_back(ivertex2);
+			}
+		}
+	}
+	
+	for (int ivertex2 : queue) visited_[ivertex2] = 0;
+}
+
+void TablebaseLayout::children(TablebasePosition &position,
+                               vector<TablebaseChild> &children)
+{
+	children.clear();
+	
+	int side = position.side_;
+	int n = position.n_[side];
+	vector<int> result;
+	
+	for (int i=0; i<n; i++)
+	{
+		int ivertexFrom = position.outside_[side][i];
+		destinations(ivertexFrom, result);
+		
+		for (int ivertexTo : result)
+		{
+			TablebaseChild child = {ivertexFrom, ivertexTo, false, -1, 0};
+			TablebasePosition next = position;
+			next.side_ = 1-side;
+			
+			if (targetIndex_[side][ivertexTo]>=0)
+			{
+				// the pawn enters the target and stays there
+				if (n==1) child.terminal_ = true;
+				int *outside = next.outside_[side];
+				int *empty = next.empty_[side];
+				remove(outside, outside+n, ivertexFrom);
+				remove(empty, empty+n, ivertexTo);
+				next.n_[side] = n-1;
+			}
+			else
+			{
+				int *outside = next.outside_[side];
+				*find(outside, outside+n, ivertexFrom) = ivertexTo;
+				sort(outside, outside+n);
+			}
+			
+			if (!child.terminal_)
+			{
+				child.subtable_ = subtableOf(next.n_[0], next.n_[1]);
+				child.index_ = encode(next);
+			}
+			children.push_back(child);
+		}
+	}
+}
+
+
+
+
+int EndgameTablebase::open(string filename)
+{
+	close();
+	
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd<0) return 1;
+	
+	struct stat status;
+	if (fstat(fd, &status)<0 || status.st_size<sizeof(TablebaseHeader))
+	{
+		::close(fd);
+		return 2;
+	}
+	
+	size_ = status.st_size;
+	void *data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		size_ = 0;
+		return 1;
+	}
+	data_ = (const unsigned char*)data;
+	
+	TablebaseHeader header;
+	memcpy(&header, data_, sizeof(header));
+	uint64_t headersSize = sizeof(header)
+	                     + header.numSubtables_*sizeof(TablebaseSubtable);
+	if (memcmp(header.magic_, "CCENDTB1", 8) != 0 ||
+	    header.version_ != TABLEBASE_VERSION ||
+	    header.maxOutside_<1 || header.maxOutside_>TABLEBASE_MAX_OUTSIDE ||
+	    header.numSubtables_ != header.maxOutside_*header.maxOutside_ ||
+	    headersSize > size_)
+	{
+		close();
+		return 2;
+	}
+	
+	subtables_.resize(header.numSubtables_);
+	memcpy(subtables_.data(), data_+sizeof(header),
+	       header.numSubtables_*sizeof(TablebaseSubtable));
+	
+	Hexagram board(2, header.boardSize_);
+	layout_ = new TablebaseLayout(board, header.maxOutside_);
+	
+	bool valid = (layout_->getNVertices() == header.nVertices_);
+	for (int i=0; i<subtables_.size() && valid; i++)
+	{
+		TablebaseSubtable &subtable = subtables_[i];
+		valid = subtable.n0_ == layout_->subtableN0(i) &&
+		        subtable.n1_ == layout_->subtableN1(i) &&
+		        subtable.bits_>=1 && subtable.bits_<=8 &&
+		        subtable.count_ == layout_->subtableSize(i) &&
+		        subtable.offset_ + (subtable.count_*subtable.bits_+15)/8 <= size_;
+	}
+	if (!valid)
+	{
+		close();
+		return 2;
+	}
+	
+	return 0;
+}
+
+void EndgameTablebase::close()
+{
+	if (data_ != NULL) munmap((void*)data_, size_);
+	data_ = NULL;
+	size_ = 0;
+	delete layout_;
+	layout_ = NULL;
+	subtables_.clear();
+}
+
+int EndgameTablebase::value(int subtable, uint64_t index)
+{
+	TablebaseSubtable &table = subtables_[subtable];
+	uint64_t bit = index*table.bits_;
+	const unsigned char *bytes = data_+table.offset_+bit/8;
+	int mask = (1<<table.bits_)-1;
+	return ((bytes[0] | bytes[1]<<8) >> (bit%8)) & mask;
+}
+
+// A child one ply closer to the end: the fastest win, or the slowest loss
+
+bool EndgameTablebase::perfectMove(Board &board, int &ipawnToMove,
+                                   int &ivertexDestination, int &v)
+{
+	if (layout_ == NULL) return false;
+	
+	TablebasePosition position;
+	if (!layout_->fromBoard(board, position)) return false;
+	
+	int subtable = layout_->subtableOf(position.n_[0], position.n_[1]);
+	v = value(subtable, layout_->encode(position));
+	if (v==0) return false;
+	
+	vector<TablebaseChild> children;
+	layout_->children(position, children);
+	for (TablebaseChild &child : children)
+	{
+		int vChild = child.terminal_ ? TABLEBASE_TERMINAL :
+		             value(child.subtable_, child.index_);
+		if (vChild == v-1 && (child.terminal_ || v>1))
+		{
+			ipawnToMove = board.getPawnFromVertex(child.ivertexFrom_);
+			ivertexDestination = child.ivertexTo_;
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+bool EndgameTablebase::probe(Board &board, int &ipawnToMove,
+                             int &ivertexDestination)
+{
+	if (layout_ == NULL) return false;
+	
+	INSTRUMENT_SCOPE(PROBE_TABLEBASE);
+	numProbes_++;
+	
+	int ipawn, ivertex, v;
+	if (!perfectMove(board, ipawn, ivertex, v) || v%2==0) return false;
+	
+	ipawnToMove = ipawn;
+	ivertexDestination = ivertex;
+	numHits_++;
+	return true;
+}
+
+
+
+
+
+#endif
@@ -7,7 +7,8 @@
 //                                                                        //
 //    Developped under Ubuntu 18.04 with g++ 7.4.0 and sfml 2.4           //
 //    Compile with $ g++ -o chinese_checkers main.cpp Board.h Board.cpp \ //
-//                   -lsfml-graphics -lsfml-window -lsfml-system          //
+//                   Record.cpp -lsfml-graphics -lsfml-window \           //
+//                   -lsfml-system -pthread                               //
 //                                                                        //
 //    This file is used for testing algorithms by repeated plays.         //
 //                                                                        //
@@ -28,10 +29,14 @@
 #include <string>
 #include <stdlib.h>
 #include <thread>
+#include <mutex>
+#include <atomic>
 #include <SFML/Graphics.hpp>
 #include "Board.h"
+#include "Dataset.h"
 #include "rendering.cpp"
 #include "algorithm.cpp"
+#include "stalemate.cpp"
 
 using namespace std;
 
@@ -40,7 +45,6 @@ int main()
 	/////////////////////////////// Files //////////////////////////////////
 	
 	int sysresult = system("mkdir -p data analysis");
-	ofstream recordFile("data/record.dat");
 	ifstream recordInFile("data/record_in.dat");
 	ofstream distMovesFile("analysis/distMoves.dat");
 	
@@ -54,6 +58,56 @@ int main()
 	int numGames = 1000;
 	int maxNumMoves = 1000;
 	
+	// stuck games (see stalemate.cpp) are stopped before maxNumMoves
+	bool detectStalemates = true;
+	int repetitionLimit = 20;
+	int noProgressRounds = 150;
+	
+	// games are shared between threads, thread i uses the seed seed+i
+	// the games only depend on the seed with a single thread, which is
+	// the default so that runs can be reproduced from the printed seed
+	// (thread::hardware_concurrency() for the fastest runs)
+	int numThreads = 1;
+	
+	// limits per move for the algorithms that search (negative: none)
+	// a node budget keeps the games reproducible for a given seed
+	SearchLimits moveLimits(-1,20000);
+	
+	// binary record of all the games (see Record.h), not written if false
+	bool recordGames = false;
+	bool recordPaths = false;  // hops of the moves, for faster replays
+	string recordFilename = "data/games.rec";
+	
+	// dataset of positions sampled from the games with their outcome (see
+	// Dataset.h), one shard per thread, not written if false
+	bool exportPositions = false;
+	double positionSamplingRate = 0.1;
+	string datasetPrefix = "data/positions";
+	
+	// weights of the linear evaluation fitted by tune.cpp, the default
+	// weights (see evaluation.cpp) are kept if the file can't be read
+	string evalWeightsFilename = "data/evalWeights.dat";
+	EvalWeights tunedWeights;
+	int evalWeightsStatus = loadEvalWeights(evalWeightsFilename, tunedWeights);
+	
+	// weight of the hop distance term in the hamiltonian of team 0 (see
+	// hopDistance.cpp), 0 for the plain target hamiltonian
+	double hopWeightTeam0 = 0;
+	
+	// endgame tablebases written by retrograde.cpp, only for two teams, not
+	// used if false (their wins are the ones of a restricted game where the
+	// pawns in their target don't move, see tablebase.cpp)
+	bool useTablebases = false;
+	string tablebaseFilename = "data/tablebase_" + to_string(boardSize) + ".tb";
+	int tablebaseStatus = useTablebases ? tablebase.open(tablebaseFilename) : 1;
+	
+	// opening book (see book.cpp) of the first moves of each team in the
+	// games, merged with the book already in the file, not written if false
+	bool buildBook = false;
+	int bookMovesPerTeam = 12;
+	int bookMinGames = 10;             // moves played less are not used
+	string bookFilename = openingBookFilename(numTeams, boardSize);
+	
 	// report
 	cout << endl;
 	cout << "=========== Parameters ============" << endl;
@@ -62,8 +116,22 @@ int main()
 	cout << "boardSize = " << boardSize << endl;
 	cout << "numGames = " << numGames << endl;
 	cout << "maxNumMoves = " << maxNumMoves << endl;
+	cout << "detectStalemates = " << detectStalemates << endl;
+	cout << "numThreads = " << numThreads << endl;
+	cout << "moveTimeBudget = " << moveLimits.timeBudget_ << endl;
+	cout << "moveNodeBudget = " << moveLimits.nodeBudget_ << endl;
+	cout << "recordGames = " << recordGames << endl;
+	cout << "exportPositions = " << exportPositions << endl;
+	cout << "buildBook = " << buildBook << endl;
+	cout << "evalWeights = " << (evalWeightsStatus==0 ? evalWeightsFilename :
+	                             "default") << endl;
+	cout << "tablebase = " << (tablebaseStatus==0 ? tablebaseFilename :
+	                           "none") << endl;
+	cout << endl;
+	cout << "Algorithm: Hamiltonian \"Target\" with temperature=0.3";
+	if (hopWeightTeam0 != 0)
+		cout << ", hop distance weight=" << hopWeightTeam0 << " for team 0";
 	cout << endl;
-	cout << "Algorithm: Hamiltonian \"Target\" with temperature=0.3" << endl;
 	
 	////////////////////////////// Game loop ///////////////////////////////
 	
@@ -74,70 +142,208 @@ int main()
 	// seed from algorithm.cpp
 	cout << "seed = " << seed << endl;
 	
+	// recording, games are written one at a time when they end
+	BinaryRecordSink *binaryRecordSink = NULL;
+	if (recordGames) binaryRecordSink = new BinaryRecordSink(recordFilename,
+		RECORD_BOARD_HEXAGRAM, boardSize, numTeams, seed, recordPaths);
+	
 	// analysis variables
 	vector<int> numMoves(numGames,0);
+	vector<int> gameStates(numGames,GAME_RUNNING);
+	vector<int> numMovesWithoutProgress(numGames,0);
+	
+	// shared between the threads
+	atomic<int> nextGame(0);
+	mutex simulationMutex;
+	LatencyLog latenciesOfThreads;
+	int nVertices = Hexagram(numTeams, boardSize).getVertices().size();
+	OpeningBookBuilder bookBuilder(numTeams, boardSize, nVertices);
 	
-	for (int iGame=0; iGame<numGames; iGame++)
+	auto simulateGames = [&](int ithread)
 	{
-		Hexagram board(numTeams, boardSize);
+		gen.seed(seed+ithread);
+		evalWeights = tunedWeights;
+		useTablebase = useTablebases;
+		if (useTablebases) tablebase.open(tablebaseFilename);
 		
-		// variables to control the game
-		bool gameEnded = false;
-		int pawnSelected = -1;
+		NullRecordSink nullRecordSink;
+		BufferedRecordSink bufferedRecordSink;
+		RecordSink &recordSink = recordGames ? 
+		                         (RecordSink&) bufferedRecordSink :
+		                         (RecordSink&) nullRecordSink;
 		
-		// variables for the analysis
-		int counterMoves = 0;
+		PositionDatasetWriter *datasetWriter = NULL;
+		if (exportPositions) datasetWriter = new PositionDatasetWriter(
+			datasetShardFilename(datasetPrefix, ithread), RECORD_BOARD_HEXAGRAM,
+			boardSize, numTeams, seed, ithread, positionSamplingRate);
 		
-		while (!gameEnded && counterMoves<maxNumMoves)
+		OpeningBookBuilder threadBookBuilder(numTeams, boardSize, nVertices);
+		
+		for (int iGame=nextGame++; iGame<numGames; iGame=nextGame++)
 		{
-			//////////////////////// Make one move /////////////////////////
+			Hexagram board(numTeams, boardSize);
 			
-			int ipawnToMove = -1;
-			int ivertexDestination = -1;
-			int pteam = board.getPlayingTeam();
+			// variables to control the game
+			bool gameEnded = false;
+			int gameState = GAME_RUNNING;
+			StalemateDetector stalemateDetector(board, repetitionLimit,
+			                                    noProgressRounds);
 			
-			// use a copy to prevent the algorithm from making changes
-			Hexagram boardCopy = board;
+			// variables for the analysis
+			int counterMoves = 0;
+			vector<BookGameMove> bookMoves;
 			
-			// decide move to perform using an algorithm specific to the team
-			if (pteam==0)
-			{
-				temperature = 0.3;
-				algorithmHamiltonian(boardCopy, ipawnToMove, 
-				                     ivertexDestination);
-			}
-			else
+			while (!gameEnded && gameState==GAME_RUNNING &&
+			       counterMoves<maxNumMoves)
 			{
-				temperature = 0.3;
-				algorithmHamiltonian(boardCopy, ipawnToMove, 
-				                     ivertexDestination);
+				//////////////////////// Make one move /////////////////////////
+				
+				int ipawnToMove = -1;
+				int ivertexDestination = -1;
+				int pteam = board.getPlayingTeam();
+				
+				if (exportPositions)
+					datasetWriter->addPosition(board, iGame, counterMoves);
+				
+				// use a copy to prevent the algorithm from making changes
+				Hexagram boardCopy = board;
+				
+				// decide move to perform using an algorithm specific to the team
+				chrono::steady_clock::time_point start = 
+					chrono::steady_clock::now();
+				
+				if (pteam==0)
+				{
+					temperature = 0.3;
+					hopDistanceWeight = hopWeightTeam0;
+					algorithmHamiltonian(boardCopy, ipawnToMove, 
+					                     ivertexDestination);
+					//algorithmSearch(boardCopy, ipawnToMove, 
+					//                ivertexDestination, moveLimits);
+					//algorithmHamiltonianEval(boardCopy, ipawnToMove, 
+					//                         ivertexDestination);
+				}
+				else
+				{
+					temperature = 0.3;
+					hopDistanceWeight = 0;
+					algorithmHamiltonian(boardCopy, ipawnToMove, 
+					                     ivertexDestination);
+				}
+				
+				chrono::duration<double> time = chrono::steady_clock::now() - start;
+				moveLatencies.add(time.count());
+				
+				// place selected pawn
+				int status = board.move(ipawnToMove, ivertexDestination, 
+				                        recordSink);
+				if (status == 0) 
+				{
+					if (buildBook && counterMoves < bookMovesPerTeam*numTeams)
+					{
+						// move mapped onto the canonical position
+						int isym;
+						BookGameMove bookMove;
+						bookMove.hash_ = boardCopy.getCanonicalHash(isym);
+						bookMove.team_ = pteam;
+						const Symmetry &symmetry = boardCopy.getSymmetry(isym);
+						int ivertexFrom = boardCopy.getVertexFromPawn(ipawnToMove);
+						bookMove.ivertexFrom_ = symmetry.vertices_[ivertexFrom];
+						bookMove.ivertexTo_ = symmetry.vertices_[ivertexDestination];
+						bookMoves.push_back(bookMove);
+					}
+					counterMoves ++;
+				}
+				else 
+				{
+					lock_guard<mutex> lock(simulationMutex);
+					cout << "Move is not valid, error code "
+						 << status << endl;
+				}
+				
+				////////////////////////////////////////////////////////////////
+				
+				// detect end of the game
+				if (board.getPlayingTeam()<0) gameEnded = true;
+				
+				// detect stuck games
+				if (detectStalemates) gameState = stalemateDetector.update(board);
 			}
 			
-			// place selected pawn
-			int status = board.move(ipawnToMove, ivertexDestination, recordFile);
-			if (status == 0) 
-			{
-				counterMoves ++;
-			}
-			else 
+			// after game analysis
+			numMoves[iGame] = counterMoves;
+			if (gameEnded) gameStates[iGame] = GAME_FINISHED;
+			else if (gameState != GAME_RUNNING) gameStates[iGame] = gameState;
+			else gameStates[iGame] = GAME_MOVE_LIMIT;
+			numMovesWithoutProgress[iGame] = 
+				stalemateDetector.getMovesSinceProgress();
+			
+			if (exportPositions)
+				datasetWriter->endGame(board, counterMoves, gameEnded);
+			
+			if (buildBook && gameEnded)
+				threadBookBuilder.addGame(bookMoves, board.getWinningOrder());
+			
+			lock_guard<mutex> lock(simulationMutex);
+			
+			if (recordGames)
 			{
-				cout << "Move is not valid, error code "
-					 << status << endl;
+				binaryRecordSink->beginGame();
+				for (RecordEntry &entry : bufferedRecordSink.getEntries())
+				{
+					vector<int> path = entry.path_;
+					if (path.size()==0) path.push_back(entry.ivertexTo_);
+					binaryRecordSink->recordMovePath(entry.ivertexFrom_, path);
+				}
+				bufferedRecordSink.clear();
 			}
 			
-			////////////////////////////////////////////////////////////////
-			
-			// detect end of the game
-			if (board.getPlayingTeam()<0) gameEnded = true;
+			if (iGame%max(numGames/10,1)==0)
+				cout << "completed games up to number " << iGame << endl;
 		}
 		
-		// after game analysis
-		numMoves[iGame] = counterMoves;
+		// merge the results of the thread
+		lock_guard<mutex> lock(simulationMutex);
 		
-		if (iGame%(numGames/10)==0)
-			cout << "completed games up to number " << iGame << endl;
+		if (exportPositions)
+		{
+			if (datasetWriter->close() != 0)
+				cout << "Could not write the positions of thread " << ithread
+				     << endl;
+			delete datasetWriter;
+		}
+		
+		if (ithread != 0) latenciesOfThreads.add(moveLatencies);
+		if (buildBook) bookBuilder.merge(threadBookBuilder);
+	};
+	
+	vector<thread> workers;
+	for (int i=1; i<numThreads; i++) workers.push_back(thread(simulateGames, i));
+	simulateGames(0);
+	for (thread &worker : workers) worker.join();
+	
+	if (recordGames)
+	{
+		if (binaryRecordSink->close() != 0)
+			cout << "Could not write the record of the games" << endl;
+		delete binaryRecordSink;
 	}
 	
+	if (buildBook)
+	{
+		int loadStatus = bookBuilder.load(bookFilename);
+		if (loadStatus == 2)
+			cout << "Could not merge with " << bookFilename
+			     << " (not a book of this board)" << endl;
+		if (bookBuilder.write(bookFilename, bookMinGames) != 0)
+			cout << "Could not write the opening book" << endl;
+		else
+			cout << "Opening book written in " << bookFilename << endl;
+	}
+	
+	// latencies of all the threads, the main one (thread 0) included
+	moveLatencies.add(latenciesOfThreads);
+	
 	//////////////////////// Statistical analysis //////////////////////////
 	
 	cout << endl;
@@ -151,10 +357,24 @@ int main()
 	cout << endl;
 	cout << "Number of played games is " << numGames0 << endl;
 	
+	// moves of the discarded games and moves without progress in them
+	long numMovesTotal = 0;
+	long numMovesWasted = 0;
+	long numMovesStuck = 0;
+	vector<int> numGamesOfState(GAME_MOVE_LIMIT+1,0);
+	
 	for (int i=0; i<numGames0; i++)
 	{
-		// discard if number of moves exceeds a given limit
-		if (numMoves0[i]>=maxNumMoves) continue;
+		numMovesTotal += numMoves0[i];
+		numGamesOfState[gameStates[i]]++;
+		
+		// discard if the game was stopped (limit of moves or stuck game)
+		if (gameStates[i] != GAME_FINISHED)
+		{
+			numMovesWasted += numMoves0[i];
+			numMovesStuck += numMovesWithoutProgress[i];
+			continue;
+		}
 		
 		numGames++;
 		numMoves.push_back(numMoves0[i]);
@@ -162,6 +382,20 @@ int main()
 	
 	cout << "Number of valid games is " << numGames << endl;
 	cout << "Fraction of invalid games is " << 1-double(numGames)/numGames0 << endl;
+	cout << "Number of games stopped in a cycle is " 
+	     << numGamesOfState[GAME_CYCLE] << endl;
+	cout << "Number of games stopped in a stalemate is " 
+	     << numGamesOfState[GAME_STALEMATE] << endl;
+	cout << "Number of games stopped by the limit of moves is " 
+	     << numGamesOfState[GAME_MOVE_LIMIT] << endl;
+	cout << "Fraction of wasted moves is " 
+	     << double(numMovesWasted)/max(numMovesTotal,1L) << " (" 
+	     << numMovesStuck << " moves without progress)" << endl;
+	
+	///// latency of the decisions /////
+	
+	cout << endl;
+	moveLatencies.report(cout);
 	
 	///// number of moves (distribution) /////
 	
@@ -251,6 +485,10 @@ int main()
 	
 	/////   /////
 	
+	#ifdef INSTRUMENT
+	instrumentReport(cout);
+	#endif
+	
 	////////////////////////////////////////////////////////////////////////
 	
 	return 0;
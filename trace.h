@@ -0,0 +1,286 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//    Header file for the binary trace of the chinese checkers game.      //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	Trace points replace the printing to cout in the hot paths of the
+//	debug build. They are compiled with -DDEBUG or -DTRACE and do nothing
+//	until the trace is enabled at runtime with traceEnable(true). Each
+//	thread writes compact records (event, timestamp, three integers) in
+//	its own ring buffer, without any lock, the oldest records being
+//	overwritten. traceDump() writes all buffers in a binary file that is
+//	rendered as text or Chrome trace JSON by trace_decode.cpp.
+//
+//	File format (little endian)
+//	o	header: "CCTRACE1", number of event types, then for each type its
+//		kind (0 instant, 1 begin, 2 end) and its name (length + chars)
+//	o	for each thread: thread index, number of records, records
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+using namespace std;
+
+
+// event types, with their kind and name below
+enum TraceEventType
+{
+	TRACE_MOVE,               // ipawn, ivertexFrom, ivertexTo
+	TRACE_MOVE_INVALID,       // ipawn, ivertex, error code
+	TRACE_MOVES_DIRECT,       // ivertex, number of destinations
+	TRACE_MOVES_HOPPING,      // ivertex, number of destinations
+	TRACE_HOPPING_RECURSION,  // ivertex, vertex we come from
+	TRACE_TEAMS_ON_TARGET,    // number of teams on target
+	TRACE_ALGORITHM_BEGIN,    // algorithm id, playing team
+	TRACE_ALGORITHM_END,      // algorithm id, ipawn, ivertex
+	TRACE_CANDIDATE,          // ivertexFrom, ivertexTo, fit or energy*1000
+	TRACE_SELECTED,           // ivertexFrom, ivertexTo
+	TRACE_SEARCH_RESULT,      // completed depth, nodes, score
+	NUM_TRACE_EVENTS
+};
+
+// algorithm ids used in TRACE_ALGORITHM_BEGIN/END
+enum TraceAlgorithm
+{
+	TRACE_RANDOM_MOVE,
+	TRACE_BEST_MOVE0_MIN_SUM,
+	TRACE_BEST_MOVE0_MIN_FREE,
+	TRACE_HAMILTONIAN,
+	TRACE_SEARCH,
+	TRACE_HAMILTONIAN_EVAL,
+	TRACE_HAMILTONIAN_ASSIGNMENT
+};
+
+const int TRACE_INSTANT = 0;
+const int TRACE_BEGIN = 1;
+const int TRACE_END = 2;
+
+inline int traceEventKind(int event)
+{
+	if (event == TRACE_ALGORITHM_BEGIN) return TRACE_BEGIN;
+	if (event == TRACE_ALGORITHM_END) return TRACE_END;
+	return TRACE_INSTANT;
+}
+
+inline string traceEventName(int event)
+{
+	static const char *names[NUM_TRACE_EVENTS] =
+	{
+		"move",
+		"move_invalid",
+		"moves_direct",
+		"moves_hopping",
+		"hopping_recursion",
+		"teams_on_target",
+		"algorithm",
+		"algorithm",
+		"candidate",
+		"selected",
+		"search_result"
+	};
+	
+	return names[event];
+}
+
+// compact record of an event (24 bytes)
+struct TraceRecord
+{
+	uint64_t timestamp_;  // nanoseconds since the start of the program
+	uint32_t event_;
+	int32_t args_[3];
+};
+
+const int TRACE_BUFFER_SIZE = 1<<16; // records per thread, power of two
+
+// ring buffer written by a single thread
+class TraceBuffer
+{
+	public:
+		TraceBuffer();
+		~TraceBuffer();
+		
+		void push(int event, int arg0, int arg1, int arg2);
+		vector<TraceRecord> snapshot();
+		int getThreadIndex() {return threadIndex_;}
+	
+	protected:
+		vector<TraceRecord> records_;
+		atomic<uint64_t> head_;       // total number of records pushed
+		int threadIndex_;
+};
+
+// buffers of all threads
+class TraceRegistry
+{
+	public:
+		TraceRegistry() : enabled_(false), numThreads_(0)
+		{
+			start_ = chrono::steady_clock::now();
+		}
+		
+		atomic<bool> enabled_;
+		chrono::steady_clock::time_point start_;
+		mutex mutex_;
+		vector<TraceBuffer*> buffers_;
+		vector<TraceRecord> retired_;   // records of finished threads
+		vector<int> retiredThreads_;    // thread index of each record
+		int numThreads_;
+};
+
+inline TraceRegistry& traceRegistry()
+{
+	static TraceRegistry registry;
+	return registry;
+}
+
+inline TraceBuffer& traceBuffer()
+{
+	thread_local TraceBuffer buffer;
+	return buffer;
+}
+
+inline void traceEnable(bool enabled)
+{
+	traceRegistry().enabled_.store(enabled, memory_order_relaxed);
+}
+
+inline bool traceEnabled()
+{
+	return traceRegistry().enabled_.load(memory_order_relaxed);
+}
+
+
+
+inline TraceBuffer::TraceBuffer() : head_(0)
+{
+	records_ = vector<TraceRecord>(TRACE_BUFFER_SIZE);
+	
+	TraceRegistry &registry = traceRegistry();
+	lock_guard<mutex> lock(registry.mutex_);
+	threadIndex_ = registry.numThreads_++;
+	registry.buffers_.push_back(this);
+}
+
+inline TraceBuffer::~TraceBuffer()
+{
+	vector<TraceRecord> records = snapshot();
+	
+	TraceRegistry &registry = traceRegistry();
+	lock_guard<mutex> lock(registry.mutex_);
+	for (TraceRecord record : records)
+	{
+		registry.retired_.push_back(record);
+		registry.retiredThreads_.push_back(threadIndex_);
+	}
+	for (int i=0; i<registry.buffers_.size(); i++)
+		if (registry.buffers_[i] == this)
+			registry.buffers_.erase(registry.buffers_.begin()+i);
+}
+
+inline void TraceBuffer::push(int event, int arg0, int arg1, int arg2)
+{
+	chrono::nanoseconds time = chrono::steady_clock::now()
+	                         - traceRegistry().start_;
+	uint64_t head = head_.load(memory_order_relaxed);
+	
+	TraceRecord &record = records_[head & (TRACE_BUFFER_SIZE-1)];
+	record.timestamp_ = time.count();
+	record.event_ = event;
+	record.args_[0] = arg0;
+	record.args_[1] = arg1;
+	record.args_[2] = arg2;
+	
+	head_.store(head+1, memory_order_release);
+}
+
+// Records currently in the buffer, oldest first. Meant to be called when
+// the thread is not writing (records being written could be torn).
+inline vector<TraceRecord> TraceBuffer::snapshot()
+{
+	uint64_t head = head_.load(memory_order_acquire);
+	uint64_t first = head > TRACE_BUFFER_SIZE ? head-TRACE_BUFFER_SIZE : 0;
+	
+	vector<TraceRecord> records;
+	for (uint64_t i=first; i<head; i++)
+		records.push_back(records_[i & (TRACE_BUFFER_SIZE-1)]);
+	
+	return records;
+}
+
+
+
+inline void traceWriteRecords(ofstream &file, int threadIndex,
+                              vector<TraceRecord> &records)
+{
+	int32_t thread = threadIndex;
+	uint64_t numRecords = records.size();
+	file.write((char*)&thread, sizeof(thread));
+	file.write((char*)&numRecords, sizeof(numRecords));
+	file.write((char*)records.data(), numRecords*sizeof(TraceRecord));
+}
+
+// Write the buffers of all threads in a binary file
+inline void traceDump(string filename)
+{
+	ofstream file(filename, ios::binary);
+	
+	// header with the description of the events
+	file.write("CCTRACE1", 8);
+	int32_t numEvents = NUM_TRACE_EVENTS;
+	file.write((char*)&numEvents, sizeof(numEvents));
+	for (int event=0; event<NUM_TRACE_EVENTS; event++)
+	{
+		int32_t kind = traceEventKind(event);
+		string name = traceEventName(event);
+		int32_t length = name.size();
+		file.write((char*)&kind, sizeof(kind));
+		file.write((char*)&length, sizeof(length));
+		file.write(name.data(), length);
+	}
+	
+	// records of each thread
+	TraceRegistry &registry = traceRegistry();
+	lock_guard<mutex> lock(registry.mutex_);
+	
+	for (TraceBuffer *buffer : registry.buffers_)
+	{
+		vector<TraceRecord> records = buffer->snapshot();
+		traceWriteRecords(file, buffer->getThreadIndex(), records);
+	}
+	
+	for (int i=0; i<registry.retired_.size(); )
+	{
+		int thread = registry.retiredThreads_[i];
+		vector<TraceRecord> records;
+		while (i<registry.retired_.size() && registry.retiredThreads_[i]==thread)
+			records.push_back(registry.retired_[i++]);
+		traceWriteRecords(file, thread, records);
+	}
+}
+
+
+#if defined(DEBUG) || defined(TRACE)
+
+#define TRACE_EVENT(event,arg0,arg1,arg2) \
+	do {if (traceEnabled()) traceBuffer().push(event,arg0,arg1,arg2);} while (0)
+	
+#else
+
+#define TRACE_EVENT(event,arg0,arg1,arg2) do {} while (0)
+
+#endif
+
+#endif
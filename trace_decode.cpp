@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o trace_decode trace_decode.cpp             //
+//    Run with     $ ./trace_decode <trace file> [text|chrome]            //
+//                                                                        //
+//    This file is used for reading the binary traces written by the      //
+//    debug build (see trace.h). The records are printed as text, one     //
+//    per line, or as a Chrome trace JSON file that can be opened in      //
+//    chrome://tracing or in Perfetto.                                    //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "trace.h"
+
+using namespace std;
+
+
+class TraceEventInfo
+{
+	public:
+		int kind_;
+		string name_;
+};
+
+class DecodedRecord
+{
+	public:
+		int thread_;
+		TraceRecord record_;
+};
+
+
+
+// Read the trace file, returns false if the file is not a valid trace
+
+bool readTrace(string filename, vector<TraceEventInfo> &events,
+               vector<DecodedRecord> &records)
+{
+	ifstream file(filename, ios::binary);
+	if (!file) return false;
+	
+	char magic[8];
+	file.read(magic, 8);
+	if (!file || string(magic,8) != "CCTRACE1") return false;
+	
+	int32_t numEvents = 0;
+	file.read((char*)&numEvents, sizeof(numEvents));
+	for (int i=0; i<numEvents && file; i++)
+	{
+		int32_t kind, length;
+		file.read((char*)&kind, sizeof(kind));
+		file.read((char*)&length, sizeof(length));
+		string name(length,' ');
+		file.read(&name[0], length);
+		
+		TraceEventInfo info;
+		info.kind_ = kind;
+		info.name_ = name;
+		events.push_back(info);
+	}
+	
+	while (true)
+	{
+		int32_t thread;
+		uint64_t numRecords;
+		file.read((char*)&thread, sizeof(thread));
+		file.read((char*)&numRecords, sizeof(numRecords));
+		if (!file) break;
+		
+		vector<TraceRecord> threadRecords(numRecords);
+		file.read((char*)threadRecords.data(), numRecords*sizeof(TraceRecord));
+		if (!file) return false;
+		
+		for (TraceRecord record : threadRecords)
+		{
+			DecodedRecord decoded;
+			decoded.thread_ = thread;
+			decoded.record_ = record;
+			records.push_back(decoded);
+		}
+	}
+	
+	// all threads on a common time line
+	stable_sort(records.begin(), records.end(),
+		[](const DecodedRecord &a, const DecodedRecord &b)
+		{return a.record_.timestamp_ < b.record_.timestamp_;});
+	
+	return true;
+}
+
+
+
+void printText(vector<TraceEventInfo> &events, vector<DecodedRecord> &records)
+{
+	for (DecodedRecord decoded : records)
+	{
+		TraceRecord &record = decoded.record_;
+		string name = record.event_<events.size() ?
+		              events[record.event_].name_ : "unknown";
+		int kind = record.event_<events.size() ? events[record.event_].kind_ : 0;
+		
+		cout << record.timestamp_/1000.0 << " us"
+		     << "  thread " << decoded.thread_ << "  "
+		     << (kind==TRACE_BEGIN ? "begin " : kind==TRACE_END ? "end " : "")
+		     << name << " "
+		     << record.args_[0] << " "
+		     << record.args_[1] << " "
+		     << record.args_[2] << endl;
+	}
+}
+
+
+
+void printChrome(vector<TraceEventInfo> &events, vector<DecodedRecord> &records)
+{
+	cout << "{\"traceEvents\": [" << endl;
+	
+	for (int i=0; i<records.size(); i++)
+	{
+		TraceRecord &record = records[i].record_;
+		string name = record.event_<events.size() ?
+		              events[record.event_].name_ : "unknown";
+		int kind = record.event_<events.size() ? events[record.event_].kind_ : 0;
+		string phase = kind==TRACE_BEGIN ? "B" : kind==TRACE_END ? "E" : "i";
+		
+		cout << "{\"name\": \"" << name << "\", "
+		     << "\"ph\": \"" << phase << "\", "
+		     << (phase=="i" ? "\"s\": \"t\", " : "")
+		     << "\"ts\": " << record.timestamp_/1000.0 << ", "
+		     << "\"pid\": 0, \"tid\": " << records[i].thread_ << ", "
+		     << "\"args\": {\"a0\": " << record.args_[0]
+		     << ", \"a1\": " << record.args_[1]
+		     << ", \"a2\": " << record.args_[2] << "}}"
+		     << (i+1<records.size() ? "," : "") << endl;
+	}
+	
+	cout << "]}" << endl;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	if (argc<2)
+	{
+		cerr << "usage: " << argv[0] << " <trace file> [text|chrome]" << endl;
+		return 1;
+	}
+	
+	string format = "text";
+	if (argc>2) format = argv[2];
+	
+	vector<TraceEventInfo> events;
+	vector<DecodedRecord> records;
+	
+	if (!readTrace(argv[1], events, records))
+	{
+		cerr << "Could not read trace file " << argv[1] << endl;
+		return 1;
+	}
+	
+	if (format == "chrome") printChrome(events, records);
+	else printText(events, records);
+	
+	return 0;
+}
@@ -0,0 +1,364 @@
+////////////////////////////////////////////////////////////////////////////
+//                                                                        //
+//                         * Chinese Checkers *                           //
+//                                                                        //
+//    Author: Cédric Schoonen <cedric.schoonen1@gmail.com>                //
+//    February 2020                                                       //
+//                                                                        //
+//    Compile with $ g++ -O3 -o tune tune.cpp Board.h Board.cpp \         //
+//                   Record.cpp Dataset.cpp -pthread                      //
+//    Run with     $ ./tune [-j threads] [-o weights] [-n iterations] \   //
+//                   [-r rate] <shard> [<shard> ...]                      //
+//                                                                        //
+//    This file is used for fitting the weights of the linear evaluation  //
+//    (see evaluation.cpp) on datasets of positions exported by           //
+//    test_algorithms.cpp. The evaluation of the playing team is fitted   //
+//    to the number of moves it needed to finish, by gradient descent     //
+//    on the mean squared error, on all the cores. The weights are        //
+//    written in a file that the algorithms can load (default             //
+//    "data/evalWeights.dat").                                            //
+//                                                                        //
+////////////////////////////////////////////////////////////////////////////
+
+//	The features are computed once and standardised (zero mean, unit
+//	variance) so that a single learning rate suits all the weights. One
+//	game out of ten is kept for validation, so that the error reported at
+//	the end is measured on positions that were not fitted.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include "Board.h"
+#include "Dataset.h"
+#include "evaluation.cpp"
+
+using namespace std;
+
+
+// features and labels of all the positions, row-major
+class TuneData
+{
+	public:
+		long size() {return labels_.size();}
+		
+		vector<double> features_;   // EVAL_NUM_FEATURES per position
+		vector<double> labels_;     // moves of the playing team to finish
+		vector<char> validation_;   // positions not used for the fit
+};
+
+// squared errors and gradient of a range of positions
+class TunePartial
+{
+	public:
+		TunePartial() : numTrain_(0), sumSquaresTrain_(0), numValidation_(0),
+		                sumSquaresValidation_(0),
+		                gradient_(EVAL_NUM_FEATURES,0) {;}
+		
+		long numTrain_;
+		double sumSquaresTrain_;
+		long numValidation_;
+		double sumSquaresValidation_;
+		vector<double> gradient_;
+};
+
+
+
+// Compute the features of the positions [begin,end) of the concatenated
+// shards, with a board of the thread
+
+void computeFeatures(vector<PositionDatasetReader*> &readers, TuneData &data,
+                     long begin, long end)
+{
+	PositionDatasetHeader header = readers[0]->getHeader();
+	Hexagram board(header.nTeams_, header.boardSize_);
+	EvalFeatures evalFeatures(board);
+	vector<int> pawnVertices(header.nPawns_);
+	if (begin>=end) return;
+	
+	// shard and record of the first position
+	int ireader = 0;
+	long irecord = begin;
+	while (irecord >= readers[ireader]->getNumRecords())
+		irecord -= readers[ireader++]->getNumRecords();
+	
+	for (long i=begin; i<end; i++, irecord++)
+	{
+		while (irecord >= readers[ireader]->getNumRecords())
+		{
+			irecord = 0;
+			ireader++;
+		}
+		
+		const PositionRecord &record = readers[ireader]->getRecord(irecord);
+		for (int ipawn=0; ipawn<header.nPawns_; ipawn++)
+			pawnVertices[ipawn] = record.pawnVertices_[ipawn];
+		
+		evalFeatures.compute(pawnVertices, record.playingTeam_,
+		                     &data.features_[i*EVAL_NUM_FEATURES]);
+		data.labels_[i] = record.teamMovesRemaining_;
+		data.validation_[i] = record.game_%10 == 0;
+	}
+}
+
+
+
+// Errors and gradient of the mean squared error (training positions only)
+
+void computePartial(TuneData &data, vector<double> &weights, long begin,
+                    long end, TunePartial &partial)
+{
+	partial = TunePartial();
+	
+	for (long i=begin; i<end; i++)
+	{
+		double *features = &data.features_[i*EVAL_NUM_FEATURES];
+		double error = -data.labels_[i];
+		for (int j=0; j<EVAL_NUM_FEATURES; j++)
+			error += weights[j]*features[j];
+		
+		if (data.validation_[i])
+		{
+			partial.numValidation_++;
+			partial.sumSquaresValidation_ += error*error;
+			continue;
+		}
+		
+		partial.numTrain_++;
+		partial.sumSquaresTrain_ += error*error;
+		for (int j=0; j<EVAL_NUM_FEATURES; j++)
+			partial.gradient_[j] += 2*error*features[j];
+	}
+}
+
+TunePartial computeErrors(TuneData &data, vector<double> &weights,
+                          int numThreads)
+{
+	vector<TunePartial> partials(numThreads);
+	vector<thread> workers;
+	
+	for (int i=0; i<numThreads; i++)
+	{
+		long begin = data.size()*i/numThreads;
+		long end = data.size()*(i+1)/numThreads;
+		workers.push_back(thread(computePartial, ref(data), ref(weights),
+		                         begin, end, ref(partials[i])));
+	}
+	for (thread &worker : workers) worker.join();
+	
+	TunePartial total;
+	for (TunePartial &partial : partials)
+	{
+		total.numTrain_ += partial.numTrain_;
+		total.sumSquaresTrain_ += partial.sumSquaresTrain_;
+		total.numValidation_ += partial.numValidation_;
+		total.sumSquaresValidation_ += partial.sumSquaresValidation_;
+		for (int j=0; j<EVAL_NUM_FEATURES; j++)
+			total.gradient_[j] += partial.gradient_[j];
+	}
+	
+	return total;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	///////////////////////////// Parameters ///////////////////////////////
+	
+	int numThreads = thread::hardware_concurrency();
+	string outputFilename = "data/evalWeights.dat";
+	int numIterations = 2000;
+	double learningRate = 0.1;
+	vector<string> filenames;
+	
+	for (int i=1; i<argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "-j" && i+1<argc) numThreads = atoi(argv[++i]);
+		else if (arg == "-o" && i+1<argc) outputFilename = argv[++i];
+		else if (arg == "-n" && i+1<argc) numIterations = atoi(argv[++i]);
+		else if (arg == "-r" && i+1<argc) learningRate = atof(argv[++i]);
+		else filenames.push_back(arg);
+	}
+	if (numThreads<1) numThreads = 1;
+	
+	if (filenames.size()==0)
+	{
+		cerr << "usage: " << argv[0] << " [-j threads] [-o weights]"
+		     << " [-n iterations] [-r rate] <shard> [<shard> ...]" << endl;
+		return 1;
+	}
+	
+	/////////////////////////////// Shards /////////////////////////////////
+	
+	vector<PositionDatasetReader*> readers;
+	long numRecords = 0;
+	
+	for (string filename : filenames)
+	{
+		PositionDatasetReader *reader = new PositionDatasetReader();
+		int status = reader->open(filename);
+		if (status != 0)
+		{
+			cerr << "Could not read " << filename << ", error code " << status
+			     << endl;
+			return 1;
+		}
+		
+		// all the shards must come from the same board
+		PositionDatasetHeader header = reader->getHeader();
+		PositionDatasetHeader first = readers.size()>0 ?
+		                              readers[0]->getHeader() : header;
+		if (header.boardType_ != RECORD_BOARD_HEXAGRAM ||
+		    header.boardSize_ != first.boardSize_ ||
+		    header.nTeams_ != first.nTeams_)
+		{
+			cerr << filename << ": board differs from the first shard" << endl;
+			return 1;
+		}
+		
+		readers.push_back(reader);
+		numRecords += reader->getNumRecords();
+	}
+	
+	if (numRecords==0)
+	{
+		cerr << "No positions in the shards" << endl;
+		return 1;
+	}
+	
+	PositionDatasetHeader header = readers[0]->getHeader();
+	
+	cout << endl;
+	cout << "============ Tune =============" << endl;
+	cout << endl;
+	cout << "shards = " << readers.size() << endl;
+	cout << "positions = " << numRecords << endl;
+	cout << "nTeams = " << header.nTeams_ << endl;
+	cout << "boardSize = " << header.boardSize_ << endl;
+	cout << "threads = " << numThreads << endl;
+	cout << endl;
+	
+	////////////////////////////// Features ////////////////////////////////
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	TuneData data;
+	data.features_.resize(numRecords*EVAL_NUM_FEATURES);
+	data.labels_.resize(numRecords);
+	data.validation_.resize(numRecords);
+	
+	vector<thread> workers;
+	for (int i=0; i<numThreads; i++)
+		workers.push_back(thread(computeFeatures, ref(readers), ref(data),
+		                         numRecords*i/numThreads,
+		                         numRecords*(i+1)/numThreads));
+	for (thread &worker : workers) worker.join();
+	
+	// standardisation, the bias is kept as it is
+	vector<double> mean(EVAL_NUM_FEATURES,0);
+	vector<double> deviation(EVAL_NUM_FEATURES,1);
+	double meanLabel = 0;
+	
+	for (long i=0; i<numRecords; i++)
+	{
+		for (int j=1; j<EVAL_NUM_FEATURES; j++)
+			mean[j] += data.features_[i*EVAL_NUM_FEATURES+j]/numRecords;
+		meanLabel += data.labels_[i]/numRecords;
+	}
+	
+	for (int j=1; j<EVAL_NUM_FEATURES; j++)
+	{
+		double variance = 0;
+		for (long i=0; i<numRecords; i++)
+		{
+			double x = data.features_[i*EVAL_NUM_FEATURES+j]-mean[j];
+			variance += x*x/numRecords;
+		}
+		if (variance>0) deviation[j] = sqrt(variance);
+		
+		for (long i=0; i<numRecords; i++)
+		{
+			double &x = data.features_[i*EVAL_NUM_FEATURES+j];
+			x = (x-mean[j])/deviation[j];
+		}
+	}
+	
+	chrono::duration<double> timeFeatures = chrono::steady_clock::now()-start;
+	
+	////////////////////////// Gradient descent ////////////////////////////
+	
+	// the fit starts from the mean number of moves
+	vector<double> weights(EVAL_NUM_FEATURES,0);
+	weights[EVAL_BIAS] = meanLabel;
+	
+	TunePartial errors = computeErrors(data, weights, numThreads);
+	double baselineError = errors.sumSquaresValidation_
+	                     / max(errors.numValidation_,1L);
+	
+	if (errors.numTrain_==0)
+	{
+		cerr << "No training positions (one game out of ten is kept for"
+		     << " validation)" << endl;
+		return 1;
+	}
+	
+	for (int iteration=0; iteration<numIterations; iteration++)
+	{
+		for (int j=0; j<EVAL_NUM_FEATURES; j++)
+			weights[j] -= learningRate*errors.gradient_[j]/errors.numTrain_;
+		
+		errors = computeErrors(data, weights, numThreads);
+		
+		if ((iteration+1)%(max(numIterations/10,1))==0)
+			cout << "iteration " << iteration+1 << ": training rmse = "
+			     << sqrt(errors.sumSquaresTrain_/errors.numTrain_) << endl;
+	}
+	
+	chrono::duration<double> time = chrono::steady_clock::now()-start;
+	
+	////////////////////////////// Weights /////////////////////////////////
+	
+	// back to the units of the features
+	EvalWeights evalWeights;
+	evalWeights.weights_[EVAL_BIAS] = weights[EVAL_BIAS];
+	for (int j=1; j<EVAL_NUM_FEATURES; j++)
+	{
+		evalWeights.weights_[j] = weights[j]/deviation[j];
+		evalWeights.weights_[EVAL_BIAS] -= weights[j]*mean[j]/deviation[j];
+	}
+	
+	double validationError = errors.sumSquaresValidation_
+	                       / max(errors.numValidation_,1L);
+	
+	cout << endl;
+	cout << "Training positions = " << errors.numTrain_ << endl;
+	cout << "Validation positions = " << errors.numValidation_ << endl;
+	cout << "Validation rmse = " << sqrt(validationError)
+	     << " (" << sqrt(baselineError) << " with the mean only)" << endl;
+	cout << endl;
+	for (int j=0; j<EVAL_NUM_FEATURES; j++)
+		cout << evalFeatureNames[j] << " = " << evalWeights.weights_[j] << endl;
+	cout << endl;
+	cout << "Time for the features = " << timeFeatures.count() << " s" << endl;
+	cout << "Time = " << time.count() << " s" << endl;
+	
+	string comment = "fitted on " + to_string(errors.numTrain_)
+	               + " positions, validation rmse "
+	               + to_string(sqrt(validationError));
+	if (writeEvalWeights(outputFilename, evalWeights, comment) != 0)
+	{
+		cerr << "Could not write " << outputFilename << endl;
+		return 1;
+	}
+	cout << "Weights written in " << outputFilename << endl;
+	
+	for (PositionDatasetReader *reader : readers) delete reader;
+	
+	return 0;
+}